@@ -16,24 +16,70 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    appconfig.cpp \
+    attachmentcache.cpp \
+    bandwidthlimiter.cpp \
+    chatconnection.cpp \
     chatwidget.cpp \
+    chunkuploader.cpp \
     common.cpp \
+    conversation.cpp \
+    endpointselector.cpp \
+    filehasher.cpp \
+    hashcache.cpp \
+    latencystats.cpp \
     logindlg.cpp \
     main.cpp \
     mainwindow.cpp \
+    messagedelegate.cpp \
+    messagehistory.cpp \
+    messagemodel.cpp \
+    messagestore.cpp \
+    networkmanager.cpp \
+    onlineusermodel.cpp \
     passwordedit.cpp \
     registrydlg.cpp \
-    settingdlg.cpp
+    segmentdownloader.cpp \
+    session.cpp \
+    settingdlg.cpp \
+    startuptimer.cpp \
+    thumbnailloader.cpp \
+    transfermodel.cpp \
+    transferpanel.cpp \
+    transferscheduler.cpp
 
 
 HEADERS += \
+    appconfig.h \
+    attachmentcache.h \
+    bandwidthlimiter.h \
+    chatconnection.h \
     chatwidget.h \
+    chunkuploader.h \
     common.h \
+    conversation.h \
+    endpointselector.h \
+    filehasher.h \
+    hashcache.h \
+    latencystats.h \
     logindlg.h \
     mainwindow.h \
+    messagedelegate.h \
+    messagehistory.h \
+    messagemodel.h \
+    messagestore.h \
+    networkmanager.h \
+    onlineusermodel.h \
     passwordedit.h \
     registrydlg.h \
-    settingdlg.h
+    segmentdownloader.h \
+    session.h \
+    settingdlg.h \
+    startuptimer.h \
+    thumbnailloader.h \
+    transfermodel.h \
+    transferpanel.h \
+    transferscheduler.h
 
 
 FORMS += \
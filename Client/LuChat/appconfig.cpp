@@ -0,0 +1,150 @@
+#include "appconfig.h"
+#include "common.h"
+#include <QSettings>
+
+AppConfig *AppConfig::m_pInstance = nullptr;
+
+AppConfig::AppConfig(QObject *parent) :
+    QObject(parent)
+{
+    // 需在QCoreApplication设置组织名和程序名之后创建
+    QSettings settings;
+    m_strServerHost = settings.value(CURRENT_SERVER_HOST).toString();
+    m_strServerPort = settings.value(WEBSOCKET_SERVER_PORT).toString();
+    if (!m_strServerHost.isEmpty() && !m_strServerPort.isEmpty()) {
+        m_listEndpoints << m_strServerHost + ":" + m_strServerPort;
+        m_listEndpoints += settings.value(SERVER_BACKUP_ENDPOINTS).toStringList();
+    }
+    m_strUserPhone = settings.value(WEBSOCKET_USER_PHONE).toString();
+    m_strUserId = settings.value(WEBSOCKET_USER_ID).toString();
+    m_strPassword = settings.value(WEBSOCKET_USER_PWD).toString();
+    m_bRememberPassword = settings.value(WEBSOCKET_REMBER_PWD).toBool();
+    m_strSessionToken = settings.value(SESSION_TOKEN).toString();
+    m_nSessionExpiresAt = settings.value(SESSION_EXPIRES_AT).toLongLong();
+    m_nMessageMemoryBudget = settings.value(MESSAGE_MEMORY_BUDGET, DEFAULT_MESSAGE_MEMORY_BUDGET).toInt();
+    m_nInboundFlushInterval = settings.value(INBOUND_FLUSH_INTERVAL, DEFAULT_INBOUND_FLUSH_INTERVAL).toInt();
+    m_bBinaryFormat = settings.value(WEBSOCKET_BINARY_FORMAT, true).toBool();
+    m_nTransferMaxConcurrent = settings.value(TRANSFER_MAX_CONCURRENT, DEFAULT_TRANSFER_MAX_CONCURRENT).toInt();
+    m_nTransferBandwidthLimit = settings.value(TRANSFER_BANDWIDTH_LIMIT, DEFAULT_TRANSFER_BANDWIDTH_LIMIT).toInt();
+    m_nAttachmentCacheLimit = settings.value(ATTACHMENT_CACHE_LIMIT, DEFAULT_ATTACHMENT_CACHE_LIMIT).toInt();
+    BuildUrls();
+}
+
+void AppConfig::DestroyInstance()
+{
+    delete m_pInstance;
+    m_pInstance = nullptr;
+}
+
+void AppConfig::BuildUrls()
+{
+    if (m_strServerHost.isEmpty() || m_strServerPort.isEmpty()) {
+        m_strHttpUrl.clear();
+        m_strWebSocketUrl.clear();
+        return;
+    }
+    m_strHttpUrl = QString("http://%1:%2").arg(m_strServerHost).arg(m_strServerPort);
+    // 会话令牌由连接层放在握手请求头中，不拼进地址
+    m_strWebSocketUrl = QString("ws://%1:%2/ws").arg(m_strServerHost).arg(m_strServerPort);
+}
+
+bool AppConfig::IsServerHost(const QString &strHost) const
+{
+    for (const QString &strEndpoint : m_listEndpoints) {
+        if (strEndpoint.left(strEndpoint.lastIndexOf(':')) == strHost) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AppConfig::SetServers(const QStringList &listEndpoints)
+{
+    if (listEndpoints.isEmpty() || listEndpoints == m_listEndpoints) {
+        return;
+    }
+    m_listEndpoints = listEndpoints;
+    const QString &strPrimary = listEndpoints.first();
+    QSettings settings;
+    settings.setValue(CURRENT_SERVER_HOST, strPrimary.left(strPrimary.lastIndexOf(':')));
+    settings.setValue(WEBSOCKET_SERVER_PORT, strPrimary.mid(strPrimary.lastIndexOf(':') + 1));
+    settings.setValue(SERVER_BACKUP_ENDPOINTS, listEndpoints.mid(1));
+    // 先切换到主服务器，收到serverChanged时各地址已是新的
+    SelectEndpoint(strPrimary);
+    emit serverChanged();
+}
+
+void AppConfig::SelectEndpoint(const QString &strEndpoint)
+{
+    int nPos = strEndpoint.lastIndexOf(':');
+    QString strHost = strEndpoint.left(nPos);
+    QString strPort = strEndpoint.mid(nPos + 1);
+    if (!m_listEndpoints.contains(strEndpoint) || (strHost == m_strServerHost && strPort == m_strServerPort)) {
+        return;
+    }
+    m_strServerHost = strHost;
+    m_strServerPort = strPort;
+    BuildUrls();
+    emit endpointChanged();
+}
+
+void AppConfig::SetSavedLogin(const QString &strUserPhone, const QString &strPassword, bool bRemember)
+{
+    m_strUserPhone = strUserPhone;
+    m_strPassword = strPassword;
+    m_bRememberPassword = bRemember;
+    QSettings settings;
+    settings.setValue(WEBSOCKET_USER_PHONE, strUserPhone);
+    settings.setValue(WEBSOCKET_USER_PWD, strPassword);
+    settings.setValue(WEBSOCKET_REMBER_PWD, bRemember);
+}
+
+void AppConfig::SetSession(const QString &strToken, qint64 nExpiresAt, const QString &strUserId,
+                           const QString &strUserPhone)
+{
+    m_strSessionToken = strToken;
+    m_nSessionExpiresAt = nExpiresAt;
+    m_strUserId = strUserId;
+    m_strUserPhone = strUserPhone;
+    QSettings settings;
+    settings.setValue(SESSION_TOKEN, strToken);
+    settings.setValue(SESSION_EXPIRES_AT, nExpiresAt);
+    settings.setValue(WEBSOCKET_USER_ID, strUserId);
+    settings.setValue(WEBSOCKET_USER_PHONE, strUserPhone);
+    emit sessionChanged();
+}
+
+void AppConfig::ClearSession()
+{
+    if (m_strSessionToken.isEmpty()) {
+        return;
+    }
+    m_strSessionToken.clear();
+    m_nSessionExpiresAt = 0;
+    QSettings settings;
+    settings.remove(SESSION_TOKEN);
+    settings.remove(SESSION_EXPIRES_AT);
+    emit sessionChanged();
+}
+
+void AppConfig::SetTransferMaxConcurrent(int nMax)
+{
+    if (nMax == m_nTransferMaxConcurrent) {
+        return;
+    }
+    m_nTransferMaxConcurrent = nMax;
+    QSettings settings;
+    settings.setValue(TRANSFER_MAX_CONCURRENT, nMax);
+    emit transferSettingsChanged();
+}
+
+void AppConfig::SetTransferBandwidthLimit(int nKBytesPerSecond)
+{
+    if (nKBytesPerSecond == m_nTransferBandwidthLimit) {
+        return;
+    }
+    m_nTransferBandwidthLimit = nKBytesPerSecond;
+    QSettings settings;
+    settings.setValue(TRANSFER_BANDWIDTH_LIMIT, nKBytesPerSecond);
+    emit transferSettingsChanged();
+}
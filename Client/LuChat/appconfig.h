@@ -0,0 +1,112 @@
+#ifndef APPCONFIG_H
+#define APPCONFIG_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+/**
+ * @brief 客户端配置（全局唯一，界面线程使用）
+ *
+ * 启动时从QSettings读取一次，之后读取配置只访问内存中的字段，服务器的
+ * HTTP和WebSocket地址也预先拼好，发请求时不再读配置、拼字符串。修改
+ * 配置通过Set系列函数，同时写回QSettings，并发出对应的变化信号，各模块
+ * 订阅自己关心的信号，不需要轮询或重启程序。新增可调参数时在这里加字段、
+ * 读写函数和信号即可。
+ */
+class AppConfig : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AppConfig *GetInstance() {
+        if (m_pInstance == nullptr) {
+            m_pInstance = new AppConfig();
+        }
+        return m_pInstance;
+    }
+    static void DestroyInstance();
+
+    // 服务器：配置的第一个为主服务器，其余为备用服务器，当前使用其中延迟最低的一个
+    // （EndpointSelector选择）。ServerHost、ServerPort和各地址都是当前使用的服务器
+    QString ServerHost() const { return m_strServerHost; }
+    QString ServerPort() const { return m_strServerPort; }
+    // 配置的全部服务器（"IP:PORT"），主服务器在前
+    QStringList Endpoints() const { return m_listEndpoints; }
+    // strHost是否为配置的服务器之一（判断文件链接是否来自本服务）
+    bool IsServerHost(const QString &strHost) const;
+    bool HasServer() const { return !m_strHttpUrl.isEmpty(); }
+    // 服务器HTTP地址（形如"http://host:port"），未配置时为空
+    QString HttpUrl() const { return m_strHttpUrl; }
+    // 服务器上API的完整地址，strPath形如"/api/login"
+    QUrl ApiUrl(const QString &strPath) const { return QUrl(m_strHttpUrl + strPath); }
+    // 聊天WebSocket地址，保存了会话令牌时附带令牌
+    QString WebSocketUrl() const { return m_strWebSocketUrl; }
+    // 修改服务器列表（"IP:PORT"，主服务器在前），有变化时发出serverChanged，
+    // 并切换到主服务器
+    void SetServers(const QStringList &listEndpoints);
+    // 切换当前使用的服务器（须为列表中的一个），有变化时发出endpointChanged
+    void SelectEndpoint(const QString &strEndpoint);
+
+    // 登录信息
+    QString SavedUserPhone() const { return m_strUserPhone; }
+    QString SavedUserId() const { return m_strUserId; }
+    QString SavedPassword() const { return m_strPassword; }
+    bool RememberPassword() const { return m_bRememberPassword; }
+    void SetSavedLogin(const QString &strUserPhone, const QString &strPassword, bool bRemember);
+
+    // 会话令牌（免登录启动）
+    QString SessionToken() const { return m_strSessionToken; }
+    qint64 SessionExpiresAt() const { return m_nSessionExpiresAt; }
+    void SetSession(const QString &strToken, qint64 nExpiresAt, const QString &strUserId, const QString &strUserPhone);
+    void ClearSession();
+
+    // 消息
+    int MessageMemoryBudget() const { return m_nMessageMemoryBudget; }
+    int InboundFlushInterval() const { return m_nInboundFlushInterval; }
+    bool BinaryFormat() const { return m_bBinaryFormat; }
+
+    // 文件传输和附件缓存
+    int TransferMaxConcurrent() const { return m_nTransferMaxConcurrent; }
+    // 文件传输总限速（KB/s，0表示不限速）
+    int TransferBandwidthLimit() const { return m_nTransferBandwidthLimit; }
+    void SetTransferMaxConcurrent(int nMax);
+    void SetTransferBandwidthLimit(int nKBytesPerSecond);
+    // 附件缓存上限（MB）
+    int AttachmentCacheLimit() const { return m_nAttachmentCacheLimit; }
+
+signals:
+    void serverChanged();               // 服务器列表已修改（用户修改了配置）
+    void endpointChanged();             // 当前使用的服务器已切换（各地址随之变化）
+    void sessionChanged();              // 会话令牌已保存或清除（之后的WebSocket连接随之使用新令牌）
+    void transferSettingsChanged();     // 并发数或限速已修改
+
+private:
+    explicit AppConfig(QObject *parent = nullptr);
+
+    // 根据服务器地址重新拼接地址
+    void BuildUrls();
+
+    QString m_strServerHost;
+    QString m_strServerPort;
+    QStringList m_listEndpoints;
+    QString m_strHttpUrl;
+    QString m_strWebSocketUrl;
+    QString m_strUserPhone;
+    QString m_strUserId;
+    QString m_strPassword;
+    bool m_bRememberPassword;
+    QString m_strSessionToken;
+    qint64 m_nSessionExpiresAt;
+    int m_nMessageMemoryBudget;
+    int m_nInboundFlushInterval;
+    bool m_bBinaryFormat;
+    int m_nTransferMaxConcurrent;
+    int m_nTransferBandwidthLimit;
+    int m_nAttachmentCacheLimit;
+
+    static AppConfig *m_pInstance;
+};
+
+#endif // APPCONFIG_H
@@ -0,0 +1,348 @@
+#include "attachmentcache.h"
+#include "filehasher.h"
+#include "appconfig.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QRegularExpression>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+
+// 最近使用时间的索引文件头
+static const quint32 ATTACHMENT_INDEX_MAGIC = 0x4C414331;  // "LAC1"
+static const qint32 ATTACHMENT_INDEX_VERSION = 1;
+static const QString ATTACHMENT_INDEX_FILE = "index.dat";
+
+AttachmentCache *AttachmentCache::m_pInstance = nullptr;
+
+AttachmentCacheWorker::AttachmentCacheWorker(const QString &strDir) :
+    QObject(nullptr),
+    m_strDir(strDir),
+    m_nLimit(static_cast<qint64>(DEFAULT_ATTACHMENT_CACHE_LIMIT) * 1024 * 1024),
+    m_nTotal(0),
+    m_bIndexDirty(false)
+{
+}
+
+AttachmentCacheWorker::~AttachmentCacheWorker()
+{
+    // 命中时只更新了内存中的使用时间，退出时写回
+    if (m_bIndexDirty) {
+        SaveIndex();
+    }
+}
+
+QString AttachmentCacheWorker::PathOf(const QString &strFileName) const
+{
+    return m_strDir + "/" + strFileName;
+}
+
+void AttachmentCacheWorker::Load()
+{
+    QDir().mkpath(m_strDir);
+
+    // 上次保存的最近使用时间（索引缺失或损坏时退回文件修改时间）
+    QHash<QString, qint64> hashLastUsed;
+    QFile indexFile(m_strDir + "/" + ATTACHMENT_INDEX_FILE);
+    if (indexFile.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&indexFile);
+        quint32 nMagic = 0;
+        qint32 nVersion = 0;
+        stream >> nMagic >> nVersion;
+        if (nMagic == ATTACHMENT_INDEX_MAGIC && nVersion == ATTACHMENT_INDEX_VERSION) {
+            stream >> hashLastUsed;
+        }
+    }
+
+    const QFileInfoList listFiles = QDir(m_strDir).entryInfoList(QDir::Files);
+    for (const QFileInfo &fileInfo : listFiles) {
+        QString strName = fileInfo.fileName();
+        if (strName == ATTACHMENT_INDEX_FILE) {
+            continue;
+        }
+        if (strName.endsWith(".tmp")) {
+            // 复制到一半（如异常退出）
+            QFile::remove(fileInfo.absoluteFilePath());
+            continue;
+        }
+        // 哈希中没有'.'，第一个'.'之前就是哈希
+        QString strHash = fileInfo.baseName();
+        Entry entry;
+        entry.strFileName = strName;
+        entry.nSize = fileInfo.size();
+        entry.nLastUsed = hashLastUsed.value(strHash, fileInfo.lastModified().toMSecsSinceEpoch());
+        m_hashEntries.insert(strHash, entry);
+        m_nTotal += entry.nSize;
+    }
+    Evict(QString());
+
+    QStringList listPaths;
+    for (auto it = m_hashEntries.constBegin(); it != m_hashEntries.constEnd(); ++it) {
+        listPaths << PathOf(it->strFileName);
+    }
+    emit loaded(listPaths);
+}
+
+void AttachmentCacheWorker::Store(const QString &strHash, const QString &strSourcePath)
+{
+    QString strCachePath;
+    if (!m_hashEntries.contains(strHash)) {
+        QFileInfo sourceInfo(strSourcePath);
+        // 保留扩展名，打开缓存文件时系统才知道用什么程序
+        static const QRegularExpression SUFFIX_PATTERN("^[0-9A-Za-z]{1,16}$");
+        QString strFileName = strHash;
+        if (SUFFIX_PATTERN.match(sourceInfo.suffix()).hasMatch()) {
+            strFileName += "." + sourceInfo.suffix().toLower();
+        }
+        strCachePath = PathOf(strFileName);
+        // 比整个缓存还大的文件不缓存
+        if (!sourceInfo.isFile() || sourceInfo.size() > m_nLimit) {
+            return;
+        }
+        // 先复制到临时文件再改名，缓存中不会出现不完整的文件
+        QString strTempPath = strCachePath + ".tmp";
+        QFile::remove(strTempPath);
+        if (!QFile::copy(strSourcePath, strTempPath)) {
+            qDebug() << "附件缓存写入失败:" << strSourcePath;
+            QFile::remove(strTempPath);
+            return;
+        }
+        // 缓存文件只读，打开后不会被其他程序修改内容
+        QFile::setPermissions(strTempPath, QFileDevice::ReadOwner | QFileDevice::ReadUser
+                              | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+        if (!QFile::rename(strTempPath, strCachePath)) {
+            qDebug() << "附件缓存写入失败:" << strCachePath;
+            QFile::remove(strTempPath);
+            return;
+        }
+        Entry entry;
+        entry.strFileName = strFileName;
+        entry.nSize = sourceInfo.size();
+        entry.nLastUsed = QDateTime::currentMSecsSinceEpoch();
+        m_hashEntries.insert(strHash, entry);
+        m_nTotal += entry.nSize;
+        Evict(strHash);
+    } else {
+        strCachePath = PathOf(m_hashEntries.value(strHash).strFileName);
+        Touch(strHash);
+    }
+    SaveIndex();
+    emit stored(strHash, strCachePath);
+}
+
+void AttachmentCacheWorker::Touch(const QString &strHash)
+{
+    auto it = m_hashEntries.find(strHash);
+    if (it != m_hashEntries.end()) {
+        it->nLastUsed = QDateTime::currentMSecsSinceEpoch();
+        m_bIndexDirty = true;
+    }
+}
+
+void AttachmentCacheWorker::SetLimit(qint64 nBytes)
+{
+    m_nLimit = nBytes;
+    Evict(QString());
+}
+
+void AttachmentCacheWorker::Export(const QString &strHash, const QString &strDestPath)
+{
+    auto it = m_hashEntries.find(strHash);
+    bool bOk = false;
+    if (it != m_hashEntries.end()) {
+        it->nLastUsed = QDateTime::currentMSecsSinceEpoch();
+        m_bIndexDirty = true;
+        // 与下载一样覆盖已有文件；复制出的文件可写，不沿用缓存文件的只读权限
+        QFile::remove(strDestPath);
+        bOk = QFile::copy(PathOf(it->strFileName), strDestPath);
+        if (bOk) {
+            QFile::setPermissions(strDestPath, QFile::permissions(strDestPath)
+                                  | QFileDevice::WriteOwner | QFileDevice::WriteUser);
+        }
+    }
+    emit exported(strDestPath, bOk);
+}
+
+void AttachmentCacheWorker::Evict(const QString &strKeep)
+{
+    if (m_nTotal <= m_nLimit) {
+        return;
+    }
+    QVector<QPair<qint64, QString>> vecByLastUsed;
+    vecByLastUsed.reserve(m_hashEntries.size());
+    for (auto it = m_hashEntries.constBegin(); it != m_hashEntries.constEnd(); ++it) {
+        vecByLastUsed.append(qMakePair(it->nLastUsed, it.key()));
+    }
+    std::sort(vecByLastUsed.begin(), vecByLastUsed.end());
+    for (const QPair<qint64, QString> &item : vecByLastUsed) {
+        if (m_nTotal <= m_nLimit) {
+            break;
+        }
+        if (item.second == strKeep) {
+            continue;
+        }
+        QString strPath = PathOf(m_hashEntries.value(item.second).strFileName);
+        // 只读文件在Windows上需要先恢复写权限才能删除
+        QFile::setPermissions(strPath, QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+        if (QFile::remove(strPath) || !QFile::exists(strPath)) {
+            m_nTotal -= m_hashEntries.take(item.second).nSize;
+            emit evicted(item.second);
+        }
+    }
+    m_bIndexDirty = true;
+}
+
+void AttachmentCacheWorker::SaveIndex()
+{
+    QHash<QString, qint64> hashLastUsed;
+    for (auto it = m_hashEntries.constBegin(); it != m_hashEntries.constEnd(); ++it) {
+        hashLastUsed.insert(it.key(), it->nLastUsed);
+    }
+    QSaveFile file(m_strDir + "/" + ATTACHMENT_INDEX_FILE);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream << ATTACHMENT_INDEX_MAGIC << ATTACHMENT_INDEX_VERSION << hashLastUsed;
+    if (file.commit()) {
+        m_bIndexDirty = false;
+    }
+}
+
+AttachmentCache::AttachmentCache(QObject *parent) :
+    QObject(parent),
+    m_pWorker(nullptr)
+{
+    m_strDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/attachments";
+
+    m_pWorker = new AttachmentCacheWorker(m_strDir);
+    m_pWorker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_pWorker, &QObject::deleteLater);
+    connect(this, &AttachmentCache::storeRequested, m_pWorker, &AttachmentCacheWorker::Store);
+    connect(this, &AttachmentCache::touchRequested, m_pWorker, &AttachmentCacheWorker::Touch);
+    connect(this, &AttachmentCache::limitRequested, m_pWorker, &AttachmentCacheWorker::SetLimit);
+    connect(this, &AttachmentCache::exportRequested, m_pWorker, &AttachmentCacheWorker::Export);
+    connect(m_pWorker, &AttachmentCacheWorker::loaded, this, [this](const QStringList &listPaths) {
+        for (const QString &strPath : listPaths) {
+            m_hashFiles.insert(QFileInfo(strPath).baseName(), strPath);
+        }
+    });
+    connect(m_pWorker, &AttachmentCacheWorker::stored, this, [this](const QString &strHash, const QString &strCachePath) {
+        m_hashFiles.insert(strHash, strCachePath);
+        emit stored(strHash, strCachePath);
+    });
+    connect(m_pWorker, &AttachmentCacheWorker::evicted, this, [this](const QString &strHash) {
+        m_hashFiles.remove(strHash);
+    });
+    connect(m_pWorker, &AttachmentCacheWorker::exported, this, &AttachmentCache::exported);
+
+    FileHasher *pHasher = FileHasher::GetInstance();
+    connect(pHasher, &FileHasher::finished, this, &AttachmentCache::OnHashFinished);
+    connect(pHasher, &FileHasher::failed, this, &AttachmentCache::OnHashFailed);
+
+    m_thread.start(QThread::LowPriority);
+    SetLimit(static_cast<qint64>(AppConfig::GetInstance()->AttachmentCacheLimit()) * 1024 * 1024);
+    QMetaObject::invokeMethod(m_pWorker, &AttachmentCacheWorker::Load, Qt::QueuedConnection);
+}
+
+AttachmentCache::~AttachmentCache()
+{
+    for (auto it = m_hashVerifying.constBegin(); it != m_hashVerifying.constEnd(); ++it) {
+        FileHasher::GetInstance()->Cancel(it.key());
+    }
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void AttachmentCache::DestroyInstance()
+{
+    delete m_pInstance;
+    m_pInstance = nullptr;
+}
+
+bool AttachmentCache::IsValidHash(const QString &strHash)
+{
+    // 十六进制的SHA-256，同时保证可以安全地作为文件名
+    static const QRegularExpression HASH_PATTERN("^[0-9a-f]{64}$");
+    return HASH_PATTERN.match(strHash).hasMatch();
+}
+
+QString AttachmentCache::Lookup(const QString &strHash)
+{
+    QString strPath = m_hashFiles.value(strHash);
+    if (strPath.isEmpty()) {
+        return QString();
+    }
+    emit touchRequested(strHash);
+    return strPath;
+}
+
+void AttachmentCache::Export(const QString &strHash, const QString &strDestPath)
+{
+    emit exportRequested(strHash, strDestPath);
+}
+
+void AttachmentCache::Store(const QString &strHash, const QString &strFilePath)
+{
+    if (!IsValidHash(strHash)) {
+        return;
+    }
+    if (m_hashFiles.contains(strHash)) {
+        emit touchRequested(strHash);
+        return;
+    }
+    // 链接中的哈希由上传方提供，服务器上的同名文件可能已被替换，校验后才放入缓存
+    int nRequestId = FileHasher::GetInstance()->Hash(strFilePath);
+    m_hashVerifying.insert(nRequestId, qMakePair(strHash, strFilePath));
+}
+
+void AttachmentCache::SetLimit(qint64 nBytes)
+{
+    emit limitRequested(nBytes);
+}
+
+void AttachmentCache::OnHashFinished(int nRequestId, const QString &strHash)
+{
+    if (!m_hashVerifying.contains(nRequestId)) {
+        return;
+    }
+    QPair<QString, QString> request = m_hashVerifying.take(nRequestId);
+    if (strHash != request.first) {
+        qDebug() << "下载的文件与链接中的哈希不一致，不缓存:" << request.second;
+        return;
+    }
+    emit storeRequested(request.first, request.second);
+}
+
+void AttachmentCache::OnHashFailed(int nRequestId, const QString &strError)
+{
+    if (m_hashVerifying.contains(nRequestId)) {
+        qDebug() << "附件校验失败:" << m_hashVerifying.take(nRequestId).second << strError;
+    }
+}
+
+QString AttachmentCache::HashOfLink(const QString &strLink)
+{
+    QString strHash = QUrlQuery(QUrl(strLink)).queryItemValue(ATTACHMENT_HASH_QUERY).toLower();
+    return IsValidHash(strHash) ? strHash : QString();
+}
+
+QString AttachmentCache::LinkWithHash(const QString &strLink, const QString &strHash)
+{
+    if (!IsValidHash(strHash)) {
+        return strLink;
+    }
+    QUrl url(strLink);
+    QUrlQuery query(url);
+    query.removeAllQueryItems(ATTACHMENT_HASH_QUERY);
+    query.addQueryItem(ATTACHMENT_HASH_QUERY, strHash);
+    url.setQuery(query);
+    return url.toString();
+}
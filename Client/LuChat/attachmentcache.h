@@ -0,0 +1,132 @@
+#ifndef ATTACHMENTCACHE_H
+#define ATTACHMENTCACHE_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+
+// 文件链接中携带内容哈希的查询参数（/web/uploads/x?hash=...），服务器忽略该参数
+const QString ATTACHMENT_HASH_QUERY = "hash";
+
+/**
+ * @brief 附件缓存工作对象（运行在AttachmentCache的工作线程中）
+ *
+ * 缓存目录下每个文件以内容哈希加原文件的扩展名命名（<哈希>.<扩展名>，
+ * 系统据扩展名选择打开方式），最近使用时间保存在同目录的索引中
+ * （索引缺失时按文件修改时间）。
+ */
+class AttachmentCacheWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AttachmentCacheWorker(const QString &strDir);
+    ~AttachmentCacheWorker();
+
+public slots:
+    // 扫描缓存目录，统计各文件大小和最近使用时间
+    void Load();
+    // 把已校验的文件复制进缓存，超出上限时淘汰最久未用的文件
+    void Store(const QString &strHash, const QString &strSourcePath);
+    // 记录一次使用
+    void Touch(const QString &strHash);
+    void SetLimit(qint64 nBytes);
+    // 把缓存文件复制到strDestPath（覆盖已有文件）
+    void Export(const QString &strHash, const QString &strDestPath);
+
+signals:
+    // 扫描完成，listPaths为全部缓存文件
+    void loaded(const QStringList &listPaths);
+    void stored(const QString &strHash, const QString &strCachePath);
+    void evicted(const QString &strHash);
+    void exported(const QString &strDestPath, bool bOk);
+
+private:
+    typedef struct _Entry {
+        QString strFileName;    // 缓存目录下的文件名
+        qint64 nSize;
+        qint64 nLastUsed;       // 毫秒时间戳
+    } Entry;
+
+    QString m_strDir;
+    qint64 m_nLimit;
+    qint64 m_nTotal;                    // 缓存文件的总大小
+    QHash<QString, Entry> m_hashEntries; // 内容哈希 -> 缓存文件
+    bool m_bIndexDirty;                 // 最近使用时间有未保存的变化
+
+    QString PathOf(const QString &strFileName) const;
+    void SaveIndex();
+    // 淘汰最久未用的文件直到总大小不超过上限，strKeep不淘汰
+    void Evict(const QString &strKeep);
+};
+
+/**
+ * @brief 本地附件缓存（按服务器文件的内容哈希寻址，LRU淘汰）
+ *
+ * 下载聊天中的文件链接前先查缓存：同一文件被反复转发或再次下载时直接
+ * 从本地副本复制，不再访问服务器。下载完成的文件先用FileHasher校验内容
+ * 与链接中的哈希一致，再在工作线程中复制进缓存；缓存文件只读，总大小
+ * 超过上限（配置项ATTACHMENT_CACHE_LIMIT，MB）时淘汰最久未用的文件。
+ */
+class AttachmentCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AttachmentCache *GetInstance() {
+        if (m_pInstance == nullptr) {
+            m_pInstance = new AttachmentCache();
+        }
+        return m_pInstance;
+    }
+    // 退出前结束工作线程
+    static void DestroyInstance();
+    ~AttachmentCache();
+
+    // 查找内容为strHash的缓存文件，命中时返回路径（同时记为最近使用），否则返回空
+    QString Lookup(const QString &strHash);
+    // 在工作线程中把缓存文件复制到strDestPath，完成后发出exported
+    void Export(const QString &strHash, const QString &strDestPath);
+    // 下载完成后调用：校验strFilePath的内容哈希为strHash后放入缓存
+    void Store(const QString &strHash, const QString &strFilePath);
+    // 设置缓存上限（字节）
+    void SetLimit(qint64 nBytes);
+
+    // 从文件链接中取出内容哈希，没有时返回空
+    static QString HashOfLink(const QString &strLink);
+    // 给文件链接附加内容哈希
+    static QString LinkWithHash(const QString &strLink, const QString &strHash);
+
+signals:
+    void stored(const QString &strHash, const QString &strCachePath);
+    void exported(const QString &strDestPath, bool bOk);
+
+    // 内部信号：转发到工作线程
+    void storeRequested(const QString &strHash, const QString &strSourcePath);
+    void touchRequested(const QString &strHash);
+    void limitRequested(qint64 nBytes);
+    void exportRequested(const QString &strHash, const QString &strDestPath);
+
+private slots:
+    void OnHashFinished(int nRequestId, const QString &strHash);
+    void OnHashFailed(int nRequestId, const QString &strError);
+
+private:
+    explicit AttachmentCache(QObject *parent = nullptr);
+
+    QThread m_thread;
+    AttachmentCacheWorker *m_pWorker;
+    QString m_strDir;
+    // 内容哈希 -> 缓存文件路径（工作线程维护的缓存内容在界面线程的副本，查找时不访问磁盘）
+    QHash<QString, QString> m_hashFiles;
+    // 正在校验的请求 -> (期望的哈希, 文件路径)
+    QHash<int, QPair<QString, QString>> m_hashVerifying;
+
+    static AttachmentCache *m_pInstance;
+
+    static bool IsValidHash(const QString &strHash);
+};
+
+#endif // ATTACHMENTCACHE_H
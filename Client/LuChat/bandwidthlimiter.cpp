@@ -0,0 +1,133 @@
+#include "bandwidthlimiter.h"
+#include <cstring>
+
+BandwidthLimiter::BandwidthLimiter(QObject *parent) :
+    QObject(parent),
+    m_nLimit(0),
+    m_dTokens(0),
+    m_nLastRefill(0)
+{
+    m_clock.start();
+    m_refillTimer.setSingleShot(true);
+    m_refillTimer.setInterval(BANDWIDTH_REFILL_INTERVAL);
+    connect(&m_refillTimer, &QTimer::timeout, this, [this]() {
+        Refill();
+        emit refilled();
+    });
+}
+
+void BandwidthLimiter::SetLimit(qint64 nBytesPerSecond)
+{
+    m_nLimit = qMax<qint64>(0, nBytesPerSecond);
+    m_dTokens = 0;
+    m_nLastRefill = m_clock.elapsed();
+    // 取消限速或改变上限时，唤醒等待额度的传输
+    emit refilled();
+}
+
+qint64 BandwidthLimiter::Limit() const
+{
+    return m_nLimit;
+}
+
+void BandwidthLimiter::Refill()
+{
+    qint64 nNow = m_clock.elapsed();
+    double dBurst = qMax(16.0 * 1024, m_nLimit * BANDWIDTH_BURST_WINDOW / 1000.0);
+    m_dTokens = qMin(dBurst, m_dTokens + (nNow - m_nLastRefill) * m_nLimit / 1000.0);
+    m_nLastRefill = nNow;
+}
+
+qint64 BandwidthLimiter::Acquire(qint64 nWanted)
+{
+    if (m_nLimit <= 0 || nWanted <= 0) {
+        return nWanted;
+    }
+    Refill();
+    qint64 nGranted = qMin(nWanted, static_cast<qint64>(m_dTokens));
+    m_dTokens -= nGranted;
+    if (nGranted < nWanted && !m_refillTimer.isActive()) {
+        m_refillTimer.start();
+    }
+    return nGranted;
+}
+
+ThrottledBody::ThrottledBody(const QByteArray &head, QIODevice *pSource, qint64 nOffset, qint64 nSize,
+                             const QByteArray &tail, BandwidthLimiter *pLimiter, QObject *parent) :
+    QIODevice(parent),
+    m_head(head),
+    m_pSource(pSource),
+    m_nOffset(nOffset),
+    m_nSize(pSource ? nSize : 0),
+    m_tail(tail),
+    m_pLimiter(pLimiter)
+{
+    if (pLimiter) {
+        connect(pLimiter, &BandwidthLimiter::refilled, this, &ThrottledBody::readyRead);
+    }
+    // 不经过QIODevice的预读缓冲，读取量即为消耗的额度
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+bool ThrottledBody::isSequential() const
+{
+    return false;
+}
+
+qint64 ThrottledBody::size() const
+{
+    return m_head.size() + m_nSize + m_tail.size();
+}
+
+qint64 ThrottledBody::readData(char *data, qint64 maxSize)
+{
+    qint64 nPos = pos();
+    qint64 nWanted = qMin(maxSize, size() - nPos);
+    if (nWanted <= 0) {
+        return 0;
+    }
+    if (m_pLimiter) {
+        nWanted = m_pLimiter->Acquire(nWanted);
+        if (nWanted == 0) {
+            return 0;
+        }
+    }
+
+    qint64 nRead = 0;
+    // head
+    if (nPos < m_head.size()) {
+        qint64 n = qMin(nWanted, m_head.size() - nPos);
+        memcpy(data, m_head.constData() + nPos, static_cast<size_t>(n));
+        nRead += n;
+        nPos += n;
+    }
+    // 源设备中的数据
+    qint64 nBodyEnd = m_head.size() + m_nSize;
+    if (nRead < nWanted && nPos < nBodyEnd) {
+        qint64 n = qMin(nWanted - nRead, nBodyEnd - nPos);
+        if (!m_pSource->seek(m_nOffset + nPos - m_head.size())) {
+            return -1;
+        }
+        qint64 nGot = m_pSource->read(data + nRead, n);
+        if (nGot != n) {
+            return -1;
+        }
+        nRead += n;
+        nPos += n;
+    }
+    // tail
+    if (nRead < nWanted && nPos >= nBodyEnd) {
+        qint64 nTailPos = nPos - nBodyEnd;
+        qint64 n = qMin(nWanted - nRead, m_tail.size() - nTailPos);
+        memcpy(data + nRead, m_tail.constData() + nTailPos, static_cast<size_t>(n));
+        nRead += n;
+    }
+    return nRead;
+}
+
+qint64 ThrottledBody::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
@@ -0,0 +1,82 @@
+#ifndef BANDWIDTHLIMITER_H
+#define BANDWIDTHLIMITER_H
+
+#include <QObject>
+#include <QIODevice>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QPointer>
+
+// 限速时令牌桶最多积攒的时长（毫秒），决定突发流量的上限
+const int BANDWIDTH_BURST_WINDOW = 100;
+// 额度用完后重新补充的间隔（毫秒）
+const int BANDWIDTH_REFILL_INTERVAL = 20;
+
+/**
+ * @brief 传输限速（令牌桶）
+ *
+ * 所有上传和下载共用一个限速器，总速率不超过上限，给聊天消息留出带宽。
+ * 上传通过ThrottledBody控制QNetworkAccessManager读取请求体的速度，下载
+ * 通过控制从响应中读取数据的速度（读缓冲满后TCP窗口使服务器放慢发送）。
+ */
+class BandwidthLimiter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BandwidthLimiter(QObject *parent = nullptr);
+
+    // 设置上限（字节/秒），0表示不限速
+    void SetLimit(qint64 nBytesPerSecond);
+    qint64 Limit() const;
+
+    // 申请最多nWanted字节的额度，返回实际可用的字节数（可能为0，不限速时为nWanted）
+    qint64 Acquire(qint64 nWanted);
+
+signals:
+    // 额度用完后重新补充时发出，等待额度的传输据此继续
+    void refilled();
+
+private:
+    qint64 m_nLimit;
+    double m_dTokens;         // 当前可用额度（字节）
+    QElapsedTimer m_clock;
+    qint64 m_nLastRefill;     // 上次补充的时间
+    QTimer m_refillTimer;     // 额度不足时启动
+
+    void Refill();
+};
+
+/**
+ * @brief 限速的HTTP请求体
+ *
+ * 依次由head、源设备中[nOffset, nOffset + nSize)的数据和tail组成，随机访问、
+ * 大小已知，不把文件数据读入内存。额度不足时readData返回0，额度补充后
+ * 发出readyRead，QNetworkAccessManager随即继续读取。
+ */
+class ThrottledBody : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    // pSource由调用方持有，可被多个请求体共用（每次读取前重新定位）
+    ThrottledBody(const QByteArray &head, QIODevice *pSource, qint64 nOffset, qint64 nSize,
+                  const QByteArray &tail, BandwidthLimiter *pLimiter, QObject *parent = nullptr);
+
+    bool isSequential() const override;
+    qint64 size() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QByteArray m_head;
+    QIODevice *m_pSource;
+    qint64 m_nOffset;
+    qint64 m_nSize;
+    QByteArray m_tail;
+    QPointer<BandwidthLimiter> m_pLimiter;
+};
+
+#endif // BANDWIDTHLIMITER_H
@@ -0,0 +1,792 @@
+#include "chatconnection.h"
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QUrl>
+#include <QNetworkRequest>
+#include <QDebug>
+#include <QCborValue>
+#include <QCborArray>
+#include "appconfig.h"
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <algorithm>
+
+ChatConnection *ChatConnection::m_pInstance = nullptr;
+
+// 去重时保留的最近消息ID数
+static const int SEEN_ID_CAPACITY = 1024;
+
+ChatConnectionWorker::ChatConnectionWorker() :
+    QObject(nullptr),
+    m_pSocket(nullptr),
+    m_bClosing(false),
+    m_pReconnectTimer(nullptr),
+    m_nReconnectAttempt(0),
+    m_nLastSeq(0),
+    m_nResumeAfter(0),
+    m_pHeartbeatTimer(nullptr),
+    m_pPongTimer(nullptr),
+    m_nHeartbeatInterval(HEARTBEAT_MIN_INTERVAL),
+    m_nPingSentAt(-1),
+    m_rtt(64),
+    m_bPreferBinary(false),
+    m_bBinary(false),
+    m_bBatchSupported(false),
+    m_nBufferedBytes(0),
+    m_bCongested(false),
+    m_bDrainScheduled(false),
+    m_pAckTimer(nullptr),
+    m_bFlushScheduled(false)
+{
+}
+
+ChatConnectionWorker::~ChatConnectionWorker()
+{
+    delete m_pSocket;
+}
+
+void ChatConnectionWorker::Open(const QString &strUrl, const QString &strSelfId, bool bPreferBinary)
+{
+    if (!strSelfId.isEmpty()) {
+        m_strSelfId = strSelfId;
+    }
+    // 登录期间已提前连接同一服务器：沿用该连接
+    if (m_pSocket && strUrl == m_strUrl && bPreferBinary == m_bPreferBinary
+            && m_pSocket->state() != QAbstractSocket::UnconnectedState) {
+        m_bClosing = false;
+        return;
+    }
+    m_strUrl = strUrl;
+    m_bPreferBinary = bPreferBinary;
+    m_bClosing = false;
+    if (!m_pSocket) {
+        m_clock.start();
+        m_pReconnectTimer = new QTimer(this);
+        m_pReconnectTimer->setSingleShot(true);
+        connect(m_pReconnectTimer, &QTimer::timeout, this, &ChatConnectionWorker::OnReconnectTimeout);
+        m_pHeartbeatTimer = new QTimer(this);
+        m_pHeartbeatTimer->setSingleShot(true);
+        connect(m_pHeartbeatTimer, &QTimer::timeout, this, &ChatConnectionWorker::SendPing);
+        m_pPongTimer = new QTimer(this);
+        m_pPongTimer->setSingleShot(true);
+        connect(m_pPongTimer, &QTimer::timeout, this, &ChatConnectionWorker::OnPongTimeout);
+        m_pAckTimer = new QTimer(this);
+        m_pAckTimer->setInterval(1000);
+        connect(m_pAckTimer, &QTimer::timeout, this, &ChatConnectionWorker::CheckAckTimeouts);
+        m_pAckTimer->start();
+
+        m_pSocket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+        connect(m_pSocket, &QWebSocket::connected, this, &ChatConnectionWorker::OnSocketConnected);
+        connect(m_pSocket, &QWebSocket::disconnected, this, &ChatConnectionWorker::OnSocketDisconnected);
+        connect(m_pSocket, &QWebSocket::bytesWritten, this, &ChatConnectionWorker::OnBytesWritten);
+        connect(m_pSocket, &QWebSocket::textMessageReceived, this,
+                &ChatConnectionWorker::OnTextMessageReceived);
+        connect(m_pSocket, &QWebSocket::binaryMessageReceived, this,
+                &ChatConnectionWorker::OnBinaryMessageReceived);
+        connect(m_pSocket, static_cast<void(QWebSocket::*)(QAbstractSocket::SocketError)>(&QWebSocket::error),
+                this, &ChatConnectionWorker::OnSocketError);
+    }
+    m_pReconnectTimer->stop();
+    OpenSocket();
+}
+
+void ChatConnectionWorker::Close()
+{
+    m_bClosing = true;
+    StopHeartbeat();
+    if (m_pReconnectTimer) {
+        m_pReconnectTimer->stop();
+    }
+    if (m_pSocket && m_pSocket->isValid()) {
+        m_pSocket->close();
+    }
+}
+
+void ChatConnectionWorker::SetToken(const QString &strToken)
+{
+    m_strToken = strToken;
+}
+
+void ChatConnectionWorker::OpenSocket()
+{
+    QNetworkRequest request{QUrl(m_strUrl)};
+    // 令牌不放在URL查询参数中，避免出现在服务器的访问日志里
+    if (!m_strToken.isEmpty()) {
+        request.setRawHeader("Authorization", "Bearer " + m_strToken.toUtf8());
+    }
+    m_pSocket->open(request);
+}
+
+void ChatConnectionWorker::Reconnect(const QString &strUrl)
+{
+    m_strUrl = strUrl;
+    if (!m_pSocket) {
+        // 还未打开过，之后Open时使用新地址
+        return;
+    }
+    m_bClosing = false;
+    // 新服务器的广播序号与旧服务器无关
+    m_strServerEpoch.clear();
+    m_nLastSeq = 0;
+    m_nResumeAfter = 0;
+    if (m_pSocket->state() != QAbstractSocket::UnconnectedState) {
+        // 同步触发OnSocketDisconnected：未确认的消息回到队列，等连上新服务器后重发
+        m_pSocket->abort();
+    }
+    // 不等退避延迟，立即连接新服务器
+    m_pReconnectTimer->stop();
+    m_nReconnectAttempt = 0;
+    qDebug() << "切换WebSocket服务器:" << m_strUrl;
+    OpenSocket();
+}
+
+void ChatConnectionWorker::SetPresence(const UserInfo &userInfo)
+{
+    m_presence = userInfo;
+    if (!userInfo.strUserId.isEmpty()) {
+        m_strSelfId = userInfo.strUserId;
+    }
+    if (m_pSocket && m_pSocket->state() == QAbstractSocket::ConnectedState) {
+        QCborMap onlineObj;
+        onlineObj[QStringLiteral("userphone")] = m_presence.strUserPhone;
+        onlineObj[QStringLiteral("userid")] = m_presence.strUserId;
+        OutboundFrame outbound;
+        outbound.frame[QStringLiteral("online")] = onlineObj;
+        EnqueueFrame(outbound);
+    }
+}
+
+void ChatConnectionWorker::ReconnectNow()
+{
+    // 只在退避等待期间生效，正在连接或已连接时不打断
+    if (m_bClosing || !m_pReconnectTimer || !m_pReconnectTimer->isActive()) {
+        return;
+    }
+    m_pReconnectTimer->stop();
+    OnReconnectTimeout();
+}
+
+void ChatConnectionWorker::ScheduleReconnect()
+{
+    if (m_bClosing || m_pReconnectTimer->isActive()) {
+        return;
+    }
+    // 指数退避：500ms、1s、2s……封顶30s；实际延迟在[上限/2, 上限]之间随机，
+    // 同时断线的客户端因此错开重连时间
+    int nShift = qMin(m_nReconnectAttempt, 16);
+    int nCeiling = static_cast<int>(qMin<qint64>(RECONNECT_MAX_DELAY,
+                                                 static_cast<qint64>(RECONNECT_BASE_DELAY) << nShift));
+    int nDelay = nCeiling / 2 + QRandomGenerator::global()->bounded(nCeiling / 2 + 1);
+    ++m_nReconnectAttempt;
+    m_pReconnectTimer->start(nDelay);
+    emit reconnectScheduled(m_nReconnectAttempt, nDelay);
+}
+
+void ChatConnectionWorker::OnReconnectTimeout()
+{
+    // 已在连接中（如刚切换了服务器）时不重复打开
+    if (m_bClosing || m_pSocket->state() != QAbstractSocket::UnconnectedState) {
+        return;
+    }
+    qDebug() << "WebSocket重连，第" << m_nReconnectAttempt << "次";
+    OpenSocket();
+}
+
+void ChatConnectionWorker::SendPing()
+{
+    if (!m_pSocket || m_pSocket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+    // 超时按近期P99时延的4倍估计，限制在3~10秒
+    qint64 nP99 = m_rtt.Percentile(99);
+    int nTimeout = nP99 < 0 ? PONG_MAX_TIMEOUT
+                            : static_cast<int>(qBound<qint64>(PONG_MIN_TIMEOUT, nP99 * 4, PONG_MAX_TIMEOUT));
+    m_nPingSentAt = m_clock.elapsed();
+    m_pSocket->sendTextMessage(QStringLiteral("ping"));
+    m_pPongTimer->start(nTimeout);
+}
+
+void ChatConnectionWorker::HandlePong()
+{
+    if (m_nPingSentAt < 0) {
+        return;
+    }
+    qint64 nRtt = m_clock.elapsed() - m_nPingSentAt;
+    m_nPingSentAt = -1;
+    m_pPongTimer->stop();
+
+    // 时延突增（超过平均值的2倍）时收紧心跳间隔以便尽快发现断线，否则逐步放宽
+    qint64 nAverage = m_rtt.Average();
+    if (nAverage > 0 && nRtt > nAverage * 2 && nRtt > 100) {
+        m_nHeartbeatInterval = HEARTBEAT_MIN_INTERVAL;
+    } else {
+        m_nHeartbeatInterval = qMin(m_nHeartbeatInterval * 2, HEARTBEAT_MAX_INTERVAL);
+    }
+    m_rtt.AddSample(nRtt);
+    emit rttMeasured(nRtt);
+    m_pHeartbeatTimer->start(m_nHeartbeatInterval);
+}
+
+void ChatConnectionWorker::OnPongTimeout()
+{
+    // 比等待操作系统判定TCP断开快得多
+    qDebug() << "心跳超时，连接已不可用，重新连接";
+    m_nPingSentAt = -1;
+    m_pSocket->abort();
+}
+
+void ChatConnectionWorker::StopHeartbeat()
+{
+    if (m_pHeartbeatTimer) {
+        m_pHeartbeatTimer->stop();
+        m_pPongTimer->stop();
+    }
+    m_nPingSentAt = -1;
+}
+
+void ChatConnectionWorker::SendMessage(const QString &strPeerId, const MsgInfo &msgInfo)
+{
+    QCborMap msgObj;
+    msgObj[QStringLiteral("userphone")] = msgInfo.strUserPhone;
+    msgObj[QStringLiteral("userid")] = msgInfo.strUserId;
+    msgObj[QStringLiteral("message")] = msgInfo.strContent;
+    msgObj[QStringLiteral("filelink")] = msgInfo.fileLink;
+    msgObj[QStringLiteral("time")] = msgInfo.strTime;
+    msgObj[QStringLiteral("clientmsgid")] = msgInfo.strClientMsgId;
+
+    OutboundFrame outbound;
+    // 公共消息以"message"为键，私聊消息以对方用户ID为键
+    outbound.frame[strPeerId] = msgObj;
+    outbound.strClientMsgId = msgInfo.strClientMsgId;
+    outbound.strPeerId = strPeerId;
+    EnqueueFrame(outbound);
+}
+
+void ChatConnectionWorker::EnqueueFrame(const OutboundFrame &outbound)
+{
+    OutboundFrame queued = outbound;
+    queued.nQueuedAt = m_clock.isValid() ? m_clock.elapsed() : 0;
+    queued.nSentAt = -1;
+    queued.nResends = 0;
+    m_queueOutbound.enqueue(queued);
+    // 同一轮事件循环中提交的消息一起发送，才有机会合并为批量帧
+    if (!m_bDrainScheduled) {
+        m_bDrainScheduled = true;
+        QMetaObject::invokeMethod(this, "DrainOutbound", Qt::QueuedConnection);
+    }
+}
+
+void ChatConnectionWorker::DrainOutbound()
+{
+    m_bDrainScheduled = false;
+    // 未连接时消息留在队列中，连接后再发
+    if (!m_pSocket || m_pSocket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+    while (!m_queueOutbound.isEmpty() && !m_bCongested) {
+        QVector<OutboundFrame> vecTaken;
+        int nMax = m_bBatchSupported ? OUTBOUND_BATCH_MAX : 1;
+        while (!m_queueOutbound.isEmpty() && vecTaken.size() < nMax) {
+            vecTaken.append(m_queueOutbound.dequeue());
+        }
+
+        qint64 nWritten = 0;
+        if (vecTaken.size() == 1) {
+            nWritten = WriteFrame(vecTaken.first().frame);
+        } else {
+            // 多条消息合并为一个批量帧，由服务器拆开后分别广播
+            QCborArray batch;
+            for (const OutboundFrame &outbound : vecTaken) {
+                batch.append(outbound.frame);
+            }
+            QCborMap frame;
+            frame[QStringLiteral("batch")] = batch;
+            nWritten = WriteFrame(frame);
+        }
+        m_nBufferedBytes += nWritten;
+
+        // 聊天消息等待服务器回显确认
+        qint64 nNow = m_clock.elapsed();
+        for (OutboundFrame &outbound : vecTaken) {
+            if (!outbound.strClientMsgId.isEmpty()) {
+                outbound.nSentAt = nNow;
+                m_hashInFlight.insert(outbound.strClientMsgId, outbound);
+            }
+        }
+        UpdateCongestion();
+    }
+}
+
+qint64 ChatConnectionWorker::WriteFrame(const QCborMap &frame)
+{
+    if (m_bBinary) {
+        return m_pSocket->sendBinaryMessage(QCborValue(frame).toCbor());
+    }
+    return m_pSocket->sendTextMessage(QJsonDocument(frame.toJsonObject()).toJson(QJsonDocument::Compact));
+}
+
+void ChatConnectionWorker::OnBytesWritten(qint64 nBytes)
+{
+    // 帧头也计入bytesWritten，因此可能略多于记录值
+    m_nBufferedBytes = qMax<qint64>(0, m_nBufferedBytes - nBytes);
+    UpdateCongestion();
+    if (!m_bCongested && !m_queueOutbound.isEmpty() && !m_bDrainScheduled) {
+        m_bDrainScheduled = true;
+        QMetaObject::invokeMethod(this, "DrainOutbound", Qt::QueuedConnection);
+    }
+}
+
+void ChatConnectionWorker::UpdateCongestion()
+{
+    bool bCongested = m_bCongested;
+    if (m_nBufferedBytes >= OUTBOUND_HIGH_WATERMARK) {
+        bCongested = true;
+    } else if (m_nBufferedBytes <= OUTBOUND_LOW_WATERMARK) {
+        bCongested = false;
+    }
+    if (bCongested != m_bCongested) {
+        m_bCongested = bCongested;
+        emit congestionChanged(m_bCongested);
+    }
+}
+
+void ChatConnectionWorker::CheckAckTimeouts()
+{
+    qint64 nNow = m_clock.elapsed();
+    bool bResend = false;
+    for (auto it = m_hashInFlight.begin(); it != m_hashInFlight.end(); ) {
+        if (nNow - it.value().nSentAt < SEND_ACK_TIMEOUT) {
+            ++it;
+            continue;
+        }
+        OutboundFrame outbound = it.value();
+        it = m_hashInFlight.erase(it);
+        if (outbound.nResends < SEND_RESEND_MAX) {
+            // 回显可能丢了，也可能只是慢：原样重发（接收端按ID去重），保留提交时间和顺序
+            ++outbound.nResends;
+            m_queueOutbound.enqueue(outbound);
+            bResend = true;
+            continue;
+        }
+        ChatEvent event;
+        event.eType = CHAT_EVENT_MESSAGE_FAILED;
+        event.strPeerId = outbound.strPeerId;
+        event.msgInfo.strClientMsgId = outbound.strClientMsgId;
+        QueueEvent(event);
+        // 服务器可能已经送达，只是回显来得晚：记下ID，收到回显时改为已送达
+        m_hashTimedOut.insert(outbound.strClientMsgId, outbound.strPeerId);
+        m_queueTimedOut.enqueue(outbound.strClientMsgId);
+        if (m_queueTimedOut.size() > SEND_TIMED_OUT_MAX) {
+            m_hashTimedOut.remove(m_queueTimedOut.dequeue());
+        }
+    }
+    if (bResend && !m_bDrainScheduled) {
+        m_bDrainScheduled = true;
+        QMetaObject::invokeMethod(this, "DrainOutbound", Qt::QueuedConnection);
+    }
+}
+
+void ChatConnectionWorker::OnSocketConnected()
+{
+    // 新连接总是先用JSON，收到服务器的协商应答后再切换格式、启用批量帧
+    m_bBinary = false;
+    m_bBatchSupported = false;
+    m_nBufferedBytes = 0;
+    m_nReconnectAttempt = 0;
+    QCborMap helloObj;
+    helloObj[QStringLiteral("format")] = m_bPreferBinary ? QStringLiteral("cbor") : QStringLiteral("json");
+    // 重连时带上断线时的广播序号：服务器补发错过的消息后才开始推送新消息，
+    // 不会因为先收到新消息而跳过断线期间的消息
+    if (!m_strServerEpoch.isEmpty() && m_nResumeAfter > 0) {
+        QCborMap resumeObj;
+        resumeObj[QStringLiteral("epoch")] = m_strServerEpoch;
+        resumeObj[QStringLiteral("after")] = m_nResumeAfter;
+        helloObj[QStringLiteral("resume")] = resumeObj;
+        qDebug() << "请求补发序号" << m_nResumeAfter << "之后的消息";
+    }
+    QCborMap helloFrame;
+    helloFrame[QStringLiteral("hello")] = helloObj;
+    m_nBufferedBytes += WriteFrame(helloFrame);
+    // 每次连上只通告一次上线，排在断线期间积攒的消息之前
+    if (!m_presence.strUserId.isEmpty()) {
+        QCborMap onlineObj;
+        onlineObj[QStringLiteral("userphone")] = m_presence.strUserPhone;
+        onlineObj[QStringLiteral("userid")] = m_presence.strUserId;
+        QCborMap frame;
+        frame[QStringLiteral("online")] = onlineObj;
+        m_nBufferedBytes += WriteFrame(frame);
+    }
+    emit connected();
+    // 发送断线期间积攒的消息
+    DrainOutbound();
+    // 新连接从最短间隔开始心跳，尽快得到时延样本
+    m_nHeartbeatInterval = HEARTBEAT_MIN_INTERVAL;
+    m_nPingSentAt = -1;
+    SendPing();
+}
+
+void ChatConnectionWorker::OnSocketDisconnected()
+{
+    StopHeartbeat();
+    // 记下补发位置，重连时在hello中请求补发此后的消息
+    m_nResumeAfter = m_nLastSeq;
+    // 未确认的消息按提交顺序回到队列前端，重连后重发（接收端按ID去重）
+    QList<OutboundFrame> listUnacked = m_hashInFlight.values();
+    std::sort(listUnacked.begin(), listUnacked.end(), [](const OutboundFrame &a, const OutboundFrame &b) {
+        return a.nQueuedAt < b.nQueuedAt;
+    });
+    m_hashInFlight.clear();
+    for (int i = listUnacked.size() - 1; i >= 0; --i) {
+        m_queueOutbound.prepend(listUnacked[i]);
+    }
+    m_nBufferedBytes = 0;
+    UpdateCongestion();
+    emit disconnected();
+    // 连接失败和意外断开都会到这里
+    ScheduleReconnect();
+}
+
+void ChatConnectionWorker::OnTextMessageReceived(const QString &strMsg)
+{
+    if (strMsg == QLatin1String("pong")) {
+        HandlePong();
+        return;
+    }
+    QJsonParseError err;
+    // 解析消息为Json
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(strMsg.toUtf8(), &err);
+    if (err.error != QJsonParseError::NoError) {
+        qDebug() << "解析消息失败:" << err.error;
+        return;
+    }
+    QJsonObject jsonObj = jsonDoc.object();
+    if (jsonObj.contains("helloack")) {
+        HandleHelloAck(jsonObj["helloack"].toObject());
+        return;
+    }
+    HandleFrame(QCborMap::fromJsonObject(jsonObj));
+}
+
+void ChatConnectionWorker::OnBinaryMessageReceived(const QByteArray &data)
+{
+    QCborParserError err;
+    QCborValue frame = QCborValue::fromCbor(data, &err);
+    if (err.error != QCborError::NoError || !frame.isMap()) {
+        qDebug() << "解析二进制消息失败:" << err.errorString();
+        return;
+    }
+    HandleFrame(frame.toMap());
+}
+
+void ChatConnectionWorker::HandleHelloAck(const QJsonObject &ackObj)
+{
+    // 协商应答：服务器同意后此连接改用CBOR二进制帧，并可以发送批量帧
+    m_bBinary = ackObj["format"].toString() == "cbor";
+    m_bBatchSupported = ackObj["batch"].toBool();
+    qDebug() << "消息帧格式:" << (m_bBinary ? "CBOR" : "JSON") << "批量发送:" << m_bBatchSupported;
+
+    // 服务器重启后序号重新计数，补发请求已被忽略，从新进程的序号开始记录
+    QString strEpoch = ackObj["epoch"].toString();
+    if (strEpoch != m_strServerEpoch) {
+        m_nLastSeq = 0;
+        m_nResumeAfter = 0;
+    }
+    m_strServerEpoch = strEpoch;
+}
+
+void ChatConnectionWorker::HandleFrame(const QCborMap &frame)
+{
+    // 广播序号，重连时据此请求补发
+    qint64 nSeq = frame.value(QStringLiteral("seq")).toInteger(-1);
+    if (nSeq > m_nLastSeq) {
+        m_nLastSeq = nSeq;
+    }
+    if (AcknowledgeFrame(frame)) {
+        return;
+    }
+    ChatEvent event;
+    if (DecodeFrame(frame, &event)) {
+        QueueEvent(event);
+    }
+}
+
+bool ChatConnectionWorker::AcknowledgeFrame(const QCborMap &frame)
+{
+    if (m_hashInFlight.isEmpty() && m_hashTimedOut.isEmpty()) {
+        return false;
+    }
+    // 消息体是顶层唯一的map（另有seq等标量字段）
+    QString strClientMsgId;
+    for (auto it = frame.constBegin(); it != frame.constEnd(); ++it) {
+        if (it.value().isMap()) {
+            strClientMsgId = it.value().toMap().value(QStringLiteral("clientmsgid")).toString();
+            break;
+        }
+    }
+    if (strClientMsgId.isEmpty()) {
+        return false;
+    }
+    ChatEvent event;
+    event.eType = CHAT_EVENT_MESSAGE_ACKED;
+    event.msgInfo.strClientMsgId = strClientMsgId;
+    auto it = m_hashInFlight.find(strClientMsgId);
+    if (it != m_hashInFlight.end()) {
+        qint64 nLatency = m_clock.elapsed() - it.value().nQueuedAt;
+        event.strPeerId = it.value().strPeerId;
+        m_hashInFlight.erase(it);
+        QueueEvent(event);
+        emit sendLatencyMeasured(nLatency);
+        return true;
+    }
+    // 已标记发送失败的消息迟到的回显（延迟已无参考意义，不计入统计）
+    auto itTimedOut = m_hashTimedOut.find(strClientMsgId);
+    if (itTimedOut == m_hashTimedOut.end()) {
+        return false;
+    }
+    event.strPeerId = itTimedOut.value();
+    m_hashTimedOut.erase(itTimedOut);
+    m_queueTimedOut.removeOne(strClientMsgId);
+    QueueEvent(event);
+    return true;
+}
+
+void ChatConnectionWorker::OnSocketError(QAbstractSocket::SocketError err)
+{
+    emit errorOccurred(err, m_pSocket->errorString());
+}
+
+void ChatConnectionWorker::QueueEvent(const ChatEvent &event)
+{
+    m_vecPending.append(event);
+    // 等本轮已到达的帧都解析完再一起交给界面线程
+    if (!m_bFlushScheduled) {
+        m_bFlushScheduled = true;
+        QMetaObject::invokeMethod(this, "FlushEvents", Qt::QueuedConnection);
+    }
+}
+
+void ChatConnectionWorker::FlushEvents()
+{
+    m_bFlushScheduled = false;
+    if (m_vecPending.isEmpty()) {
+        return;
+    }
+    QVector<ChatEvent> vecEvents;
+    vecEvents.swap(m_vecPending);
+    emit eventsReceived(vecEvents);
+}
+
+bool ChatConnectionWorker::MarkMessageSeen(const QString &strClientMsgId)
+{
+    if (strClientMsgId.isEmpty()) {
+        return true;
+    }
+    if (m_setSeenIds.contains(strClientMsgId)) {
+        return false;
+    }
+    m_setSeenIds.insert(strClientMsgId);
+    m_queueSeenIds.enqueue(strClientMsgId);
+    if (m_queueSeenIds.size() > SEEN_ID_CAPACITY) {
+        m_setSeenIds.remove(m_queueSeenIds.dequeue());
+    }
+    return true;
+}
+
+bool ChatConnectionWorker::DecodeFrame(const QCborMap &frame, ChatEvent *pEvent)
+{
+    QCborMap msgObj;
+    if (frame.contains(GROUP_CONVERSATION_ID)) {
+        // 公共消息，忽略自己发的消息（服务器会回显给所有人）
+        msgObj = frame.value(GROUP_CONVERSATION_ID).toMap();
+        if (msgObj.value(QStringLiteral("userid")).toString() == m_strSelfId) {
+            return false;
+        }
+        pEvent->eType = CHAT_EVENT_GROUP_MESSAGE;
+    } else if (frame.contains(QStringLiteral("online"))) {
+        // 用户上线
+        QCborMap onlineObj = frame.value(QStringLiteral("online")).toMap();
+        pEvent->eType = CHAT_EVENT_ONLINE;
+        pEvent->userInfo.strUserId = onlineObj.value(QStringLiteral("userid")).toString();
+        pEvent->userInfo.strUserPhone = onlineObj.value(QStringLiteral("userphone")).toString();
+        return true;
+    } else if (!m_strSelfId.isEmpty() && frame.contains(m_strSelfId)) {
+        // 发给自己的私聊消息
+        msgObj = frame.value(m_strSelfId).toMap();
+        pEvent->eType = CHAT_EVENT_PRIVATE_MESSAGE;
+    } else {
+        // 其他用户之间的私聊消息、未协商服务器回显的hello等
+        return false;
+    }
+
+    // 对方断线重发的消息可能已经收到过
+    if (!MarkMessageSeen(msgObj.value(QStringLiteral("clientmsgid")).toString())) {
+        return false;
+    }
+    pEvent->msgInfo.strUserId = msgObj.value(QStringLiteral("userid")).toString();
+    pEvent->msgInfo.strUserPhone = msgObj.value(QStringLiteral("userphone")).toString();
+    pEvent->msgInfo.strContent = msgObj.value(QStringLiteral("message")).toString();
+    pEvent->msgInfo.strTime = msgObj.value(QStringLiteral("time")).toString();
+    pEvent->msgInfo.fileLink = msgObj.value(QStringLiteral("filelink")).toString();
+    return true;
+}
+
+ChatConnection::ChatConnection(QObject *parent) :
+    QObject(parent),
+    m_pWorker(nullptr),
+    m_bConnected(false),
+    m_bHoldEvents(false),
+    m_bCongested(false),
+    m_nNextMsgId(0)
+{
+    qRegisterMetaType<MsgInfo>("MsgInfo");
+    qRegisterMetaType<UserInfo>("UserInfo");
+    qRegisterMetaType<QVector<ChatEvent>>("QVector<ChatEvent>");
+    qRegisterMetaType<QAbstractSocket::SocketError>("QAbstractSocket::SocketError");
+
+    m_pWorker = new ChatConnectionWorker();
+    m_pWorker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_pWorker, &QObject::deleteLater);
+    connect(this, &ChatConnection::openRequested, m_pWorker, &ChatConnectionWorker::Open);
+    connect(this, &ChatConnection::closeRequested, m_pWorker, &ChatConnectionWorker::Close);
+    connect(this, &ChatConnection::tokenChanged, m_pWorker, &ChatConnectionWorker::SetToken);
+    connect(this, &ChatConnection::reconnectRequested, m_pWorker, &ChatConnectionWorker::Reconnect);
+    connect(this, &ChatConnection::messageSendRequested, m_pWorker, &ChatConnectionWorker::SendMessage);
+    connect(this, &ChatConnection::presenceChanged, m_pWorker, &ChatConnectionWorker::SetPresence);
+    connect(this, &ChatConnection::reconnectNowRequested, m_pWorker, &ChatConnectionWorker::ReconnectNow);
+    // 网络恢复时跳过退避等待，立即重连
+    connect(&m_networkManager, &QNetworkConfigurationManager::onlineStateChanged, this, [this](bool bOnline) {
+        if (bOnline) {
+            emit reconnectNowRequested();
+        }
+    });
+
+    // 连接状态在界面线程中维护，再转发给界面
+    connect(m_pWorker, &ChatConnectionWorker::connected, this, [this]() {
+        m_bConnected = true;
+        emit connected();
+    });
+    connect(m_pWorker, &ChatConnectionWorker::disconnected, this, [this]() {
+        m_bConnected = false;
+        emit disconnected();
+    });
+    connect(m_pWorker, &ChatConnectionWorker::congestionChanged, this, [this](bool bCongested) {
+        m_bCongested = bCongested;
+        emit congestionChanged(bCongested);
+    });
+    connect(m_pWorker, &ChatConnectionWorker::sendLatencyMeasured, this, [this](qint64 nMs) {
+        m_sendLatency.AddSample(nMs);
+        emit sendLatencyMeasured(nMs);
+    });
+    connect(m_pWorker, &ChatConnectionWorker::errorOccurred, this, &ChatConnection::errorOccurred);
+    connect(m_pWorker, &ChatConnectionWorker::reconnectScheduled, this, &ChatConnection::reconnectScheduled);
+    connect(m_pWorker, &ChatConnectionWorker::rttMeasured, this, [this](qint64 nMs) {
+        m_rtt.AddSample(nMs);
+        emit rttMeasured(nMs);
+    });
+    // 切换服务器（修改配置或故障转移）时立即重连；会话令牌更新后，之后的重连带上新令牌
+    AppConfig *pConfig = AppConfig::GetInstance();
+    connect(pConfig, &AppConfig::endpointChanged, this, [this, pConfig]() {
+        Reconnect(pConfig->WebSocketUrl());
+    });
+    connect(pConfig, &AppConfig::sessionChanged, this, [this, pConfig]() {
+        SetToken(pConfig->SessionToken());
+    });
+    connect(m_pWorker, &ChatConnectionWorker::eventsReceived, this, [this](const QVector<ChatEvent> &vecEvents) {
+        if (m_bHoldEvents) {
+            // 登录对话框长时间打开时只保留最近的事件
+            m_vecHeldEvents += vecEvents;
+            if (m_vecHeldEvents.size() > HELD_EVENTS_MAX) {
+                m_vecHeldEvents.remove(0, m_vecHeldEvents.size() - HELD_EVENTS_MAX);
+            }
+        } else {
+            emit eventsReceived(vecEvents);
+        }
+    });
+    m_thread.start();
+}
+
+ChatConnection::~ChatConnection()
+{
+    // 在网络线程中关闭套接字，再退出线程
+    QMetaObject::invokeMethod(m_pWorker, "Close", Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void ChatConnection::DestroyInstance()
+{
+    delete m_pInstance;
+    m_pInstance = nullptr;
+}
+
+void ChatConnection::Open(const QString &strUrl)
+{
+    // 与连接请求按顺序送达网络线程，首次连接即带上保存的令牌
+    emit tokenChanged(AppConfig::GetInstance()->SessionToken());
+    emit openRequested(strUrl, g_stUserInfo.strUserId, AppConfig::GetInstance()->BinaryFormat());
+}
+
+void ChatConnection::Close()
+{
+    emit closeRequested();
+}
+
+void ChatConnection::SetToken(const QString &strToken)
+{
+    emit tokenChanged(strToken);
+}
+
+void ChatConnection::Reconnect(const QString &strUrl)
+{
+    emit reconnectRequested(strUrl);
+}
+
+QString ChatConnection::SendMessage(const QString &strPeerId, const MsgInfo &msgInfo)
+{
+    // 用户ID + 启动时间 + 序号，重启后也不会与之前的消息重复
+    static const QString strSession = QString::number(QDateTime::currentMSecsSinceEpoch(), 36);
+    MsgInfo outMsgInfo = msgInfo;
+    outMsgInfo.strClientMsgId = QString("%1-%2-%3").arg(g_stUserInfo.strUserId).arg(strSession).arg(++m_nNextMsgId);
+    emit messageSendRequested(strPeerId, outMsgInfo);
+    return outMsgInfo.strClientMsgId;
+}
+
+void ChatConnection::SetPresence(const UserInfo &userInfo)
+{
+    emit presenceChanged(userInfo);
+}
+
+void ChatConnection::ReconnectNow()
+{
+    emit reconnectNowRequested();
+}
+
+void ChatConnection::HoldEvents(bool bHold)
+{
+    m_bHoldEvents = bHold;
+    if (!bHold && !m_vecHeldEvents.isEmpty()) {
+        QVector<ChatEvent> vecEvents;
+        vecEvents.swap(m_vecHeldEvents);
+        emit eventsReceived(vecEvents);
+    }
+}
+
+bool ChatConnection::IsConnected() const
+{
+    return m_bConnected;
+}
+
+bool ChatConnection::IsCongested() const
+{
+    return m_bCongested;
+}
+
+const LatencyStats &ChatConnection::SendLatency() const
+{
+    return m_sendLatency;
+}
+
+const LatencyStats &ChatConnection::RoundTripTime() const
+{
+    return m_rtt;
+}
@@ -0,0 +1,298 @@
+#ifndef CHATCONNECTION_H
+#define CHATCONNECTION_H
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QWebSocket>
+#include <QCborMap>
+#include <QJsonObject>
+#include <QQueue>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QNetworkConfigurationManager>
+#include "common.h"
+#include "latencystats.h"
+
+// 服务器推送事件类型
+enum ChatEventType {
+    CHAT_EVENT_GROUP_MESSAGE,    // 公共消息
+    CHAT_EVENT_PRIVATE_MESSAGE,  // 发给当前用户的私聊消息
+    CHAT_EVENT_ONLINE,           // 用户上线
+    CHAT_EVENT_MESSAGE_ACKED,    // 本端发出的消息已被服务器回显确认
+    CHAT_EVENT_MESSAGE_FAILED    // 本端发出的消息超时未确认
+};
+
+// 发送队列参数
+const qint64 OUTBOUND_HIGH_WATERMARK = 256 * 1024;  // 套接字待写字节数达到此值时暂停发送
+const qint64 OUTBOUND_LOW_WATERMARK = 64 * 1024;    // 降到此值以下时恢复发送
+const int OUTBOUND_BATCH_MAX = 32;                   // 一个批量帧最多合并的消息数
+const int SEND_ACK_TIMEOUT = 15000;                  // 发出后等待确认的超时（毫秒）
+const int SEND_RESEND_MAX = 2;                       // 超时未确认时自动重发的次数（之后标记为发送失败）
+const int SEND_TIMED_OUT_MAX = 256;                  // 保留的发送失败消息ID数（迟到的回显仍可确认）
+const int HELD_EVENTS_MAX = 5 * MESSAGE_PAGE_SIZE;   // 聊天窗口创建前最多暂存的事件数（超出时丢弃最早的）
+
+// 重连参数
+const int RECONNECT_BASE_DELAY = 500;       // 第一次重连的基准延迟（毫秒）
+const int RECONNECT_MAX_DELAY = 30000;      // 重连延迟上限（毫秒）
+
+// 心跳参数（服务器60秒收不到任何消息即断开）
+const int HEARTBEAT_MIN_INTERVAL = 5000;    // 连上后和延迟波动时的心跳间隔（毫秒）
+const int HEARTBEAT_MAX_INTERVAL = 25000;   // 连接稳定时逐步放宽到的心跳间隔（毫秒）
+const int PONG_MIN_TIMEOUT = 3000;          // 等待pong的最短超时（毫秒）
+const int PONG_MAX_TIMEOUT = 10000;         // 等待pong的最长超时（毫秒）
+
+/**
+ * @brief 解码后的服务器推送事件（在网络线程中由消息帧解析得到）
+ */
+typedef struct _ChatEvent {
+    ChatEventType eType;   // 事件类型
+    MsgInfo msgInfo;       // 聊天消息（公共/私聊消息有效，私聊对方为msgInfo.strUserId）
+    UserInfo userInfo;     // 上线用户（上线事件有效）
+    QString strPeerId;     // 所属会话（确认/失败事件有效，msgInfo.strClientMsgId为消息ID）
+} ChatEvent, *PChatEvent;
+Q_DECLARE_METATYPE(ChatEvent)
+
+/**
+ * @brief WebSocket工作对象（运行在ChatConnection的网络线程中）
+ *
+ * 拥有QWebSocket，负责消息帧的编码和解析。同一轮事件循环中收到的多个帧
+ * 解析后合并成一批，通过一次排队信号交给界面线程。
+ *
+ * 连接建立后发送 {"hello":{"format":"cbor"}} 协商二进制格式，收到服务器的
+ * {"helloack":{"format":"cbor"}} 后改用CBOR二进制帧收发；在此之前（以及服务器
+ * 不支持协商时）使用JSON文本帧。两种格式的消息内容和键完全一致。
+ *
+ * 发出的消息先进入发送队列，按套接字待写字节数做高低水位背压；服务器支持时
+ * 同一轮排队的多条消息合并为一个 {"batch":[...]} 帧。每条聊天消息带clientmsgid，
+ * 服务器回显给自己时即确认送达，同时得到端到端的发送延迟；断线时未确认的消息
+ * 回到队列重发，超时未确认的消息自动重发SEND_RESEND_MAX次后才标记为发送失败，
+ * 之后迟到的回显仍会改为已送达；接收端按clientmsgid去重。
+ *
+ * 非主动断开时按指数退避加随机抖动重连（上限30秒），避免服务器重启后所有客户端
+ * 同时涌入；网络恢复时立即重连。每次连上后自动发送一次上线通知，并在hello中
+ * 带上断线时的广播序号（seq），服务器补发断线期间错过的消息后才推送新消息。
+ *
+ * 连上后定时发送"ping"文本帧（服务器回复"pong"并刷新60秒读超时），每个pong
+ * 得到一次往返时延。连接稳定时心跳间隔逐步放宽到25秒，时延突增时收紧到5秒；
+ * pong超时（按近期P99时延自适应）即判定连接已死，主动断开并进入重连。
+ */
+class ChatConnectionWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    ChatConnectionWorker();
+    ~ChatConnectionWorker();
+
+public slots:
+    // 连接服务器，strSelfId用于识别发给自己的私聊消息和自己的公共消息回显，
+    // bPreferBinary为true时尝试协商CBOR二进制帧。已连接或正在连接同一地址时不重新连接
+    void Open(const QString &strUrl, const QString &strSelfId, bool bPreferBinary);
+    // 主动断开连接（不再重连）
+    void Close();
+    // 更新之后连接使用的会话令牌（放在握手请求头中），不断开当前连接
+    void SetToken(const QString &strToken);
+    // 断开当前连接并立即连接新地址（切换服务器），未发出和未确认的消息发往新服务器
+    void Reconnect(const QString &strUrl);
+    // 发送聊天消息，strPeerId为GROUP_CONVERSATION_ID时为公共消息
+    void SendMessage(const QString &strPeerId, const MsgInfo &msgInfo);
+    // 设置上线信息，每次连上后自动发送（登录前先连接时，登录后再设置当前用户ID）
+    void SetPresence(const UserInfo &userInfo);
+    // 正在等待重连时立即重连（网络恢复）
+    void ReconnectNow();
+
+signals:
+    void connected();
+    void disconnected();
+    void errorOccurred(QAbstractSocket::SocketError err, const QString &strError);
+    void eventsReceived(const QVector<ChatEvent> &vecEvents);
+    // 一条消息从提交发送到收到确认的耗时
+    void sendLatencyMeasured(qint64 nMs);
+    // 发送拥塞状态变化（待写数据超过高水位）
+    void congestionChanged(bool bCongested);
+    // 已安排第nAttempt次重连，nDelayMs毫秒后进行
+    void reconnectScheduled(int nAttempt, int nDelayMs);
+    // 一次心跳的往返时延
+    void rttMeasured(qint64 nMs);
+
+private slots:
+    void OnSocketConnected();
+    void OnSocketDisconnected();
+    void OnBytesWritten(qint64 nBytes);
+    // 把发送队列写入套接字，直到队列为空或达到高水位
+    void DrainOutbound();
+    // 检查超时未确认的消息
+    void CheckAckTimeouts();
+    // 重连定时器到期
+    void OnReconnectTimeout();
+    // 发送心跳
+    void SendPing();
+    // 等待pong超时：连接已不可用
+    void OnPongTimeout();
+    void OnTextMessageReceived(const QString &strMsg);
+    void OnBinaryMessageReceived(const QByteArray &data);
+    void OnSocketError(QAbstractSocket::SocketError err);
+    // 把本轮解析出的事件一次性交给界面线程
+    void FlushEvents();
+
+private:
+    // 待发送的消息帧
+    typedef struct _OutboundFrame {
+        QCborMap frame;             // 完整的消息帧
+        QString strClientMsgId;     // 客户端消息ID（聊天消息有值）
+        QString strPeerId;          // 所属会话
+        qint64 nQueuedAt;           // 提交发送的时间
+        qint64 nSentAt;             // 写入套接字的时间
+        int nResends;               // 超时后已重发的次数
+    } OutboundFrame;
+
+    // 消息帧加入发送队列
+    void EnqueueFrame(const OutboundFrame &outbound);
+    // 按协商的格式写出一个消息帧，返回写入的字节数
+    qint64 WriteFrame(const QCborMap &frame);
+    // 更新拥塞状态（高低水位）
+    void UpdateCongestion();
+    // 处理服务器消息帧（JSON和CBOR解码后共用）
+    void HandleFrame(const QCborMap &frame);
+    // 本端消息的回显：确认送达并返回true
+    bool AcknowledgeFrame(const QCborMap &frame);
+    // 处理协商应答，必要时请求补发
+    void HandleHelloAck(const QJsonObject &ackObj);
+    // 按退避策略安排下一次重连
+    void ScheduleReconnect();
+    // 连接m_strUrl，会话令牌放在握手请求的Authorization头中
+    void OpenSocket();
+    // 收到pong：记录时延，调整心跳间隔
+    void HandlePong();
+    // 停止心跳
+    void StopHeartbeat();
+    // 解析一个消息帧，无法识别或应忽略的帧返回false
+    bool DecodeFrame(const QCborMap &frame, ChatEvent *pEvent);
+    // 收到一个解码好的事件
+    void QueueEvent(const ChatEvent &event);
+    // 记录收到的消息ID，重复的返回false
+    bool MarkMessageSeen(const QString &strClientMsgId);
+
+    QWebSocket *m_pSocket;          // 在网络线程中创建和使用
+    QString m_strUrl;               // 服务器地址
+    QString m_strToken;             // 会话令牌（没有时不带Authorization头）
+    QString m_strSelfId;            // 当前用户ID
+    UserInfo m_presence;            // 上线信息
+    bool m_bClosing;                // 是否为主动断开（不重连）
+    QTimer *m_pReconnectTimer;      // 重连定时器
+    int m_nReconnectAttempt;        // 连续重连次数（连上后清零）
+    QString m_strServerEpoch;       // 服务器进程标识（重启后变化，序号随之重新计数）
+    qint64 m_nLastSeq;              // 收到的最大广播序号
+    qint64 m_nResumeAfter;          // 断线时的广播序号，重连后请求补发此后的消息
+    QTimer *m_pHeartbeatTimer;      // 心跳定时器
+    QTimer *m_pPongTimer;           // pong超时定时器
+    int m_nHeartbeatInterval;       // 当前心跳间隔
+    qint64 m_nPingSentAt;           // 未收到pong的心跳发送时间，-1表示没有
+    LatencyStats m_rtt;             // 往返时延（网络线程，用于自适应）
+    bool m_bPreferBinary;           // 是否尝试协商二进制格式
+    bool m_bBinary;                 // 当前连接是否已协商为CBOR二进制帧
+    bool m_bBatchSupported;         // 服务器是否支持批量帧
+    QQueue<OutboundFrame> m_queueOutbound;       // 发送队列
+    QHash<QString, OutboundFrame> m_hashInFlight; // 已写出、等待确认的消息
+    QHash<QString, QString> m_hashTimedOut;      // 已标记发送失败的消息ID -> 所属会话（回显迟到时改为已送达）
+    QQueue<QString> m_queueTimedOut;             // 按标记顺序淘汰
+    qint64 m_nBufferedBytes;        // 已写出但套接字尚未发完的字节数
+    bool m_bCongested;              // 是否处于拥塞（暂停发送）
+    bool m_bDrainScheduled;         // 是否已安排DrainOutbound
+    QElapsedTimer m_clock;          // 发送延迟计时
+    QTimer *m_pAckTimer;            // 确认超时检查
+    QSet<QString> m_setSeenIds;     // 最近收到的消息ID（去重）
+    QQueue<QString> m_queueSeenIds; // 按收到顺序淘汰
+    QVector<ChatEvent> m_vecPending; // 待交给界面线程的事件
+    bool m_bFlushScheduled;         // 是否已安排FlushEvents
+};
+
+/**
+ * @brief 聊天服务器连接（界面线程的入口，全局唯一）
+ *
+ * WebSocket读写和消息帧编解码都在独立的网络线程中进行，界面线程只收到
+ * 解码好的事件批次，消息到达速率再高也不会阻塞输入和绘制。
+ *
+ * 启动时在登录的同时就开始连接（此时还没有上线信息），登录成功后SetPresence
+ * 通告上线。聊天窗口创建前收到的事件由HoldEvents暂存，创建后一次交出。
+ */
+class ChatConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ChatConnection *GetInstance() {
+        if (m_pInstance == nullptr) {
+            m_pInstance = new ChatConnection();
+        }
+        return m_pInstance;
+    }
+    // 退出前释放连接和网络线程
+    static void DestroyInstance();
+    ~ChatConnection();
+
+    // 连接服务器
+    void Open(const QString &strUrl);
+    // 断开连接
+    void Close();
+    // 更新重连使用的会话令牌，不断开当前连接
+    void SetToken(const QString &strToken);
+    // 切换到新的服务器地址：断开旧连接后立即连接，会话和消息记录不受影响
+    void Reconnect(const QString &strUrl);
+    // 发送聊天消息，strPeerId为GROUP_CONVERSATION_ID时为公共消息。
+    // 返回分配的客户端消息ID，确认/失败时通过eventsReceived通知
+    QString SendMessage(const QString &strPeerId, const MsgInfo &msgInfo);
+    // 设置上线信息，每次连上（包括重连）后自动发送一次
+    void SetPresence(const UserInfo &userInfo);
+    // 正在等待重连时立即重连（如重新登录后）
+    void ReconnectNow();
+    // bHold为true时暂存收到的事件，改为false时一次性发出暂存的事件
+    void HoldEvents(bool bHold);
+    // 是否已连接
+    bool IsConnected() const;
+    // 是否处于发送拥塞
+    bool IsCongested() const;
+    // 发送延迟统计（提交发送到服务器回显）
+    const LatencyStats &SendLatency() const;
+    // 心跳往返时延统计
+    const LatencyStats &RoundTripTime() const;
+
+signals:
+    void connected();
+    void disconnected();
+    void errorOccurred(QAbstractSocket::SocketError err, const QString &strError);
+    // 一批解码好的服务器推送事件（按到达顺序）
+    void eventsReceived(const QVector<ChatEvent> &vecEvents);
+    void sendLatencyMeasured(qint64 nMs);
+    void congestionChanged(bool bCongested);
+    void reconnectScheduled(int nAttempt, int nDelayMs);
+    void rttMeasured(qint64 nMs);
+
+    // 内部信号：转发到网络线程
+    void openRequested(const QString &strUrl, const QString &strSelfId, bool bPreferBinary);
+    void closeRequested();
+    void tokenChanged(const QString &strToken);
+    void reconnectRequested(const QString &strUrl);
+    void messageSendRequested(const QString &strPeerId, const MsgInfo &msgInfo);
+    void presenceChanged(const UserInfo &userInfo);
+    void reconnectNowRequested();
+
+private:
+    explicit ChatConnection(QObject *parent = nullptr);
+
+    static ChatConnection *m_pInstance;
+    QThread m_thread;
+    ChatConnectionWorker *m_pWorker;
+    bool m_bConnected;   // 连接状态（界面线程）
+    bool m_bHoldEvents;  // 是否暂存事件（聊天窗口尚未创建）
+    QVector<ChatEvent> m_vecHeldEvents; // 暂存的事件
+    bool m_bCongested;   // 拥塞状态（界面线程）
+    LatencyStats m_sendLatency;   // 发送延迟（界面线程）
+    LatencyStats m_rtt;           // 心跳往返时延（界面线程）
+    quint64 m_nNextMsgId;         // 客户端消息ID序号
+    QNetworkConfigurationManager m_networkManager;  // 网络恢复时触发立即重连
+};
+
+#endif // CHATCONNECTION_H
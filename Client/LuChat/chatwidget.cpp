@@ -1,29 +1,51 @@
 #include "chatwidget.h"
 #include "ui_chatwidget.h"
+#include "attachmentcache.h"
+#include "thumbnailloader.h"
+#include "appconfig.h"
 #include <QStandardPaths>
 #include <QDateTime>
+#include <QScrollBar>
+#include <QDesktopServices>
+#include <QHeaderView>
+#include <QUrlQuery>
 
 ChatWidget::ChatWidget(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::ChatWidget),
-    m_pTextEdit(nullptr),
+    m_pMsgDelegate(nullptr),
+    m_pMsgHistory(nullptr),
+    m_nMemoryBudget(DEFAULT_MESSAGE_MEMORY_BUDGET),
     m_bIsMainWindow(true),
-    m_bCtrlPressed(false)
+    m_bCtrlPressed(false),
+    m_pOnlineUserModel(nullptr)
 {
     ui->setupUi(this);
     // 1. 初始化消息输入框
     ui->inputTextEdit->setLineWrapMode(QTextEdit::WidgetWidth);  // 按窗口宽度自动换行
     // 2. 初始化群聊消息显示区域（默认标签页）
-    m_pTextEdit = new QTextEdit();
-    m_pTextEdit->setReadOnly(true);  // 消息区域只读
-    m_pTextEdit->setLineWrapMode(QTextEdit::WidgetWidth); // 自动换行
-
+    // 聊天记录按用户保存在本地，读写都在后台线程进行
+    m_nMemoryBudget = AppConfig::GetInstance()->MessageMemoryBudget();
+    QString strOwner = g_stUserInfo.strUserId.isEmpty() ? g_stUserInfo.strUserPhone : g_stUserInfo.strUserId;
+    m_pMsgHistory = new MessageHistory(
+                QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+                + "/history/" + strOwner, this);
+
+    m_pMsgDelegate = new MessageDelegate(this);
+    connect(m_pMsgDelegate, &MessageDelegate::linkActivated, this,
+            &ChatWidget::OnMessageLinkActivated);
+    // 缩略图生成后只重绘当前标签页，视图只绘制可见的行
+    connect(ThumbnailLoader::GetInstance(), &ThumbnailLoader::thumbnailReady, this, [this]() {
+        QAbstractItemView *pView = qobject_cast<QAbstractItemView*>(ui->showMsgTabWidget->currentWidget());
+        if (pView) {
+            pView->viewport()->update();
+        }
+    });
 
     // 设置大小策略（拉伸比例）
     QSizePolicy policy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     policy.setHorizontalStretch(4);
     policy.setVerticalStretch(3);
-    m_pTextEdit->setSizePolicy(policy);
 
     // 3. 初始化标签页（添加公共聊天窗口）
     // 清除默认标签页
@@ -33,18 +55,19 @@ ChatWidget::ChatWidget(QWidget *parent) :
     }
 //    ui->showMsgTabWidget->clear();
     // 初始化标签页（添加公共聊天窗口）
-    ui->showMsgTabWidget->addTab(m_pTextEdit, "聊天窗口");
+    Conversation *pGroup = OpenConversation(GROUP_CONVERSATION_ID, "聊天窗口");
+    pGroup->View()->setSizePolicy(policy);
     ui->showMsgTabWidget->setTabsClosable(true);  // 标签页可关闭（除了公共聊天窗口）
     // 移除群聊标签的关闭按钮
     ui->showMsgTabWidget->tabBar()->setTabButton(0, QTabBar::RightSide, nullptr);
     ui->showMsgTabWidget->setSizePolicy(policy);
 
-    // 4. 初始化在线用户列表（QTableWidget）
-   ui->onlineUsersTableWidget->setColumnCount(1);  // 只显示用户名
-   QTableWidgetItem *item = new QTableWidgetItem("在线用户");
-   ui->onlineUsersTableWidget->setHorizontalHeaderItem(0, item);
-   ui->onlineUsersTableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);  // 禁止编辑
-   ui->onlineUsersTableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);  // 列宽自适应
+    // 4. 初始化在线用户列表（模型按用户ID索引，只刷新变化的行）
+   m_pOnlineUserModel = new OnlineUserModel(this);
+   ui->onlineUsersTableView->setModel(m_pOnlineUserModel);  // 只显示用户名
+   ui->onlineUsersTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);  // 禁止编辑
+   ui->onlineUsersTableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+   ui->onlineUsersTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);  // 列宽自适应
 
     // 5. 配置分割器（不允许折叠子部件）
     ui->verticalSplitter->setChildrenCollapsible(false);
@@ -53,19 +76,23 @@ ChatWidget::ChatWidget(QWidget *parent) :
 //     6. 禁用上传按钮（默认未选择文件时不可用）
     ui->uploadFilePushButton->setDisabled(false);
 
-    // 7. 设置消息HTML模板设置占位符
-    m_strContentTemplateWithoutLink =
-        "<p><strong>%1</strong>：<br>&nbsp;&nbsp;%2&nbsp;&nbsp;<span style='color:gray'>(%3)</span></p>";
-    m_strContentTemplateWithLink =
-        "<p><strong>%1</strong>：<br>&nbsp;&nbsp;%2&nbsp;&nbsp;<a href='%3'>[文件]</a>&nbsp;&nbsp;<span style='color:gray'>(%4)</span></p>";
-
-    // WebSocket消息接收信号（收到文本消息时触发）
-    connect(&g_WebSocket, &QWebSocket::textMessageReceived, this,
-            &ChatWidget::OnWebSocketMsgReceived);
+    // 收到的事件先积攒，按刷新间隔（默认约一帧）合并到界面，
+    // 消息到达再快，每秒的界面更新次数也有上限
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(AppConfig::GetInstance()->InboundFlushInterval());
+    connect(&m_flushTimer, &QTimer::timeout, this, &ChatWidget::FlushPendingEvents);
+    // 服务器推送事件（在网络线程中解码，按批次送达）
+    connect(ChatConnection::GetInstance(), &ChatConnection::eventsReceived, this,
+            &ChatWidget::OnChatEventsReceived);
+    // 切换服务器后原服务器上的在线用户不再有效，由新服务器连上后重新推送
+    connect(AppConfig::GetInstance(), &AppConfig::endpointChanged, this, [this]() {
+        m_pOnlineUserModel->Clear();
+        AddCurrentUserToOnlineList();
+    });
 
 
 //    // 手动连接双击在线用户（发起私聊）
-//    connect(ui->onlineUsersTableWidget, &QTableWidget::itemDoubleClicked, this,
+//    connect(ui->onlineUsersTableView, &QTableView::doubleClicked, this,
 //            &ChatWidget::OnItemDoubleClicked);
 
 //    // 手动连接关闭聊天标签页
@@ -82,7 +109,11 @@ ChatWidget::ChatWidget(QWidget *parent) :
 
 ChatWidget::~ChatWidget()
 {
-    delete m_pTextEdit;
+    // 会话的视图在标签页中，需在界面释放前释放；
+    // 先清空登记表，释放过程中触发的标签切换不会再访问已释放的会话
+    QHash<QString, Conversation*> hashConversations;
+    hashConversations.swap(m_hashConversations);
+    qDeleteAll(hashConversations);
     delete ui;
 }
 
@@ -121,29 +152,186 @@ void ChatWidget::AddCurrentUserToOnlineList()
     UserInfo currentUser;
     currentUser.strUserId = g_stUserInfo.strUserId;
     currentUser.strUserPhone = g_stUserInfo.strUserPhone;
-    
-    // 避免重复添加
-    bool exists = false;
-    for (auto &u : m_vecOnlineUsers) {
-        if (u.strUserId == currentUser.strUserId) {
-            exists = true;
-            break;
+
+    // 模型内部按ID去重
+    m_pOnlineUserModel->AddUser(currentUser);
+}
+
+
+// 查找会话
+Conversation *ChatWidget::FindConversation(const QString &strPeerId) const
+{
+    return m_hashConversations.value(strPeerId, nullptr);
+}
+
+// 查找或创建会话：新会话登记到哈希表并添加标签页
+Conversation *ChatWidget::OpenConversation(const QString &strPeerId, const QString &strTitle)
+{
+    Conversation *pConversation = FindConversation(strPeerId);
+    if (pConversation) {
+        return pConversation;
+    }
+    pConversation = new Conversation(strPeerId, strTitle, m_pMsgHistory, m_pMsgDelegate, m_nMemoryBudget);
+    m_hashConversations.insert(strPeerId, pConversation);
+
+    QListView *pView = pConversation->View();
+    MessageModel *pModel = pConversation->Model();
+    pView->setProperty("peerId", strPeerId);   // 标签页 -> 会话
+    // 滚动到顶部/底部时按需读回或收缩历史消息
+    connect(pView->verticalScrollBar(), &QScrollBar::valueChanged, this, [this, pConversation]() {
+        OnMessageViewScrolled(pConversation);
+    });
+    // 插入更早的消息前记录阅读位置
+    connect(pModel, &QAbstractItemModel::rowsAboutToBeInserted, pView, [pView](const QModelIndex &, int first) {
+        if (first == 0) {
+            QScrollBar *pScrollBar = pView->verticalScrollBar();
+            pView->setProperty("atBottom", pScrollBar->value() >= pScrollBar->maximum());
+            QModelIndex topIndex = pView->indexAt(QPoint(0, 0));
+            pView->setProperty("topRow", topIndex.isValid() ? topIndex.row() : 0);
         }
+    });
+    connect(pModel, &MessageModel::olderMessagesLoaded, this, [this, pConversation](int nCount) {
+        OnOlderMessagesLoaded(pConversation, nCount);
+    });
+
+    ui->showMsgTabWidget->addTab(pView, pConversation->TabText());
+    return pConversation;
+}
+
+// 标签页对应的会话
+Conversation *ChatWidget::ConversationAt(int nTabIndex) const
+{
+    QWidget *pPage = ui->showMsgTabWidget->widget(nTabIndex);
+    if (!pPage) {
+        return nullptr;
     }
-    
-    if (!exists) {
-        m_vecOnlineUsers.push_back(currentUser);
-        qDebug() << "Added current user to online list:" << currentUser.strUserPhone;
+    return FindConversation(pPage->property("peerId").toString());
+}
+
+// 追加消息到会话视图
+void ChatWidget::AppendMessage(Conversation *pConversation, const MsgInfo &msgInfo)
+{
+    AppendMessages(pConversation, QVector<MsgInfo>() << msgInfo);
+}
+
+void ChatWidget::AppendMessages(Conversation *pConversation, const QVector<MsgInfo> &vecMsgInfos)
+{
+    QListView *pView = pConversation->View();
+    MessageModel *pModel = pConversation->Model();
+    // 记录追加前是否停留在底部，用户向上翻阅历史时不打断阅读位置
+    QScrollBar *pScrollBar = pView->verticalScrollBar();
+    bool bAtBottom = pScrollBar->value() >= pScrollBar->maximum() && !pModel->HasNewerOnDisk();
+
+    pModel->AppendMessages(vecMsgInfos);
+
+    if (bAtBottom) {
+        // 跟随最新消息：移走最早的消息
+        pModel->EnforceMemoryBudget();
+        pView->scrollToBottom();
+    } else {
+        // 翻阅历史：移走可见区域之后的最新消息，阅读位置不动
+        QModelIndex bottomIndex = pView->indexAt(QPoint(0, pView->viewport()->height() - 1));
+        pModel->EnforceMemoryBudgetKeepingOlder(bottomIndex.isValid() ? bottomIndex.row() : pModel->rowCount() - 1);
     }
-    
-    // 更新在线用户列表显示
-    ui->onlineUsersTableWidget->setRowCount(m_vecOnlineUsers.size());
-    for (int i = 0; i < m_vecOnlineUsers.size(); ++i) {
-        QTableWidgetItem *item = new QTableWidgetItem(m_vecOnlineUsers[i].strUserPhone);
-        ui->onlineUsersTableWidget->setItem(i, 0, item);
+    // 不在当前标签页的会话计为未读
+    if (ui->showMsgTabWidget->currentWidget() != pView) {
+        pConversation->IncreaseUnread(vecMsgInfos.size());
+    }
+    UpdateConversationTab(pConversation);
+}
+
+void ChatWidget::OnMessageViewScrolled(Conversation *pConversation)
+{
+    QListView *pView = pConversation->View();
+    MessageModel *pModel = pConversation->Model();
+    QScrollBar *pScrollBar = pView->verticalScrollBar();
+    if (pScrollBar->value() <= pScrollBar->minimum() && pModel->CanFetchOlder()) {
+        // 异步读回更早的一页，插入后在OnOlderMessagesLoaded中恢复位置
+        pModel->FetchOlder(MESSAGE_PAGE_SIZE);
+    } else if (pScrollBar->value() >= pScrollBar->maximum() && pModel->HasNewerOnDisk()) {
+        // 回到底部：读回翻阅历史期间留在磁盘上的新消息
+        pModel->FetchNewer(MESSAGE_PAGE_SIZE);
+    } else if (pScrollBar->value() >= pScrollBar->maximum()
+               && pModel->rowCount() > m_nMemoryBudget && m_nMemoryBudget > 0) {
+        pModel->EnforceMemoryBudget();
+        pView->scrollToBottom();
+        UpdateConversationTab(pConversation);
+    }
+}
+
+void ChatWidget::OnOlderMessagesLoaded(Conversation *pConversation, int nCount)
+{
+    QListView *pView = pConversation->View();
+    if (pView->property("atBottom").toBool()) {
+        // 启动加载的最新一页：停在最新消息处
+        pView->scrollToBottom();
+    } else {
+        // 翻阅历史：保持原来第一条可见消息的位置不动
+        int nTopRow = pView->property("topRow").toInt() + nCount;
+        pView->scrollTo(pConversation->Model()->index(nTopRow), QAbstractItemView::PositionAtTop);
     }
+    UpdateConversationTab(pConversation);
 }
 
+void ChatWidget::UpdateConversationTab(Conversation *pConversation)
+{
+    MessageModel *pModel = pConversation->Model();
+    int nTabIndex = ui->showMsgTabWidget->indexOf(pConversation->View());
+    if (nTabIndex < 0) {
+        return;
+    }
+    ui->showMsgTabWidget->setTabText(nTabIndex, pConversation->TabText());
+    ui->showMsgTabWidget->setTabToolTip(nTabIndex, QString("内存中消息: %1 条，占用约 %2 KB，更早的消息: %3 条")
+                                        .arg(pModel->rowCount())
+                                        .arg(pModel->MemoryUsage() / 1024.0, 0, 'f', 1)
+                                        .arg(pModel->SpilledCount()));
+}
+
+// 各会话内存占用
+QMap<QString, qint64> ChatWidget::ConversationMemoryUsage() const
+{
+    QMap<QString, qint64> mapUsage;
+    for (auto it = m_hashConversations.constBegin(); it != m_hashConversations.constEnd(); ++it) {
+        mapUsage[it.key()] = it.value()->Model()->MemoryUsage();
+    }
+    return mapUsage;
+}
+
+// 点击消息中的文件链接，交给系统打开
+// 从文件链接中取出服务器上的文件名（/api/download?filename=x 或 /web/uploads/x），
+// 不是本服务器的文件返回空
+static QString ServerFileName(const QString &strLink)
+{
+    QUrl url(strLink);
+    if (!url.isRelative() && !AppConfig::GetInstance()->IsServerHost(url.host())) {
+        return QString();
+    }
+    if (url.path().endsWith("/api/download")) {
+        return QUrlQuery(url).queryItemValue("filename", QUrl::FullyDecoded);
+    }
+    const QString strUploads = "/uploads/";
+    int nPos = url.path().indexOf(strUploads);
+    if (nPos >= 0) {
+        return url.path().mid(nPos + strUploads.length());
+    }
+    return QString();
+}
+
+void ChatWidget::OnMessageLinkActivated(const QString &strLink)
+{
+    // 本服务器上的文件用内置的下载器分段下载，其他链接交给系统打开
+    QString strFileName = ServerFileName(strLink);
+    if (!strFileName.isEmpty()) {
+        emit downloadFile(strFileName, AttachmentCache::HashOfLink(strLink));
+        return;
+    }
+    QDesktopServices::openUrl(QUrl(strLink));
+}
+
+void ChatWidget::SetFileLink(const QString &strFileLink)
+{
+    m_strFileLink = strFileLink;
+}
 
 // 发送消息按钮
 void ChatWidget::on_sendMsgPushButton_clicked()
@@ -153,59 +341,28 @@ void ChatWidget::on_sendMsgPushButton_clicked()
     if (msg.isEmpty()) {
         return;
     }
-    // 当前聊天对话框的索引
-    int curTabIndex = ui->showMsgTabWidget->currentIndex();
-    //定义消息中的message
-    QJsonObject jsonObj;
-    jsonObj["userphone"]=g_stUserInfo.strUserPhone;
-    jsonObj["userid"] =g_stUserInfo.strUserId;
-    jsonObj["message"] = msg;
-    jsonObj["filelink"] = m_strFileLink; // 文件链接
-    jsonObj["time"] = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-
-    // 定义消息json格式
-    QJsonObject jsonMsg;
-    if (curTabIndex == 0 ) {
-        // 公共消息
-        jsonMsg["message"] = jsonObj;
-    } else {
-        // 私聊消息 获取当前私聊用户ID列表
-        jsonMsg[m_vecUserIds[curTabIndex-1]] = jsonObj;
+    // 当前聊天会话
+    Conversation *pConversation = ConversationAt(ui->showMsgTabWidget->currentIndex());
+    if (!pConversation) {
+        return;
     }
-
-    // 发送WebSocket消息
-    g_WebSocket.sendTextMessage(QJsonDocument(jsonMsg).toJson(QJsonDocument::Compact));
+    // 消息在网络线程中编码发送
+    MsgInfo msgInfo;
+    msgInfo.strUserId = g_stUserInfo.strUserId;
+    msgInfo.strUserPhone = g_stUserInfo.strUserPhone;
+    msgInfo.strContent = msg;
+    msgInfo.strTime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+    msgInfo.fileLink = m_strFileLink; // 文件链接
+    // 公共消息以"message"为键，私聊消息以对方用户ID为键
+    // 消息先显示为"发送中"，服务器回显确认后更新状态
+    msgInfo.strClientMsgId = ChatConnection::GetInstance()->SendMessage(pConversation->PeerId(), msgInfo);
 
     // 更新界面UI
     ui->inputTextEdit->clear(); // 清空输入对话框
-    // 公共消息/群聊
-    if (curTabIndex == 0) {
-        if (!m_strFileLink.isEmpty()) {
-            m_jStringMessages["message"] += m_strContentTemplateWithLink
-                    .arg(g_stUserInfo.strUserPhone).arg(msg).arg(m_strFileLink).arg(jsonObj["time"].toString());
-        } else {
-            m_jStringMessages["message"] += m_strContentTemplateWithoutLink
-                    .arg(g_stUserInfo.strUserPhone).arg(msg).arg(jsonObj["time"].toString());
-        }
-        m_pTextEdit->setHtml(m_jStringMessages["message"]);
-        // 清空文件链接
-        m_strFileLink.clear();
-    } else {
-        QString targetUserID = m_vecUserIds[curTabIndex-1];
-        if (!m_strFileLink.isEmpty()) {
-            m_jStringMessages[targetUserID] += m_strContentTemplateWithLink
-                    .arg(g_stUserInfo.strUserPhone).arg(msg).arg(m_strFileLink).arg(jsonObj["time"].toString());
-        } else {
-            m_jStringMessages[targetUserID] += m_strContentTemplateWithoutLink
-                    .arg(g_stUserInfo.strUserPhone).arg(msg).arg(jsonObj["time"].toString());
-        }
-        QTextEdit *tabEdit = qobject_cast<QTextEdit*>(ui->showMsgTabWidget->widget(curTabIndex));
-        if (tabEdit) {
-            tabEdit->setHtml(m_jStringMessages[targetUserID]);
-        }
-        // 清空文件链接
-        m_strFileLink.clear();
-    }
+    // 公共消息/群聊 或 当前私聊会话
+    AppendMessage(pConversation, msgInfo);
+    // 清空文件链接
+    m_strFileLink.clear();
 }
 
 // 点击上传文件
@@ -224,170 +381,107 @@ void ChatWidget::on_uploadFilePushButton_clicked()
     }
 }
 
-// 接收WebSocket消息
-void ChatWidget::OnWebSocketMsgReceived(const QString &msg)
+// 收到一批服务器推送事件（解析已在网络线程完成），积攒到下一个刷新周期
+void ChatWidget::OnChatEventsReceived(const QVector<ChatEvent> &vecEvents)
 {
-    QJsonParseError err;
-    // 解析消息为Json
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(msg.toUtf8(), &err);
-    if (err.error != QJsonParseError::NoError) {
-        qDebug() << "解析消息失败:" << err.error;
-        return;
+    m_vecPendingEvents += vecEvents;
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
     }
+}
 
-    QJsonObject jsonObj = jsonDoc.object();
-    if (jsonObj.contains("message")) {
-        // 公共消息
-        QJsonObject msgObj = jsonObj["message"].toObject();
-        QString senderId = msgObj["userid"].toString();
-        // 忽略自己发的消息
-        if (senderId == g_stUserInfo.strUserId)
-        {
-            return;
-        }
-
-        MsgInfo msgInfo ;
-        msgInfo.strUserId = senderId;
-        msgInfo.strUserPhone = msgObj["userphone"].toString();
-        msgInfo.strContent = msgObj["message"].toString();
-        msgInfo.strTime = msgObj["time"].toString();
-        msgInfo.fileLink = msgObj["filelink"].toString();
-
-        // 更新公共聊天窗口
-        if (msgInfo.fileLink.isEmpty()) {
-            m_jStringMessages["message"] += m_strContentTemplateWithoutLink
-                    .arg(msgInfo.strUserPhone).arg(msgInfo.strContent).arg(msgInfo.strTime);
-        } else {
-            m_jStringMessages["message"] += m_strContentTemplateWithLink
-                            .arg(msgInfo.strUserPhone).arg(msgInfo.strContent).arg(msgInfo.fileLink).arg(msgInfo.strTime);
-        }
-
-        // 渲染消息html
-        m_pTextEdit->setHtml(m_jStringMessages["message"]);
-        // 发送提醒消息
-        emit newMessageArrived();
-        // 更新在线用户
-    } else if (jsonObj.contains("online")) {
-        QJsonObject onlineObj = jsonObj["online"].toObject();
-        QString userId = onlineObj["userid"].toString();
-        if (userId == g_stUserInfo.strUserId) {
-            // return;
-        }
-
-        UserInfo user;
-        user.strUserId = userId;
-        user.strUserPhone = onlineObj["userphone"].toString();
-        // 避免重复添加
-        bool exists = false;
-        for (auto &u : m_vecOnlineUsers) {
-            if (u.strUserId == userId) {
-                exists = true;
-                break;
+// 按会话合并消息后一次性追加，每个会话只插入、滚动一次
+void ChatWidget::FlushPendingEvents()
+{
+    QVector<ChatEvent> vecEvents;
+    vecEvents.swap(m_vecPendingEvents);
+
+    QVector<Conversation*> vecConversations;            // 保持消息到达的会话顺序
+    QHash<Conversation*, QVector<MsgInfo>> hashMessages;
+    for (const ChatEvent &event : vecEvents) {
+        Conversation *pConversation = nullptr;
+        switch (event.eType) {
+        case CHAT_EVENT_GROUP_MESSAGE:
+            // 公共聊天窗口
+            pConversation = FindConversation(GROUP_CONVERSATION_ID);
+            break;
+        case CHAT_EVENT_PRIVATE_MESSAGE:
+            // 查找或者创建私聊会话（按用户ID哈希查找）
+            pConversation = OpenConversation(event.msgInfo.strUserId, event.msgInfo.strUserPhone);
+            break;
+        case CHAT_EVENT_ONLINE:
+            // 更新在线用户列表（已存在则不重复添加）
+            m_pOnlineUserModel->AddUser(event.userInfo);
+            break;
+        case CHAT_EVENT_MESSAGE_ACKED:
+        case CHAT_EVENT_MESSAGE_FAILED:
+            // 本端发出消息的确认/超时，只刷新对应的一行
+            if (Conversation *pAcked = FindConversation(event.strPeerId)) {
+                pAcked->Model()->SetSendState(event.msgInfo.strClientMsgId,
+                                              event.eType == CHAT_EVENT_MESSAGE_ACKED
+                                              ? SEND_STATE_NONE : SEND_STATE_FAILED);
             }
+            break;
         }
-        // 不存在则添加
-        if (!exists) {
-            m_vecOnlineUsers.push_back(user);
-        }
-
-        // 更新在线用户列表
-        ui->onlineUsersTableWidget->setRowCount(m_vecOnlineUsers.size());
-        for (int i= 0; i < m_vecOnlineUsers.size(); ++i) {
-            ui->onlineUsersTableWidget->setItem(i,0,new QTableWidgetItem(m_vecOnlineUsers[i].strUserPhone));
-        }
-    } else if (jsonObj.contains(g_stUserInfo.strUserId)) {
-        // 私聊消息
-        QJsonObject msgObj = jsonObj[g_stUserInfo.strUserId].toObject();
-        QString senderId = msgObj["userid"].toString();
-        QString senderPhone = msgObj["userphone"].toString();
-
-        // 查找或者创建私聊标签页
-        int tabIndex = -1;
-        for (int i = 0; i < m_vecUserIds.size();++i) {
-            if (m_vecUserIds[i] == senderId) {
-                tabIndex = i+1;
-                break;
+        if (pConversation) {
+            if (!hashMessages.contains(pConversation)) {
+                vecConversations.append(pConversation);
             }
+            hashMessages[pConversation].append(event.msgInfo);
         }
-        if (tabIndex == -1 ) {
-            // 新建
-            QTextEdit *newEdit = new QTextEdit();
-            newEdit->setReadOnly(true);
-            tabIndex = ui->showMsgTabWidget->addTab(newEdit, senderPhone);
-            m_vecUserIds.push_back(senderId);
-        }
-
-        // 更新私聊窗口内容
-        QString time = msgObj["time"].toString();
-        QString content = msgObj["message"].toString();
-        QString fileLink = msgObj["filelink"].toString();
-        if (fileLink.isEmpty()) {
-            m_jStringMessages[senderId] += m_strContentTemplateWithoutLink
-                .arg(senderPhone).arg(content).arg(time);
-        } else {
-            m_jStringMessages[senderId] += m_strContentTemplateWithLink
-                .arg(senderPhone).arg(content).arg(fileLink).arg(time);
-        }
-        QTextEdit *tabEdit = qobject_cast<QTextEdit*>(ui->showMsgTabWidget->widget(tabIndex));
-        if (tabEdit) tabEdit->setHtml(m_jStringMessages[senderId]);
-
-        emit newMessageArrived(); // 提醒新消息
     }
 
+    for (Conversation *pConversation : vecConversations) {
+        AppendMessages(pConversation, hashMessages.value(pConversation));
+    }
+    // 每次刷新只提醒一次
+    if (!vecConversations.isEmpty()) {
+        emit newMessageArrived();
+    }
 }
 
 // 双击在线用户发起私聊
-void ChatWidget::on_onlineUsersTableWidget_itemDoubleClicked(QTableWidgetItem *item)
+void ChatWidget::on_onlineUsersTableView_doubleClicked(const QModelIndex &index)
 {
     qDebug() << "Double-clicked on online user item";
     
     // 获取点击的位置
-    int row = item->row();
-    qDebug() << "Clicked row:" << row << "Total online users:" << m_vecOnlineUsers.size();
+    int row = index.row();
+    qDebug() << "Clicked row:" << row << "Total online users:" << m_pOnlineUserModel->rowCount();
     
-    if (row < 0 || row >= m_vecOnlineUsers.size()) {
+    if (!index.isValid() || row < 0 || row >= m_pOnlineUserModel->rowCount()) {
         qDebug() << "Invalid row index";
         return;
     }
     
-    UserInfo targetUser = m_vecOnlineUsers[row];
+    UserInfo targetUser = m_pOnlineUserModel->UserAt(row);
     qDebug() << "Target user:" << targetUser.strUserPhone << "ID:" << targetUser.strUserId;
     
-    // 检查是否已经存在私聊窗口
-    for (int i = 0; i < m_vecUserIds.size();++i) {
-        if (m_vecUserIds[i] == targetUser.strUserId) {
-            qDebug() << "Switching to existing private chat tab:" << i+1;
-            // 切换到该用户的私聊标签页
-            ui->showMsgTabWidget->setCurrentIndex(i+1);
-            return ;
-        }
-    }
-    
-    qDebug() << "Creating new private chat tab for:" << targetUser.strUserPhone;
-    // 新建私聊标签页
-    QTextEdit *newEdit = new QTextEdit();
-    newEdit->setReadOnly(true);
-    int tabIndex = ui->showMsgTabWidget->addTab(newEdit, targetUser.strUserPhone);
-    m_vecUserIds.push_back(targetUser.strUserId);
-    ui->showMsgTabWidget->setCurrentIndex(tabIndex);
-    qDebug() << "New private chat tab created at index:" << tabIndex;
+    // 已有私聊会话则切换过去，否则新建
+    Conversation *pConversation = OpenConversation(targetUser.strUserId, targetUser.strUserPhone);
+    ui->showMsgTabWidget->setCurrentWidget(pConversation->View());
 }
 
 // 关闭标签页
 void ChatWidget::on_showMsgTabWidget_tabCloseRequested(int index)
 {
     // 公共聊天标签页禁止关闭
-     if (index == 0 ) {
+     Conversation *pConversation = ConversationAt(index);
+     if (!pConversation || pConversation->IsGroup()) {
          return;
      }
-     // 删除标签页索引
-     ui->showMsgTabWidget->removeTab(index);
-     // 删除私聊用户id
-     m_vecUserIds.removeAt(index-1);
+     // 从登记表移除并释放会话（视图及其模型随之释放，标签页自动移除）
+     m_hashConversations.remove(pConversation->PeerId());
+     delete pConversation;
 }
 
 // 切换标签页
 void ChatWidget::on_showMsgTabWidget_currentChanged(int index)
 {
-
+    // 切换到会话即视为已读
+    Conversation *pConversation = ConversationAt(index);
+    if (pConversation && pConversation->UnreadCount() > 0) {
+        pConversation->ClearUnread();
+        UpdateConversationTab(pConversation);
+    }
 }
@@ -3,9 +3,10 @@
 
 #include <QWidget>
 #include <QTextEdit>
+#include <QListView>
 #include <QPushButton>
 #include "common.h"
-#include <QTableWidgetItem>
+#include <QTableView>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -14,7 +15,14 @@
 #include <QNetworkRequest>
 #include <QFileDialog>
 #include <QKeyEvent>
+#include <QTimer>
 #include <settingdlg.h>
+#include "messagemodel.h"
+#include "messagedelegate.h"
+#include "messagehistory.h"
+#include "onlineusermodel.h"
+#include "conversation.h"
+#include "chatconnection.h"
 
 namespace Ui {
 class ChatWidget;
@@ -35,9 +43,16 @@ public:
     // 添加当前用户到在线列表
     void AddCurrentUserToOnlineList();
 
+    // 各会话当前的内存占用（字节），键为会话标识
+    QMap<QString, qint64> ConversationMemoryUsage() const;
+
+    // 设置下一条发送的消息附带的文件链接（上传完成后调用）
+    void SetFileLink(const QString &strFileLink);
+
 signals:
     void newMessageArrived(); // 新消息提醒
     void uploadFile(QString filePath); // 上传文件信号
+    void downloadFile(QString fileName, QString fileHash); // 下载服务器上的文件（fileHash为链接中的内容哈希，可为空）
 
 
 private slots:
@@ -45,14 +60,18 @@ private slots:
     void on_sendMsgPushButton_clicked();
     // 上传文件
     void on_uploadFilePushButton_clicked();
-    // 接收WebSocket消息
-    void OnWebSocketMsgReceived(const QString &msg);
+    // 处理网络线程解码好的一批服务器推送事件
+    void OnChatEventsReceived(const QVector<ChatEvent> &vecEvents);
+    // 把积攒的事件一次性刷新到界面（每个刷新周期最多一次）
+    void FlushPendingEvents();
     // 双击在线用户发起私聊
-    void on_onlineUsersTableWidget_itemDoubleClicked(QTableWidgetItem *item);
+    void on_onlineUsersTableView_doubleClicked(const QModelIndex &index);
      // 关闭聊天标签页
     void on_showMsgTabWidget_tabCloseRequested(int index);
     // 切换标签页
     void on_showMsgTabWidget_currentChanged(int index);
+    // 点击消息中的文件链接
+    void OnMessageLinkActivated(const QString &strLink);
 
 protected:
     void keyPressEvent(QKeyEvent *e) override;
@@ -60,26 +79,43 @@ protected:
 
 private:
     Ui::ChatWidget *ui;
-    // 消息显示区域
-    QTextEdit *m_pTextEdit;
+    // 消息绘制委托（所有会话共用）
+    MessageDelegate *m_pMsgDelegate;
+    // 本地持久化聊天记录
+    MessageHistory *m_pMsgHistory;
+    // 每个会话内存中保留的消息数
+    int m_nMemoryBudget;
     // 标记是否为主窗口（群聊窗口）
     bool m_bIsMainWindow;
     // Ctrl键状态
     bool m_bCtrlPressed;
-    // 私聊用户ID列表
-    QVector<QString> m_vecUserIds;
-    // 按用户ID存储聊天记录
-    QMap<QString, QString> m_jStringMessages;
-    // 消息列表
-    QVector<MsgInfo> m_vecMsgInfos;
+    // 会话登记表：对方用户ID -> 会话（群聊为GROUP_CONVERSATION_ID）
+    QHash<QString, Conversation*> m_hashConversations;
     // 在线用户列表
-    QVector<UserInfo> m_vecOnlineUsers;
+    OnlineUserModel *m_pOnlineUserModel;
     // 最近上传的文件链接
     QString m_strFileLink;
+    // 等待刷新到界面的服务器推送事件
+    QVector<ChatEvent> m_vecPendingEvents;
+    // 刷新定时器（单次触发，有待处理事件时启动）
+    QTimer m_flushTimer;
 
-    // 消息模板（HTML格式，方便格式化显示）
-    QString m_strContentTemplateWithLink;  // 带文件链接的消息模板
-    QString m_strContentTemplateWithoutLink;  // 无链接的消息模板
+    // 查找会话，不存在返回nullptr
+    Conversation *FindConversation(const QString &strPeerId) const;
+    // 查找或创建会话（创建时添加标签页）
+    Conversation *OpenConversation(const QString &strPeerId, const QString &strTitle);
+    // 标签页对应的会话
+    Conversation *ConversationAt(int nTabIndex) const;
+    // 向会话追加一条消息，停留在底部时自动跟随，不在当前标签页时计为未读
+    void AppendMessage(Conversation *pConversation, const MsgInfo &msgInfo);
+    // 向会话追加一批消息（一次插入、一次滚动、一次刷新标签页）
+    void AppendMessages(Conversation *pConversation, const QVector<MsgInfo> &vecMsgInfos);
+    // 消息视图滚动：到顶部时读回更早的消息，回到底部时收缩到内存预算
+    void OnMessageViewScrolled(Conversation *pConversation);
+    // 更早的消息插入到开头后，保持原来的阅读位置
+    void OnOlderMessagesLoaded(Conversation *pConversation, int nCount);
+    // 刷新会话标签页的标题（未读数）和提示（内存占用）
+    void UpdateConversationTab(Conversation *pConversation);
 };
 
 #endif // CHATWIDGET_H
@@ -0,0 +1,466 @@
+#include "chunkuploader.h"
+#include "common.h"
+#include "filehasher.h"
+#include "bandwidthlimiter.h"
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDebug>
+
+ChunkUploader::ChunkUploader(QNetworkAccessManager *pManager, const QString &strServerUrl,
+                             const QString &strFilePath, QObject *parent) :
+    QObject(parent),
+    m_pManager(pManager),
+    m_strServerUrl(strServerUrl),
+    m_strFilePath(strFilePath),
+    m_nFileSize(0),
+    m_nTotalChunks(0),
+    m_file(strFilePath),
+    m_nDoneBytes(0),
+    m_pControlReply(nullptr),
+    m_nHashRequest(-1),
+    m_bFailed(false)
+{
+    QFileInfo fileInfo(strFilePath);
+    m_strFileName = fileInfo.fileName();
+    m_nFileSize = fileInfo.size();
+    // 空文件也按一块上传（服务器要求块数不为0）
+    m_nTotalChunks = qMax<qint64>(1, (m_nFileSize + UPLOAD_CHUNK_SIZE - 1) / UPLOAD_CHUNK_SIZE);
+
+    FileHasher *pHasher = FileHasher::GetInstance();
+    connect(pHasher, &FileHasher::progress, this, &ChunkUploader::OnHashProgress);
+    connect(pHasher, &FileHasher::finished, this, &ChunkUploader::OnHashFinished);
+    connect(pHasher, &FileHasher::failed, this, &ChunkUploader::OnHashFailed);
+}
+
+ChunkUploader::~ChunkUploader()
+{
+    if (m_nHashRequest >= 0) {
+        FileHasher::GetInstance()->Cancel(m_nHashRequest);
+    }
+    AbortReplies();
+}
+
+void ChunkUploader::SetFileHash(const QString &strFileHash)
+{
+    m_strFileHash = strFileHash;
+}
+
+QString ChunkUploader::FileHash() const
+{
+    return m_strFileHash;
+}
+
+void ChunkUploader::SetBandwidthLimiter(BandwidthLimiter *pLimiter)
+{
+    m_pLimiter = pLimiter;
+}
+
+QString ChunkUploader::FilePath() const
+{
+    return m_strFilePath;
+}
+
+QString ChunkUploader::FileName() const
+{
+    return m_strFileName;
+}
+
+qint64 ChunkUploader::FileSize() const
+{
+    return m_nFileSize;
+}
+
+void ChunkUploader::Start()
+{
+    AbortReplies();
+    m_queuePending.clear();
+    m_hashRunningBytes.clear();
+    m_hashRetries.clear();
+    m_nDoneBytes = 0;
+    m_bFailed = false;
+
+    if (!m_file.isOpen() && !m_file.open(QIODevice::ReadOnly)) {
+        Fail(QString("文件打开失败: %1").arg(m_file.errorString()));
+        return;
+    }
+    if (m_strFileHash.isEmpty()) {
+        // 哈希在工作线程中计算，完成后再询问服务器
+        if (m_nHashRequest < 0) {
+            m_nHashRequest = FileHasher::GetInstance()->Hash(m_strFilePath);
+        }
+        return;
+    }
+    CheckInstant();
+}
+
+void ChunkUploader::OnHashProgress(int nRequestId, qint64 nDone, qint64 nTotal)
+{
+    if (nRequestId == m_nHashRequest) {
+        emit hashProgress(nDone, nTotal);
+    }
+}
+
+void ChunkUploader::OnHashFinished(int nRequestId, const QString &strHash)
+{
+    if (nRequestId != m_nHashRequest) {
+        return;
+    }
+    m_nHashRequest = -1;
+    m_strFileHash = strHash;
+    CheckInstant();
+}
+
+void ChunkUploader::OnHashFailed(int nRequestId, const QString &strError)
+{
+    if (nRequestId != m_nHashRequest) {
+        return;
+    }
+    m_nHashRequest = -1;
+    Fail(QString("计算文件哈希失败: %1").arg(strError));
+}
+
+void ChunkUploader::CheckInstant()
+{
+    // 服务器要求文件大小不为0，空文件直接上传
+    if (m_nFileSize == 0) {
+        CheckResume();
+        return;
+    }
+    QJsonObject obj;
+    obj["file_hash"] = m_strFileHash;
+    obj["filename"] = m_strFileName;
+    obj["file_size"] = m_nFileSize;
+    obj["userphone"] = g_stUserInfo.strUserPhone;
+    m_pControlReply = PostJson("/api/instant/check", obj);
+    connect(m_pControlReply, &QNetworkReply::finished, this, &ChunkUploader::OnInstantCheckFinished);
+}
+
+void ChunkUploader::OnInstantCheckFinished()
+{
+    QNetworkReply *pReply = m_pControlReply;
+    m_pControlReply = nullptr;
+    pReply->deleteLater();
+
+    QJsonObject data;
+    int nCode = 0;
+    QString strError;
+    if (!ParseResponse(pReply, data, nCode, strError)) {
+        if (nCode == RESPONSE_CODE_INVALID_FILE_TYPE) {
+            UploadWhole();
+            return;
+        }
+        // 秒传只是优化，检查失败时照常上传
+        qDebug() << m_strFileName << "秒传检查失败:" << strError;
+    } else if (data["can_instant"].toBool()) {
+        qDebug() << m_strFileName << "服务器已有相同文件，秒传";
+        m_file.close();
+        FileHasher::GetInstance()->RecordUpload(m_strFilePath, m_strFileHash, data["file_url"].toString());
+        emit progress(m_nFileSize, m_nFileSize);
+        emit finished(data["file_url"].toString(), true);
+        return;
+    }
+    CheckResume();
+}
+
+void ChunkUploader::CheckResume()
+{
+    // 查询服务器已有的块
+    QJsonObject obj;
+    obj["file_hash"] = m_strFileHash;
+    obj["filename"] = m_strFileName;
+    obj["total_chunks"] = m_nTotalChunks;
+    obj["file_size"] = m_nFileSize;
+    m_pControlReply = PostJson("/api/resume/check", obj);
+    connect(m_pControlReply, &QNetworkReply::finished, this, &ChunkUploader::OnResumeCheckFinished);
+}
+
+void ChunkUploader::Abort()
+{
+    m_bFailed = true;
+    if (m_nHashRequest >= 0) {
+        FileHasher::GetInstance()->Cancel(m_nHashRequest);
+        m_nHashRequest = -1;
+    }
+    AbortReplies();
+    m_file.close();
+}
+
+QNetworkReply *ChunkUploader::PostJson(const QString &strPath, const QJsonObject &obj)
+{
+    QNetworkRequest req(QUrl(m_strServerUrl + strPath));
+    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    req.setRawHeader("Accept", "application/json");
+    return m_pManager->post(req, QJsonDocument(obj).toJson(QJsonDocument::Compact));
+}
+
+bool ChunkUploader::ParseResponse(QNetworkReply *pReply, QJsonObject &data, int &nCode, QString &strError) const
+{
+    nCode = 0;
+    if (pReply->error() != QNetworkReply::NoError) {
+        strError = pReply->errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(pReply->readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !jsonDoc.isObject()) {
+        strError = QString("响应解析失败: %1").arg(parseError.errorString());
+        return false;
+    }
+    QJsonObject jsonObj = jsonDoc.object();
+    nCode = jsonObj["code"].toInt();
+    if (nCode != RESPONSE_CODE_SUCCESS) {
+        strError = jsonObj["message"].toString();
+        return false;
+    }
+    data = jsonObj["data"].toObject();
+    return true;
+}
+
+void ChunkUploader::OnResumeCheckFinished()
+{
+    QNetworkReply *pReply = m_pControlReply;
+    m_pControlReply = nullptr;
+    pReply->deleteLater();
+
+    QJsonObject data;
+    int nCode = 0;
+    QString strError;
+    if (!ParseResponse(pReply, data, nCode, strError)) {
+        if (nCode == RESPONSE_CODE_INVALID_FILE_TYPE) {
+            UploadWhole();
+        } else {
+            Fail(QString("续传检查失败: %1").arg(strError));
+        }
+        return;
+    }
+
+    QSet<int> setUploaded;
+    const QJsonArray arrUploaded = data["uploaded_chunks"].toArray();
+    for (const QJsonValue &value : arrUploaded) {
+        setUploaded.insert(value.toInt());
+    }
+    for (int i = 0; i < m_nTotalChunks; ++i) {
+        if (setUploaded.contains(i)) {
+            m_nDoneBytes += ChunkBytes(i);
+        } else {
+            m_queuePending.enqueue(i);
+        }
+    }
+    if (!setUploaded.isEmpty()) {
+        qDebug() << m_strFileName << "从断点续传，服务器已有" << setUploaded.size() << "/" << m_nTotalChunks << "块";
+    }
+    ReportProgress();
+
+    if (m_queuePending.isEmpty()) {
+        Merge();
+    } else {
+        StartChunks();
+    }
+}
+
+void ChunkUploader::StartChunks()
+{
+    while (!m_bFailed && m_hashRunning.size() < UPLOAD_CHUNK_CONCURRENCY && !m_queuePending.isEmpty()) {
+        StartChunk(m_queuePending.dequeue());
+    }
+}
+
+void ChunkUploader::StartChunk(int nIndex)
+{
+    QList<QPair<QString, QByteArray>> listFields;
+    listFields.append(qMakePair(QString("file_hash"), m_strFileHash.toUtf8()));
+    listFields.append(qMakePair(QString("chunk_index"), QByteArray::number(nIndex)));
+    listFields.append(qMakePair(QString("total_chunks"), QByteArray::number(m_nTotalChunks)));
+    listFields.append(qMakePair(QString("filename"), m_strFileName.toUtf8()));
+    QNetworkReply *pReply = PostMultipart("/api/chunk", listFields, "chunk_data", QString::number(nIndex),
+                                          nIndex * UPLOAD_CHUNK_SIZE, ChunkBytes(nIndex));
+
+    m_hashRunning.insert(pReply, nIndex);
+    m_hashRunningBytes.insert(nIndex, 0);
+    connect(pReply, &QNetworkReply::finished, this, &ChunkUploader::OnChunkFinished);
+    connect(pReply, &QNetworkReply::uploadProgress, this, &ChunkUploader::OnChunkProgress);
+}
+
+QNetworkReply *ChunkUploader::PostMultipart(const QString &strPath, const QList<QPair<QString, QByteArray>> &listFields,
+                                            const QString &strFileField, const QString &strFileName,
+                                            qint64 nOffset, qint64 nSize)
+{
+    // 手工拼装multipart：表单字段和文件字段的头部在前，文件数据由ThrottledBody
+    // 在发送时从m_file读取（多个块共用同一个QFile，每次读取前重新定位）
+    QByteArray boundary = "luchat" + QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+    QByteArray head;
+    for (const QPair<QString, QByteArray> &field : listFields) {
+        head += "--" + boundary + "\r\n";
+        head += "Content-Disposition: form-data; name=\"" + field.first.toUtf8() + "\"\r\n\r\n";
+        head += field.second + "\r\n";
+    }
+    QByteArray fileName = strFileName.toUtf8().replace('"', "%22");
+    head += "--" + boundary + "\r\n";
+    head += "Content-Disposition: form-data; name=\"" + strFileField.toUtf8()
+            + "\"; filename=\"" + fileName + "\"\r\n";
+    head += "Content-Type: application/octet-stream\r\n\r\n";
+    QByteArray tail = "\r\n--" + boundary + "--\r\n";
+
+    ThrottledBody *pBody = new ThrottledBody(head, &m_file, nOffset, nSize, tail, m_pLimiter);
+    QNetworkRequest req(QUrl(m_strServerUrl + strPath));
+    req.setHeader(QNetworkRequest::ContentTypeHeader, "multipart/form-data; boundary=" + boundary);
+    req.setHeader(QNetworkRequest::ContentLengthHeader, pBody->size());
+    req.setRawHeader("Accept", "application/json");
+    QNetworkReply *pReply = m_pManager->post(req, pBody);
+    pBody->setParent(pReply); // reply 删除时一并释放
+    return pReply;
+}
+
+void ChunkUploader::OnChunkProgress(qint64 nSent, qint64 nTotal)
+{
+    QNetworkReply *pReply = qobject_cast<QNetworkReply*>(sender());
+    if (!pReply || !m_hashRunning.contains(pReply)) {
+        return;
+    }
+    // 进度按块数据计算（multipart的表单头开销不计入）
+    int nIndex = m_hashRunning.value(pReply);
+    qint64 nChunkBytes = ChunkBytes(nIndex);
+    m_hashRunningBytes[nIndex] = nTotal > 0 ? qMin(nChunkBytes, nSent * nChunkBytes / nTotal) : 0;
+    ReportProgress();
+}
+
+void ChunkUploader::OnChunkFinished()
+{
+    QNetworkReply *pReply = qobject_cast<QNetworkReply*>(sender());
+    if (!pReply || !m_hashRunning.contains(pReply)) {
+        return;
+    }
+    int nIndex = m_hashRunning.take(pReply);
+    m_hashRunningBytes.remove(nIndex);
+    pReply->deleteLater();
+
+    QJsonObject data;
+    int nCode = 0;
+    QString strError;
+    if (ParseResponse(pReply, data, nCode, strError)) {
+        m_nDoneBytes += ChunkBytes(nIndex);
+        ReportProgress();
+    } else if (m_hashRetries.value(nIndex) < UPLOAD_CHUNK_MAX_RETRY) {
+        // 单块失败只重试该块
+        m_hashRetries[nIndex] += 1;
+        qDebug() << m_strFileName << "第" << nIndex << "块上传失败，重试:" << strError;
+        m_queuePending.enqueue(nIndex);
+    } else {
+        Fail(QString("第 %1 块上传失败: %2").arg(nIndex).arg(strError));
+        return;
+    }
+
+    if (m_queuePending.isEmpty() && m_hashRunning.isEmpty()) {
+        Merge();
+    } else {
+        StartChunks();
+    }
+}
+
+void ChunkUploader::Merge()
+{
+    QJsonObject obj;
+    obj["file_hash"] = m_strFileHash;
+    obj["filename"] = m_strFileName;
+    obj["total_chunks"] = m_nTotalChunks;
+    obj["userphone"] = g_stUserInfo.strUserPhone;
+    m_pControlReply = PostJson("/api/merge", obj);
+    connect(m_pControlReply, &QNetworkReply::finished, this, &ChunkUploader::OnMergeFinished);
+}
+
+void ChunkUploader::OnMergeFinished()
+{
+    QNetworkReply *pReply = m_pControlReply;
+    m_pControlReply = nullptr;
+    pReply->deleteLater();
+
+    QJsonObject data;
+    int nCode = 0;
+    QString strError;
+    if (!ParseResponse(pReply, data, nCode, strError)) {
+        Fail(QString("合并文件失败: %1").arg(strError));
+        return;
+    }
+    m_file.close();
+    FileHasher::GetInstance()->RecordUpload(m_strFilePath, m_strFileHash, data["file_path"].toString());
+    emit finished(data["file_path"].toString(), false);
+}
+
+void ChunkUploader::UploadWhole()
+{
+    qDebug() << m_strFileName << "服务器不接受该类型文件的分块上传，改为整体上传";
+    m_nDoneBytes = 0;
+    QList<QPair<QString, QByteArray>> listFields;
+    // 服务端使用 PostForm("userphone")、FormFile("file")
+    listFields.append(qMakePair(QString("userphone"), g_stUserInfo.strUserPhone.toUtf8()));
+    m_pControlReply = PostMultipart("/api/upload", listFields, "file", m_strFileName, 0, m_nFileSize);
+    connect(m_pControlReply, &QNetworkReply::finished, this, &ChunkUploader::OnWholeFinished);
+    connect(m_pControlReply, &QNetworkReply::uploadProgress, this, [this](qint64 nSent, qint64 nTotal) {
+        emit progress(nTotal > 0 ? qMin(m_nFileSize, nSent * m_nFileSize / nTotal) : 0, m_nFileSize);
+    });
+}
+
+void ChunkUploader::OnWholeFinished()
+{
+    QNetworkReply *pReply = m_pControlReply;
+    m_pControlReply = nullptr;
+    pReply->deleteLater();
+
+    // /api/upload的响应为{"msg","file_path"}，没有统一的code
+    const int nHttpStatus = pReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const QByteArray body = pReply->readAll();
+    QString strServerPath = QJsonDocument::fromJson(body).object().value("file_path").toString();
+    if (pReply->error() != QNetworkReply::NoError || nHttpStatus != 200 || strServerPath.isEmpty()) {
+        QString strError = pReply->errorString();
+        if (!body.isEmpty()) {
+            strError += "\n" + QString::fromUtf8(body);
+        }
+        Fail(strError);
+        return;
+    }
+    m_file.close();
+    emit progress(m_nFileSize, m_nFileSize);
+    emit finished(strServerPath, false);
+}
+
+void ChunkUploader::Fail(const QString &strError)
+{
+    if (m_bFailed) {
+        return;
+    }
+    m_bFailed = true;
+    AbortReplies();
+    qDebug() << m_strFileName << "上传失败:" << strError;
+    emit failed(strError);
+}
+
+void ChunkUploader::AbortReplies()
+{
+    QList<QNetworkReply*> listReplies = m_hashRunning.keys();
+    if (m_pControlReply) {
+        listReplies.append(m_pControlReply);
+    }
+    m_hashRunning.clear();
+    m_pControlReply = nullptr;
+    for (QNetworkReply *pReply : listReplies) {
+        disconnect(pReply, nullptr, this, nullptr);
+        pReply->abort();
+        pReply->deleteLater();
+    }
+}
+
+qint64 ChunkUploader::ChunkBytes(int nIndex) const
+{
+    return qMin(UPLOAD_CHUNK_SIZE, m_nFileSize - nIndex * UPLOAD_CHUNK_SIZE);
+}
+
+void ChunkUploader::ReportProgress()
+{
+    qint64 nSent = m_nDoneBytes;
+    for (qint64 nBytes : m_hashRunningBytes) {
+        nSent += nBytes;
+    }
+    emit progress(nSent, m_nFileSize);
+}
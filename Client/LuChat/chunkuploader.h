@@ -0,0 +1,127 @@
+#ifndef CHUNKUPLOADER_H
+#define CHUNKUPLOADER_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QQueue>
+#include <QSet>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+#include <QPointer>
+
+class BandwidthLimiter;
+
+// 分块上传参数
+const qint64 UPLOAD_CHUNK_SIZE = 5 * 1024 * 1024;  // 每块大小（与服务器global.ChunkSize一致）
+const int UPLOAD_CHUNK_CONCURRENCY = 4;            // 同时上传的块数（复用同一主机的长连接）
+const int UPLOAD_CHUNK_MAX_RETRY = 3;              // 单个块失败后的重试次数
+
+/**
+ * @brief 分块上传一个文件
+ *
+ * 先在FileHasher的工作线程中计算文件内容哈希，用/api/instant/check询问服务器
+ * 是否已有相同内容的文件（有则秒传，不发送任何数据）；否则用
+ * /api/resume/check查询服务器已保存的块，只上传缺少的块；多个块并发
+ * 通过同一个QNetworkAccessManager发送（复用长连接），全部完成后调用
+ * /api/merge合并。块失败时单独重试，重试用尽则整体失败；服务器保留已收到
+ * 的块，再次上传同一文件时从断点继续。块数据发送时才从文件读取（可经
+ * BandwidthLimiter限速），不在内存中缓存。服务器不接受该类型文件的分块
+ * 上传时改用/api/upload整体上传。
+ */
+class ChunkUploader : public QObject
+{
+    Q_OBJECT
+
+public:
+    // strServerUrl形如"http://host:port"
+    ChunkUploader(QNetworkAccessManager *pManager, const QString &strServerUrl,
+                  const QString &strFilePath, QObject *parent = nullptr);
+    ~ChunkUploader();
+
+    // 文件内容哈希（服务器按它秒传、保存块和续传），不设置时开始上传前计算
+    void SetFileHash(const QString &strFileHash);
+    QString FileHash() const;
+
+    // 设置限速器（可为空），需在Start前设置
+    void SetBandwidthLimiter(BandwidthLimiter *pLimiter);
+
+    QString FilePath() const;
+    QString FileName() const;
+    qint64 FileSize() const;
+
+    // 开始（或失败后重新开始）上传
+    void Start();
+    // 取消上传，不再发出任何信号
+    void Abort();
+
+signals:
+    // 计算哈希的进度
+    void hashProgress(qint64 nDone, qint64 nTotal);
+    // 上传进度（已确认的块加上正在发送的字节）
+    void progress(qint64 nSent, qint64 nTotal);
+    // 上传完成，strServerPath为服务器返回的文件路径，bInstant表示服务器已有该文件（秒传）
+    void finished(const QString &strServerPath, bool bInstant);
+    // 上传失败
+    void failed(const QString &strError);
+
+private slots:
+    void OnHashProgress(int nRequestId, qint64 nDone, qint64 nTotal);
+    void OnHashFinished(int nRequestId, const QString &strHash);
+    void OnHashFailed(int nRequestId, const QString &strError);
+    void OnInstantCheckFinished();
+    void OnResumeCheckFinished();
+    void OnChunkFinished();
+    void OnChunkProgress(qint64 nSent, qint64 nTotal);
+    void OnMergeFinished();
+    void OnWholeFinished();
+
+private:
+    QNetworkAccessManager *m_pManager;
+    QString m_strServerUrl;
+    QString m_strFilePath;
+    QString m_strFileName;
+    QString m_strFileHash;
+    qint64 m_nFileSize;
+    int m_nTotalChunks;
+    QFile m_file;
+
+    QQueue<int> m_queuePending;             // 待上传的块
+    QHash<QNetworkReply*, int> m_hashRunning; // 正在上传的块
+    QHash<int, qint64> m_hashRunningBytes;  // 正在上传的块已发送的字节
+    QHash<int, int> m_hashRetries;          // 各块已重试次数
+    qint64 m_nDoneBytes;                    // 已确认的字节
+    QNetworkReply *m_pControlReply;         // 秒传检查、续传检查或合并请求
+    int m_nHashRequest;                     // 正在计算的哈希请求，-1表示没有
+    QPointer<BandwidthLimiter> m_pLimiter;
+    bool m_bFailed;
+
+    // 以JSON请求/api下的接口
+    QNetworkReply *PostJson(const QString &strPath, const QJsonObject &obj);
+    // 以multipart/form-data请求/api下的接口，文件字段的数据为文件中[nOffset, nOffset + nSize)
+    QNetworkReply *PostMultipart(const QString &strPath, const QList<QPair<QString, QByteArray>> &listFields,
+                                 const QString &strFileField, const QString &strFileName,
+                                 qint64 nOffset, qint64 nSize);
+    // 解析统一响应{code,message,data}，失败时返回false并填写错误信息
+    bool ParseResponse(QNetworkReply *pReply, QJsonObject &data, int &nCode, QString &strError) const;
+    // 询问服务器是否已有相同内容的文件
+    void CheckInstant();
+    // 查询服务器已保存的块
+    void CheckResume();
+    // 并发窗口未满时继续发送块
+    void StartChunks();
+    void StartChunk(int nIndex);
+    void Merge();
+    // 整体上传（服务器不接受该类型文件的分块上传时）
+    void UploadWhole();
+    void Fail(const QString &strError);
+    // 中止所有请求
+    void AbortReplies();
+    qint64 ChunkBytes(int nIndex) const;
+    void ReportProgress();
+};
+
+#endif // CHUNKUPLOADER_H
@@ -3,7 +3,6 @@
 
 #include <QString>
 #include <QWebSocket>
-#include <QSettings>
 
 // 应用版本（用于关于界面或日志）
 const QString APPLICATION_VERSION = "1.1.0";
@@ -12,10 +11,29 @@ const QString APPLICATION_VERSION = "1.1.0";
 // 配置文件中的键（用于QSettings存储服务器地址、用户信息等）
 const QString CURRENT_SERVER_HOST = "CURRENT_SERVER_HOST";       // 当前服务器IP
 const QString WEBSOCKET_SERVER_PORT = "WEBSOCKET_SERVER_PORT";   // WebSocket端口
+const QString SERVER_BACKUP_ENDPOINTS = "SERVER_BACKUP_ENDPOINTS"; // 备用服务器列表（"IP:PORT"）
 const QString WEBSOCKET_USER_PHONE = "WEBSOCKET_USER_PHONE";       // 用户手机号
 const QString WEBSOCKET_USER_ID = "WEBSOCKET_USER_ID";           // 用户ID
 const QString WEBSOCKET_USER_PWD = "WEBSOCKET_USER_PWD"; // 用户密码
 const QString WEBSOCKET_REMBER_PWD = "WEBSOCKET_REMBER_PWD";   // 是否记住密码
+const QString SESSION_TOKEN = "SESSION_TOKEN";                 // 上次登录的会话令牌（免登录启动）
+const QString SESSION_EXPIRES_AT = "SESSION_EXPIRES_AT";       // 会话令牌过期时间（Unix秒）
+const QString MESSAGE_MEMORY_BUDGET = "MESSAGE_MEMORY_BUDGET"; // 每个会话内存中保留的消息数
+const QString WEBSOCKET_BINARY_FORMAT = "WEBSOCKET_BINARY_FORMAT"; // 是否尝试协商CBOR二进制消息帧
+const QString INBOUND_FLUSH_INTERVAL = "INBOUND_FLUSH_INTERVAL"; // 收到的消息刷新到界面的间隔（毫秒）
+const QString TRANSFER_MAX_CONCURRENT = "TRANSFER_MAX_CONCURRENT"; // 同时进行的文件传输数
+const QString TRANSFER_BANDWIDTH_LIMIT = "TRANSFER_BANDWIDTH_LIMIT"; // 文件传输总限速（KB/s，0表示不限速）
+const QString ATTACHMENT_CACHE_LIMIT = "ATTACHMENT_CACHE_LIMIT"; // 本地附件缓存上限（MB）
+
+// 聊天记录默认参数
+const int DEFAULT_MESSAGE_MEMORY_BUDGET = 2000; // 每个会话内存中默认保留的消息数
+const int MESSAGE_PAGE_SIZE = 100;              // 启动和向上翻阅时每次从磁盘读取的消息数
+const int DEFAULT_INBOUND_FLUSH_INTERVAL = 16;  // 默认刷新间隔（约一帧）
+
+// 文件传输默认参数
+const int DEFAULT_TRANSFER_MAX_CONCURRENT = 3;  // 默认同时进行的传输数
+const int DEFAULT_TRANSFER_BANDWIDTH_LIMIT = 0; // 默认不限速
+const int DEFAULT_ATTACHMENT_CACHE_LIMIT = 1024; // 默认附件缓存上限（MB）
 
 // 消息类型（用于区分不同业务的WebSocket消息）
 const QString MSG_TYPE_CHAT = "chat";         // 普通聊天消息
@@ -23,6 +41,9 @@ const QString MSG_TYPE_ONLINE = "online";     // 在线用户列表
 const QString MSG_TYPE_FILE = "file";         // 文件传输消息
 const QString MSG_TYPE_LOGIN = "login";       // 登录状态消息
 
+// 群聊会话标识（与公共消息的键一致，私聊会话以对方用户ID为标识）
+const QString GROUP_CONVERSATION_ID = "message";
+
 // 应用路径（全局可访问的程序目录）
 extern QString APPLICATION_DIR;
 
@@ -38,6 +59,7 @@ typedef struct _UserInfo {
     QString strLoginTime; // 登录时间（用于显示在线状态）
     QString strEmail;     // 邮箱（预留）
 } UserInfo, *PUserInfo;
+Q_DECLARE_METATYPE(UserInfo)
 
 
 /**
@@ -53,7 +75,22 @@ typedef struct _MsgInfo {
 //    QString strFileSize;  // 文件大小（仅文件消息有值）
     QString fileLink;
     QString strEmail;    // 发送者邮箱（预留）
+    QString strClientMsgId; // 客户端消息ID（仅本端发出、等待服务器确认的消息有值）
 } MsgInfo, *PMsgInfo;
+Q_DECLARE_METATYPE(MsgInfo)
+
+// 本端发出消息的发送状态
+enum SendState {
+    SEND_STATE_NONE,      // 已确认（或收到的消息、历史消息）
+    SEND_STATE_SENDING,   // 已提交发送，等待服务器回显确认
+    SEND_STATE_FAILED     // 超时未确认
+};
+
+// 服务器响应码（与服务器response.ResCode一致）
+const int RESPONSE_CODE_SUCCESS = 200;              // 成功
+const int RESPONSE_CODE_INVALID_PARAM = 1003;       // 请求参数错误
+const int RESPONSE_CODE_TOKEN_INVALID = 2005;       // 会话令牌无效或已过期
+const int RESPONSE_CODE_INVALID_FILE_TYPE = 3013;   // 文件类型不支持
 
 enum HttpRequest {
     REQUEST_LOGIN, // 登录请求
@@ -62,8 +99,6 @@ enum HttpRequest {
 
 // -------------------------- 全局变量 --------------------------
 extern UserInfo g_stUserInfo;       // 当前登录用户信息
-extern QWebSocket g_WebSocket;      // 全局WebSocket对象（用于全项目通信）
-extern QSettings g_Settings;        // 全局配置对象（用于读写配置）
 
 // -------------------------- 工具函数 --------------------------
 /**
@@ -0,0 +1,75 @@
+#include "conversation.h"
+#include "messagedelegate.h"
+#include "messagehistory.h"
+
+Conversation::Conversation(const QString &strPeerId, const QString &strTitle, MessageHistory *pHistory,
+                           MessageDelegate *pDelegate, int nMemoryBudget) :
+    m_strPeerId(strPeerId),
+    m_strTitle(strTitle),
+    m_pView(nullptr),
+    m_pModel(nullptr),
+    m_nUnread(0)
+{
+    // 消息视图：只布局和绘制可见行，行高由模型缓存
+    m_pView = new QListView();
+    m_pModel = new MessageModel(pHistory, strPeerId, m_pView);
+    m_pModel->SetMemoryBudget(nMemoryBudget);
+    m_pView->setModel(m_pModel);
+    m_pView->setItemDelegate(pDelegate);
+    m_pView->setEditTriggers(QAbstractItemView::NoEditTriggers);  // 消息区域只读
+    m_pView->setSelectionMode(QAbstractItemView::NoSelection);
+    m_pView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    m_pView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    m_pView->setResizeMode(QListView::Adjust);     // 宽度变化时按新宽度重新排版（自动换行）
+    m_pView->setUniformItemSizes(false);
+    m_pView->setLayoutMode(QListView::Batched);    // 分批布局，单帧布局工作量有上限
+    m_pView->setBatchSize(200);
+}
+
+Conversation::~Conversation()
+{
+    delete m_pView;
+}
+
+QString Conversation::PeerId() const
+{
+    return m_strPeerId;
+}
+
+bool Conversation::IsGroup() const
+{
+    return m_strPeerId == GROUP_CONVERSATION_ID;
+}
+
+QString Conversation::TabText() const
+{
+    if (m_nUnread > 0) {
+        return QString("%1 (%2)").arg(m_strTitle).arg(m_nUnread);
+    }
+    return m_strTitle;
+}
+
+QListView *Conversation::View() const
+{
+    return m_pView;
+}
+
+MessageModel *Conversation::Model() const
+{
+    return m_pModel;
+}
+
+int Conversation::UnreadCount() const
+{
+    return m_nUnread;
+}
+
+void Conversation::IncreaseUnread(int nCount)
+{
+    m_nUnread += nCount;
+}
+
+void Conversation::ClearUnread()
+{
+    m_nUnread = 0;
+}
@@ -0,0 +1,48 @@
+#ifndef CONVERSATION_H
+#define CONVERSATION_H
+
+#include <QString>
+#include <QListView>
+#include "messagemodel.h"
+
+class MessageHistory;
+class MessageDelegate;
+
+/**
+ * @brief 一个聊天会话（群聊或与某个用户的私聊）
+ *
+ * 拥有会话的消息模型、消息视图和未读计数，由ChatWidget按对方用户ID登记，
+ * 消息路由只需一次哈希查找，与标签页的位置和顺序无关。
+ */
+class Conversation
+{
+public:
+    Conversation(const QString &strPeerId, const QString &strTitle, MessageHistory *pHistory,
+                 MessageDelegate *pDelegate, int nMemoryBudget);
+    // 释放视图（模型随视图释放），视图会自动从所在的标签页中移除
+    ~Conversation();
+
+    // 对方用户ID（群聊为GROUP_CONVERSATION_ID）
+    QString PeerId() const;
+    // 是否为群聊
+    bool IsGroup() const;
+    // 标签页标题（有未读消息时附带数量）
+    QString TabText() const;
+
+    QListView *View() const;
+    MessageModel *Model() const;
+
+    // 未读消息计数
+    int UnreadCount() const;
+    void IncreaseUnread(int nCount = 1);
+    void ClearUnread();
+
+private:
+    QString m_strPeerId;      // 对方用户ID
+    QString m_strTitle;       // 显示名称
+    QListView *m_pView;       // 消息视图
+    MessageModel *m_pModel;   // 消息模型（归视图所有）
+    int m_nUnread;            // 未读消息数
+};
+
+#endif // CONVERSATION_H
@@ -0,0 +1,101 @@
+#include "endpointselector.h"
+#include "appconfig.h"
+#include "chatconnection.h"
+#include <QDebug>
+
+EndpointSelector *EndpointSelector::m_pInstance = nullptr;
+
+EndpointSelector::EndpointSelector(QObject *parent) :
+    QObject(parent),
+    m_nFailed(0)
+{
+    m_timeoutTimer.setSingleShot(true);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, [this]() {
+        // 都连不上：留在当前服务器，由连接层继续按退避策略重连
+        qDebug() << "所有服务器均无法连接";
+        Finish();
+    });
+    // 修改服务器配置后重新选择
+    connect(AppConfig::GetInstance(), &AppConfig::serverChanged, this, &EndpointSelector::Probe);
+    // 断线或连接失败后，重连前先看看哪个服务器可用
+    connect(ChatConnection::GetInstance(), &ChatConnection::reconnectScheduled,
+            this, &EndpointSelector::OnReconnectScheduled);
+}
+
+void EndpointSelector::DestroyInstance()
+{
+    delete m_pInstance;
+    m_pInstance = nullptr;
+}
+
+void EndpointSelector::Probe()
+{
+    QStringList listEndpoints = AppConfig::GetInstance()->Endpoints();
+    if (listEndpoints.size() < 2 || !m_listSockets.isEmpty()) {
+        return;
+    }
+    m_clock.start();
+    m_nFailed = 0;
+    for (const QString &strEndpoint : listEndpoints) {
+        QTcpSocket *pSocket = new QTcpSocket(this);
+        m_listSockets.append(pSocket);
+        connect(pSocket, &QTcpSocket::connected, this, [this, strEndpoint]() {
+            OnProbeConnected(strEndpoint);
+        });
+        connect(pSocket, static_cast<void(QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error),
+                this, &EndpointSelector::OnProbeFailed);
+    }
+    // 先建好全部连接再发起，某个连接立即失败时失败数不会和尚未建立的连接比较；
+    // 发起过程中探测已结束（连接被清空）时不再继续
+    for (int i = 0; i < m_listSockets.size(); ++i) {
+        const QString &strEndpoint = listEndpoints.at(i);
+        int nPos = strEndpoint.lastIndexOf(':');
+        m_listSockets.at(i)->connectToHost(strEndpoint.left(nPos), static_cast<quint16>(strEndpoint.mid(nPos + 1).toUInt()));
+    }
+    if (!m_listSockets.isEmpty()) {
+        m_timeoutTimer.start(ENDPOINT_PROBE_TIMEOUT);
+    }
+}
+
+void EndpointSelector::OnReconnectScheduled()
+{
+    if (m_lastSwitch.isValid() && m_lastSwitch.elapsed() < ENDPOINT_FAILOVER_INTERVAL) {
+        return;
+    }
+    Probe();
+}
+
+void EndpointSelector::OnProbeConnected(const QString &strEndpoint)
+{
+    qDebug() << "选择服务器" << strEndpoint << "，连接耗时" << m_clock.elapsed() << "毫秒";
+    Finish();
+    AppConfig *pConfig = AppConfig::GetInstance();
+    if (strEndpoint == pConfig->ServerHost() + ":" + pConfig->ServerPort()) {
+        return;
+    }
+    // 连接层和网络层订阅了endpointChanged，随之切换
+    m_lastSwitch.start();
+    pConfig->SelectEndpoint(strEndpoint);
+}
+
+void EndpointSelector::OnProbeFailed()
+{
+    if (++m_nFailed < m_listSockets.size()) {
+        return;
+    }
+    // 都连不上：留在当前服务器，由连接层继续按退避策略重连
+    qDebug() << "所有服务器均无法连接";
+    Finish();
+}
+
+void EndpointSelector::Finish()
+{
+    m_timeoutTimer.stop();
+    for (QTcpSocket *pSocket : m_listSockets) {
+        // 断开信号后再中止，后连上的不再参与选择
+        pSocket->disconnect(this);
+        pSocket->abort();
+        pSocket->deleteLater();
+    }
+    m_listSockets.clear();
+}
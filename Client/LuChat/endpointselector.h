@@ -0,0 +1,62 @@
+#ifndef ENDPOINTSELECTOR_H
+#define ENDPOINTSELECTOR_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QList>
+
+// 探测参数
+const int ENDPOINT_PROBE_TIMEOUT = 3000;    // 所有服务器都连不上时放弃本次探测（毫秒）
+const int ENDPOINT_FAILOVER_INTERVAL = 10000; // 两次故障转移的最短间隔（毫秒），避免在能连上TCP
+                                              // 但WebSocket握手失败的服务器之间来回切换
+
+/**
+ * @brief 从配置的多个服务器中选出延迟最低的一个（全局唯一，界面线程使用）
+ *
+ * 同时向每个服务器发起TCP连接，最先连上的就是连接耗时最短、当前可用的
+ * 服务器，立即通过AppConfig::SelectEndpoint切换过去，其余探测随即放弃。
+ * 启动时、修改服务器配置后、以及WebSocket每次安排重连（断线或连接失败）
+ * 时各探测一次：当前服务器宕机时转移到最快的备用服务器，当前服务器仍是
+ * 最快的则留在原服务器，按原有的退避策略重连。全部连接失败或超时时放弃本次
+ * 探测。只配置了一个服务器时不探测。
+ */
+class EndpointSelector : public QObject
+{
+    Q_OBJECT
+
+public:
+    static EndpointSelector *GetInstance() {
+        if (m_pInstance == nullptr) {
+            m_pInstance = new EndpointSelector();
+        }
+        return m_pInstance;
+    }
+    static void DestroyInstance();
+
+    // 探测所有服务器，正在探测时不重复发起
+    void Probe();
+
+private:
+    explicit EndpointSelector(QObject *parent = nullptr);
+
+    // 连接层安排了重连：距上次切换足够久时探测
+    void OnReconnectScheduled();
+    // 某个服务器最先连上
+    void OnProbeConnected(const QString &strEndpoint);
+    // 某个服务器连接失败，全部失败时不必等到超时
+    void OnProbeFailed();
+    // 结束本次探测，放弃其余连接
+    void Finish();
+
+    QList<QTcpSocket *> m_listSockets;  // 正在进行的探测连接
+    int m_nFailed;                      // 本次探测中已失败的连接数
+    QElapsedTimer m_clock;              // 本次探测开始计时
+    QTimer m_timeoutTimer;              // 探测超时
+    QElapsedTimer m_lastSwitch;         // 上次切换服务器的时间（未切换过时无效）
+
+    static EndpointSelector *m_pInstance;
+};
+
+#endif // ENDPOINTSELECTOR_H
@@ -0,0 +1,169 @@
+#include "filehasher.h"
+#include <QFile>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QDebug>
+
+FileHasher *FileHasher::m_pInstance = nullptr;
+
+FileHasherWorker::FileHasherWorker() :
+    QObject(nullptr)
+{
+}
+
+void FileHasherWorker::Cancel(int nRequestId)
+{
+    QMutexLocker locker(&m_mutex);
+    m_setCanceled.insert(nRequestId);
+}
+
+bool FileHasherWorker::TakeCanceled(int nRequestId)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_setCanceled.remove(nRequestId);
+}
+
+void FileHasherWorker::Hash(int nRequestId, const QString &strFilePath)
+{
+    if (TakeCanceled(nRequestId)) {
+        return;
+    }
+    QFile file(strFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit failed(nRequestId, QString("文件打开失败: %1").arg(file.errorString()));
+        return;
+    }
+
+    QCryptographicHash hash(FILE_HASH_ALGORITHM);
+    const qint64 nTotal = file.size();
+    qint64 nDone = 0;
+    QByteArray buffer;
+    while (nDone < nTotal) {
+        if (TakeCanceled(nRequestId)) {
+            return;
+        }
+        qint64 nWindow = qMin(FILE_HASH_MAP_WINDOW, nTotal - nDone);
+        // 映射一个窗口，用完立即解除映射，避免占满进程地址空间
+        uchar *pData = file.map(nDone, nWindow);
+        if (pData) {
+            hash.addData(reinterpret_cast<const char*>(pData), static_cast<int>(nWindow));
+            file.unmap(pData);
+        } else {
+            // 无法映射（如网络文件系统），退回普通读取
+            if (!file.seek(nDone)) {
+                emit failed(nRequestId, QString("文件读取失败: %1").arg(file.errorString()));
+                return;
+            }
+            buffer = file.read(nWindow);
+            if (buffer.size() != nWindow) {
+                emit failed(nRequestId, QString("文件读取失败: %1").arg(file.errorString()));
+                return;
+            }
+            hash.addData(buffer);
+        }
+        nDone += nWindow;
+        emit progress(nRequestId, nDone, nTotal);
+    }
+    emit finished(nRequestId, QString::fromLatin1(hash.result().toHex()));
+}
+
+FileHasher::FileHasher(QObject *parent) :
+    QObject(parent),
+    m_pWorker(nullptr),
+    m_nNextRequestId(0),
+    m_pCache(nullptr)
+{
+    m_pCache = new HashCache(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+                             + "/hashcache.dat");
+
+    m_pWorker = new FileHasherWorker();
+    m_pWorker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_pWorker, &QObject::deleteLater);
+    connect(this, &FileHasher::hashRequested, m_pWorker, &FileHasherWorker::Hash);
+    // 结果回到界面线程后过滤已取消的请求
+    connect(m_pWorker, &FileHasherWorker::progress, this, [this](int nRequestId, qint64 nDone, qint64 nTotal) {
+        if (m_setPending.contains(nRequestId)) {
+            emit progress(nRequestId, nDone, nTotal);
+        }
+    });
+    connect(m_pWorker, &FileHasherWorker::finished, this, [this](int nRequestId, const QString &strHash) {
+        // 计算期间文件没有变化才记入缓存（取消的请求结果同样有效）
+        HashCacheEntry identity = m_hashIdentities.take(nRequestId);
+        HashCacheEntry current;
+        if (!identity.strPath.isEmpty() && HashCache::Identify(identity.strPath, current)
+                && current.nSize == identity.nSize && current.nModified == identity.nModified
+                && current.nInode == identity.nInode) {
+            current.strHash = strHash;
+            m_pCache->Insert(current);
+        }
+        if (m_setPending.remove(nRequestId)) {
+            emit finished(nRequestId, strHash);
+        }
+    });
+    connect(m_pWorker, &FileHasherWorker::failed, this, [this](int nRequestId, const QString &strError) {
+        m_hashIdentities.remove(nRequestId);
+        if (m_setPending.remove(nRequestId)) {
+            emit failed(nRequestId, strError);
+        }
+    });
+    m_thread.start(QThread::LowPriority);
+}
+
+FileHasher::~FileHasher()
+{
+    // 取消所有请求，正在计算的请求在当前窗口结束后返回
+    for (int nRequestId : m_setPending) {
+        m_pWorker->Cancel(nRequestId);
+    }
+    m_thread.quit();
+    m_thread.wait();
+    delete m_pCache;
+}
+
+void FileHasher::DestroyInstance()
+{
+    delete m_pInstance;
+    m_pInstance = nullptr;
+}
+
+int FileHasher::Hash(const QString &strFilePath)
+{
+    int nRequestId = ++m_nNextRequestId;
+    m_setPending.insert(nRequestId);
+
+    HashCacheEntry identity;
+    HashCacheEntry entry;
+    if (HashCache::Identify(strFilePath, identity) && m_pCache->Lookup(identity, entry)) {
+        // 文件未修改，直接返回缓存的哈希（排队发出，调用方先拿到请求ID）
+        QString strHash = entry.strHash;
+        QMetaObject::invokeMethod(this, [this, nRequestId, strHash]() {
+            if (m_setPending.remove(nRequestId)) {
+                emit finished(nRequestId, strHash);
+            }
+        }, Qt::QueuedConnection);
+        return nRequestId;
+    }
+    m_hashIdentities.insert(nRequestId, identity);
+    emit hashRequested(nRequestId, strFilePath);
+    return nRequestId;
+}
+
+void FileHasher::RecordUpload(const QString &strFilePath, const QString &strHash, const QString &strServerPath)
+{
+    HashCacheEntry identity;
+    HashCacheEntry entry;
+    if (HashCache::Identify(strFilePath, identity) && m_pCache->Lookup(identity, entry)
+            && entry.strHash == strHash && entry.strServerPath != strServerPath) {
+        entry.strServerPath = strServerPath;
+        m_pCache->Insert(entry);
+    }
+}
+
+void FileHasher::Cancel(int nRequestId)
+{
+    if (m_setPending.remove(nRequestId)) {
+        m_pWorker->Cancel(nRequestId);
+    }
+    // 取消后工作线程不再发出finished或failed，这里释放
+    m_hashIdentities.remove(nRequestId);
+}
@@ -0,0 +1,99 @@
+#ifndef FILEHASHER_H
+#define FILEHASHER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QSet>
+#include <QCryptographicHash>
+#include "hashcache.h"
+
+// 文件内容哈希算法（结果的十六进制字符串作为服务器的file_hash）
+const QCryptographicHash::Algorithm FILE_HASH_ALGORITHM = QCryptographicHash::Sha256;
+// 每次映射到内存的文件窗口大小，也是进度上报的粒度
+const qint64 FILE_HASH_MAP_WINDOW = 16 * 1024 * 1024;
+
+/**
+ * @brief 文件哈希工作对象（运行在FileHasher的工作线程中）
+ */
+class FileHasherWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    FileHasherWorker();
+
+    // 取消请求（线程安全，由界面线程直接调用，正在计算的请求在下一个窗口处停止）
+    void Cancel(int nRequestId);
+
+public slots:
+    // 计算文件内容哈希
+    void Hash(int nRequestId, const QString &strFilePath);
+
+signals:
+    void progress(int nRequestId, qint64 nDone, qint64 nTotal);
+    void finished(int nRequestId, const QString &strHash);
+    void failed(int nRequestId, const QString &strError);
+
+private:
+    QMutex m_mutex;
+    QSet<int> m_setCanceled;   // 已取消的请求
+
+    // 检查并清除取消标记
+    bool TakeCanceled(int nRequestId);
+};
+
+/**
+ * @brief 计算文件内容哈希（界面线程的入口）
+ *
+ * 请求排队到独立的低优先级线程依次执行，按窗口把文件映射到内存后流式
+ * 计算（映射失败时退回普通读取），内存占用与文件大小无关，界面线程
+ * 只收到进度和结果，多GB的文件也不会阻塞界面。
+ *
+ * 计算结果记入持久化的HashCache，文件未修改（路径、大小、修改时间、inode
+ * 都不变）时再次请求直接返回缓存的哈希，不再读取文件。
+ */
+class FileHasher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FileHasher *GetInstance() {
+        if (m_pInstance == nullptr) {
+            m_pInstance = new FileHasher();
+        }
+        return m_pInstance;
+    }
+    // 退出前结束工作线程
+    static void DestroyInstance();
+    ~FileHasher();
+
+    // 异步计算文件哈希，返回请求ID，结果通过finished/failed返回
+    int Hash(const QString &strFilePath);
+    // 取消请求，之后不再发出该请求的任何信号
+    void Cancel(int nRequestId);
+    // 记录文件已上传到服务器（文件内容仍为strHash时才记录）
+    void RecordUpload(const QString &strFilePath, const QString &strHash, const QString &strServerPath);
+
+signals:
+    void progress(int nRequestId, qint64 nDone, qint64 nTotal);
+    void finished(int nRequestId, const QString &strHash);
+    void failed(int nRequestId, const QString &strError);
+
+    // 内部信号：转发到工作线程
+    void hashRequested(int nRequestId, const QString &strFilePath);
+
+private:
+    explicit FileHasher(QObject *parent = nullptr);
+
+    QThread m_thread;
+    FileHasherWorker *m_pWorker;
+    int m_nNextRequestId;
+    QSet<int> m_setPending;    // 尚未完成的请求（界面线程）
+    HashCache *m_pCache;       // 哈希缓存（界面线程）
+    QHash<int, HashCacheEntry> m_hashIdentities; // 请求开始时文件的身份，用于确认计算期间文件未被修改
+
+    static FileHasher *m_pInstance;
+};
+
+#endif // FILEHASHER_H
@@ -0,0 +1,213 @@
+#include "hashcache.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// 缓存文件头
+static const quint32 HASH_CACHE_MAGIC = 0x4C484331;  // "LHC1"
+static const qint32 HASH_CACHE_VERSION = 1;
+
+// 文件的inode（Windows为卷内文件索引），取不到时为0
+static quint64 FileInode(const QString &strPath)
+{
+#if defined(Q_OS_WIN)
+    HANDLE hFile = CreateFileW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(strPath).utf16()),
+                               0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                               OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    quint64 nInode = 0;
+    BY_HANDLE_FILE_INFORMATION info;
+    if (GetFileInformationByHandle(hFile, &info)) {
+        nInode = (static_cast<quint64>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    }
+    CloseHandle(hFile);
+    return nInode;
+#else
+    struct stat st;
+    if (::stat(QFile::encodeName(strPath).constData(), &st) != 0) {
+        return 0;
+    }
+    return static_cast<quint64>(st.st_ino);
+#endif
+}
+
+static void WriteEntry(QDataStream &stream, const HashCacheEntry &entry)
+{
+    stream << entry.strPath << entry.nSize << entry.nModified << entry.nInode
+           << entry.strHash << entry.strServerPath << entry.nLastUsed;
+}
+
+static void ReadEntry(QDataStream &stream, HashCacheEntry &entry)
+{
+    stream >> entry.strPath >> entry.nSize >> entry.nModified >> entry.nInode
+           >> entry.strHash >> entry.strServerPath >> entry.nLastUsed;
+}
+
+HashCache::HashCache(const QString &strFilePath) :
+    m_strFilePath(strFilePath),
+    m_pFile(nullptr),
+    m_nRecords(0)
+{
+    QDir().mkpath(QFileInfo(m_strFilePath).absolutePath());
+    Load();
+}
+
+HashCache::~HashCache()
+{
+    delete m_pFile;
+}
+
+bool HashCache::Identify(const QString &strFilePath, HashCacheEntry &identity)
+{
+    QFileInfo fileInfo(strFilePath);
+    identity.strPath = fileInfo.canonicalFilePath();
+    if (identity.strPath.isEmpty() || !fileInfo.isFile()) {
+        return false;
+    }
+    identity.nSize = fileInfo.size();
+    identity.nModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    identity.nInode = FileInode(identity.strPath);
+    return true;
+}
+
+bool HashCache::Lookup(const HashCacheEntry &identity, HashCacheEntry &entry)
+{
+    auto it = m_hashEntries.find(identity.strPath);
+    if (it == m_hashEntries.end() || it->nSize != identity.nSize
+            || it->nModified != identity.nModified || it->nInode != identity.nInode) {
+        return false;
+    }
+    it->nLastUsed = QDateTime::currentMSecsSinceEpoch();
+    entry = it.value();
+    Append(entry);
+    return true;
+}
+
+void HashCache::Insert(const HashCacheEntry &entry)
+{
+    HashCacheEntry newEntry = entry;
+    newEntry.nLastUsed = QDateTime::currentMSecsSinceEpoch();
+    m_hashEntries.insert(newEntry.strPath, newEntry);
+    Append(newEntry);
+}
+
+void HashCache::Load()
+{
+    QFile file(m_strFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    if (file.size() == 0) {
+        return;
+    }
+    QDataStream stream(&file);
+    quint32 nMagic = 0;
+    qint32 nVersion = 0;
+    stream >> nMagic >> nVersion;
+    // 文件头或最后一条记录损坏时，之后追加的记录会跟在坏数据后面、再也读不回来，
+    // 需要按已读出的有效记录重写文件
+    bool bDamaged = false;
+    if (nMagic != HASH_CACHE_MAGIC || nVersion != HASH_CACHE_VERSION) {
+        qDebug() << "哈希缓存格式不匹配，重建:" << m_strFilePath;
+        bDamaged = true;
+    }
+    while (!bDamaged && !stream.atEnd()) {
+        HashCacheEntry entry;
+        ReadEntry(stream, entry);
+        if (stream.status() != QDataStream::Ok) {
+            // 最后一条记录写到一半（如异常退出），丢弃
+            bDamaged = true;
+            break;
+        }
+        m_hashEntries.insert(entry.strPath, entry);
+        ++m_nRecords;
+    }
+    file.close();
+
+    if (bDamaged || m_nRecords > m_hashEntries.size() * 2 + 64 || m_hashEntries.size() > HASH_CACHE_MAX_ENTRIES) {
+        Compact();
+    }
+}
+
+bool HashCache::OpenForAppend()
+{
+    if (m_pFile) {
+        return true;
+    }
+    m_pFile = new QFile(m_strFilePath);
+    if (!m_pFile->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "哈希缓存打开失败:" << m_pFile->errorString();
+        delete m_pFile;
+        m_pFile = nullptr;
+        return false;
+    }
+    if (m_pFile->size() == 0) {
+        QDataStream stream(m_pFile);
+        stream << HASH_CACHE_MAGIC << HASH_CACHE_VERSION;
+    }
+    return true;
+}
+
+void HashCache::Append(const HashCacheEntry &entry)
+{
+    if (!OpenForAppend()) {
+        return;
+    }
+    QDataStream stream(m_pFile);
+    WriteEntry(stream, entry);
+    m_pFile->flush();
+    ++m_nRecords;
+
+    if (m_nRecords > m_hashEntries.size() * 2 + 64 || m_hashEntries.size() > HASH_CACHE_MAX_ENTRIES) {
+        Compact();
+    }
+}
+
+void HashCache::Compact()
+{
+    QVector<HashCacheEntry> vecEntries;
+    vecEntries.reserve(m_hashEntries.size());
+    for (const HashCacheEntry &entry : m_hashEntries) {
+        vecEntries.append(entry);
+    }
+    // 只保留最近使用的HASH_CACHE_MAX_ENTRIES项
+    std::sort(vecEntries.begin(), vecEntries.end(), [](const HashCacheEntry &a, const HashCacheEntry &b) {
+        return a.nLastUsed > b.nLastUsed;
+    });
+    if (vecEntries.size() > HASH_CACHE_MAX_ENTRIES) {
+        vecEntries.resize(HASH_CACHE_MAX_ENTRIES);
+    }
+
+    delete m_pFile;
+    m_pFile = nullptr;
+    QSaveFile file(m_strFilePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "哈希缓存压缩失败:" << file.errorString();
+        return;
+    }
+    QDataStream stream(&file);
+    stream << HASH_CACHE_MAGIC << HASH_CACHE_VERSION;
+    m_hashEntries.clear();
+    for (const HashCacheEntry &entry : vecEntries) {
+        WriteEntry(stream, entry);
+        m_hashEntries.insert(entry.strPath, entry);
+    }
+    if (!file.commit()) {
+        qDebug() << "哈希缓存压缩失败:" << file.errorString();
+        return;
+    }
+    m_nRecords = m_hashEntries.size();
+}
@@ -0,0 +1,62 @@
+#ifndef HASHCACHE_H
+#define HASHCACHE_H
+
+#include <QString>
+#include <QHash>
+
+class QFile;
+
+// 缓存保留的最多文件数（压缩时按最近使用时间淘汰）
+const int HASH_CACHE_MAX_ENTRIES = 4096;
+
+/**
+ * @brief 一个文件的哈希缓存项
+ */
+typedef struct _HashCacheEntry {
+    QString strPath;        // 规范路径
+    qint64 nSize;           // 文件大小
+    qint64 nModified;       // 修改时间（毫秒）
+    quint64 nInode;         // inode（Windows为文件索引），同一路径被替换成另一个文件时不同
+    QString strHash;        // 内容哈希
+    QString strServerPath;  // 服务器上的文件路径（已上传过时有值）
+    qint64 nLastUsed;       // 最近使用时间（毫秒）
+} HashCacheEntry, *PHashCacheEntry;
+
+/**
+ * @brief 文件内容哈希的持久化缓存
+ *
+ * 以(规范路径, 大小, 修改时间, inode)为键记录文件的内容哈希和服务器上传
+ * 状态，再次分享未修改的文件时无需重新计算哈希。缓存文件是追加写日志，
+ * 加载时后写的记录覆盖先写的，失效记录过多时重写压缩。
+ * 非线程安全，由FileHasher在界面线程中使用。
+ */
+class HashCache
+{
+public:
+    explicit HashCache(const QString &strFilePath);
+    ~HashCache();
+
+    // 读取文件当前的身份（规范路径、大小、修改时间、inode），文件不存在返回false
+    static bool Identify(const QString &strFilePath, HashCacheEntry &identity);
+
+    // 查找与identity完全一致（文件未修改）的缓存项
+    bool Lookup(const HashCacheEntry &identity, HashCacheEntry &entry);
+    // 记录（或更新）缓存项
+    void Insert(const HashCacheEntry &entry);
+
+private:
+    QString m_strFilePath;                      // 缓存文件路径
+    QHash<QString, HashCacheEntry> m_hashEntries; // 规范路径 -> 缓存项
+    QFile *m_pFile;                             // 追加写的缓存文件
+    int m_nRecords;                             // 缓存文件中的记录数（含失效记录）
+
+    void Load();
+    // 追加一条记录
+    void Append(const HashCacheEntry &entry);
+    // 只保留最近使用的有效记录，重写缓存文件
+    void Compact();
+    // 打开缓存文件准备追加
+    bool OpenForAppend();
+};
+
+#endif // HASHCACHE_H
@@ -0,0 +1,78 @@
+#include "latencystats.h"
+#include <algorithm>
+
+LatencyStats::LatencyStats(int nWindow) :
+    m_nWindow(qMax(1, nWindow)),
+    m_nNext(0),
+    m_nLast(-1)
+{
+    m_vecSamples.reserve(m_nWindow);
+}
+
+void LatencyStats::AddSample(qint64 nMs)
+{
+    if (m_vecSamples.size() < m_nWindow) {
+        m_vecSamples.append(nMs);
+    } else {
+        m_vecSamples[m_nNext] = nMs;
+    }
+    m_nNext = (m_nNext + 1) % m_nWindow;
+    m_nLast = nMs;
+}
+
+void LatencyStats::Clear()
+{
+    m_vecSamples.clear();
+    m_nNext = 0;
+    m_nLast = -1;
+}
+
+int LatencyStats::Count() const
+{
+    return m_vecSamples.size();
+}
+
+qint64 LatencyStats::Last() const
+{
+    return m_nLast;
+}
+
+qint64 LatencyStats::Min() const
+{
+    if (m_vecSamples.isEmpty()) {
+        return -1;
+    }
+    return *std::min_element(m_vecSamples.constBegin(), m_vecSamples.constEnd());
+}
+
+qint64 LatencyStats::Max() const
+{
+    if (m_vecSamples.isEmpty()) {
+        return -1;
+    }
+    return *std::max_element(m_vecSamples.constBegin(), m_vecSamples.constEnd());
+}
+
+qint64 LatencyStats::Average() const
+{
+    if (m_vecSamples.isEmpty()) {
+        return -1;
+    }
+    qint64 nSum = 0;
+    for (qint64 nMs : m_vecSamples) {
+        nSum += nMs;
+    }
+    return nSum / m_vecSamples.size();
+}
+
+qint64 LatencyStats::Percentile(int nPercent) const
+{
+    if (m_vecSamples.isEmpty()) {
+        return -1;
+    }
+    // 窗口较小，复制后部分排序即可
+    QVector<qint64> vecSorted = m_vecSamples;
+    int nIndex = qBound(0, (vecSorted.size() * nPercent + 99) / 100 - 1, vecSorted.size() - 1);
+    std::nth_element(vecSorted.begin(), vecSorted.begin() + nIndex, vecSorted.end());
+    return vecSorted[nIndex];
+}
@@ -0,0 +1,39 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QVector>
+
+/**
+ * @brief 延迟统计（毫秒）
+ *
+ * 只保留最近nWindow个样本（环形缓冲），最小值、平均值和百分位数
+ * 都按这个滚动窗口计算，反映的是当前的网络状况。
+ */
+class LatencyStats
+{
+public:
+    explicit LatencyStats(int nWindow = 256);
+
+    // 记录一个样本
+    void AddSample(qint64 nMs);
+    // 清空所有样本
+    void Clear();
+
+    // 窗口内样本数
+    int Count() const;
+    // 最近一个样本，没有样本时为-1
+    qint64 Last() const;
+    qint64 Min() const;
+    qint64 Max() const;
+    qint64 Average() const;
+    // 百分位数（如99表示P99），没有样本时为-1
+    qint64 Percentile(int nPercent) const;
+
+private:
+    QVector<qint64> m_vecSamples;   // 环形缓冲
+    int m_nWindow;                  // 窗口大小
+    int m_nNext;                    // 下一个写入位置
+    qint64 m_nLast;                 // 最近一个样本
+};
+
+#endif // LATENCYSTATS_H
@@ -1,6 +1,5 @@
 #include "logindlg.h"
 #include "ui_logindlg.h"
-#include <QSettings>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
@@ -12,11 +11,14 @@
 #include "settingdlg.h"
 #include "common.h"
 #include "registrydlg.h"
+#include "networkmanager.h"
+#include "startuptimer.h"
+#include "session.h"
+#include "appconfig.h"
 
 LoginDlg::LoginDlg(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::LoginDlg),
-    m_pLoginManager(nullptr),
     m_bCtrlPressed(false),
     m_pRegisterDialog(nullptr) // 参数列表初始化
 {
@@ -45,12 +47,6 @@ LoginDlg::LoginDlg(QWidget *parent) :
 //    connect(ui->registrypushButton, &QPushButton::clicked,
 //            this, &LoginDlg::on_registrypushButton_clicked);
 
-    // 初始化网络请求管理器
-    // 当登录请求完成完成后，调用函数
-    m_pLoginManager = new QNetworkAccessManager(this);
-    connect(m_pLoginManager, &QNetworkAccessManager::finished,
-            this,&LoginDlg::on_loginReplyFinished);
-
     // 初始化注册对话框并关联信号
     // 接收注册对话框发送的注册成功信号，调用函数
     m_pRegisterDialog = new RegistryDlg(this);
@@ -62,7 +58,6 @@ LoginDlg::~LoginDlg()
 {
     delete ui;
     // 释放空间
-    if (m_pLoginManager) delete m_pLoginManager;
     if (m_pRegisterDialog) delete m_pRegisterDialog;
 }
 
@@ -124,14 +119,10 @@ void LoginDlg::sendLoginRequest(const QString &userPhone, const QString &passwor
     qDebug() << "开始发送登录请求...";
     
     // 从配置获取服务器信息
-    QSettings settings;
-    QString ip = settings.value(CURRENT_SERVER_HOST).toString();
-    QString port = settings.value(WEBSOCKET_SERVER_PORT).toString();
-    
-    qDebug() << "配置的服务器IP:" << ip;
-    qDebug() << "配置的服务器端口:" << port;
-    
-    if (ip.isEmpty() || port.isEmpty()) {
+    AppConfig *pConfig = AppConfig::GetInstance();
+    qDebug() << "配置的服务器:" << pConfig->HttpUrl();
+
+    if (!pConfig->HasServer()) {
         qDebug() << "错误：服务器配置为空";
         QMessageBox::warning(this,"提示","请先配置服务器信息");
         ui->loginpushButton->setEnabled(true);
@@ -140,7 +131,7 @@ void LoginDlg::sendLoginRequest(const QString &userPhone, const QString &passwor
     }
 
     // 构建登录请求的URL - 修正为正确的API路径
-    QUrl url(QString("http://%1:%2/api/login").arg(ip).arg(port));
+    QUrl url = pConfig->ApiUrl("/api/login");
     QNetworkRequest request(url);
     // 设置请求头
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
@@ -155,8 +146,13 @@ void LoginDlg::sendLoginRequest(const QString &userPhone, const QString &passwor
     qDebug() << "发送登录请求到:" << url.toString();
     qDebug() << "请求数据:" << data;
 
-    // 发送请求
-    m_pLoginManager->post(request,data);
+    // 发送请求（共享的网络管理器，通常已预连接到服务器）
+    StartupTimer::Mark("发送登录请求");
+    QNetworkReply *pReply = NetworkManager::GetInstance()->post(request, data);
+    // 当登录请求完成完成后，调用函数
+    connect(pReply, &QNetworkReply::finished, this, [this, pReply]() {
+        on_loginReplyFinished(pReply);
+    });
 }
 
 
@@ -166,6 +162,7 @@ void LoginDlg::sendLoginRequest(const QString &userPhone, const QString &passwor
 void LoginDlg::on_loginReplyFinished(QNetworkReply *reply)
 {
     qDebug() << "收到登录响应";
+    StartupTimer::Mark("收到登录响应");
     
     // 恢复登录状态按钮
     ui->loginpushButton->setEnabled(true);
@@ -196,9 +193,10 @@ void LoginDlg::on_loginReplyFinished(QNetworkReply *reply)
     QString message = jsonObj["message"].toString();
 
     if ( code == 200 ) {
-        // 保存用户信息到全局变量（服务端可能未返回 userphone，回退到输入框）
-        QString respPhone = jsonObj["userphone"].toString();
-        QString respUserId = jsonObj["userid"].toString();
+        // 保存用户信息到全局变量（用户信息在data中，userid为数字；服务端可能未返回 userphone，回退到输入框）
+        QJsonObject dataObj = jsonObj["data"].toObject();
+        QString respPhone = dataObj["userphone"].toString();
+        QString respUserId = dataObj["userid"].toVariant().toString();
         if (respPhone.isEmpty()) {
             respPhone = ui->phonelineEdit->text().trimmed();
         }
@@ -209,11 +207,13 @@ void LoginDlg::on_loginReplyFinished(QNetworkReply *reply)
         // 保存当前时间
         g_stUserInfo.strLoginTime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
 
-        // 根据复选框状态保存密码
+        // 根据复选框状态保存密码，记住密码时同时保存会话令牌，下次启动免登录
         if (ui->passwordcheckBox->isChecked()) {
             saveUserInfo(ui->phonelineEdit->text(), ui->passwordlineEdit->text());
+            Session::Save(dataObj);
         } else {
             saveUserInfo(ui->phonelineEdit->text(),"");
+            AppConfig::GetInstance()->ClearSession();
         }
 
         QMessageBox::information(this, "登录成功", message);
@@ -242,10 +242,10 @@ void LoginDlg::on_registrypushButton_clicked()
 void LoginDlg::loadSavedUserInfo()
 {
     // 配置信息加载
-    QSettings settings;
-    QString userPhone = settings.value(WEBSOCKET_USER_PHONE).toString();
-    QString password = settings.value(WEBSOCKET_USER_PWD).toString();
-    bool rememberPwd = settings.value(WEBSOCKET_REMBER_PWD).toBool();
+    AppConfig *pConfig = AppConfig::GetInstance();
+    QString userPhone = pConfig->SavedUserPhone();
+    QString password = pConfig->SavedPassword();
+    bool rememberPwd = pConfig->RememberPassword();
 
     // 如果不为空，设置lineEdit内容
     if (!userPhone.isEmpty()) {
@@ -260,10 +260,7 @@ void LoginDlg::loadSavedUserInfo()
 // 保存用户信息
 void LoginDlg::saveUserInfo(const QString &userPhone, const QString &password)
 {
-    QSettings settings;
-    settings.setValue(WEBSOCKET_USER_PHONE, userPhone);
-    settings.setValue(WEBSOCKET_USER_PWD, password);
-    settings.setValue(WEBSOCKET_REMBER_PWD, ui->passwordcheckBox->isChecked());
+    AppConfig::GetInstance()->SetSavedLogin(userPhone, password, ui->passwordcheckBox->isChecked());
 }
 
 
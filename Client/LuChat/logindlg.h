@@ -42,8 +42,6 @@ protected:
 
 private:
     Ui::LoginDlg *ui;
-    // 登录请求网络管理器
-    QNetworkAccessManager *m_pLoginManager;
     // 注册对话框对象，堆上手动管理
     RegistryDlg *m_pRegisterDialog;
 
@@ -4,9 +4,20 @@
 #include "common.h"
 #include "settingdlg.h"
 #include "logindlg.h"
+#include "chatconnection.h"
+#include "filehasher.h"
+#include "attachmentcache.h"
+#include "thumbnailloader.h"
+#include "networkmanager.h"
+#include "startuptimer.h"
+#include "session.h"
+#include "appconfig.h"
+#include "endpointselector.h"
+#include <QMessageBox>
 
 int main(int argc, char *argv[])
 {
+    StartupTimer::Start();
     QApplication a(argc, argv);
 
     // 初始化应用程序目录
@@ -20,25 +31,67 @@ int main(int argc, char *argv[])
     QCoreApplication::setOrganizationName("private");
     QCoreApplication::setApplicationName("LuClient");
 
+    // 配置只在这里读取一次，之后都从AppConfig取
+    AppConfig *pConfig = AppConfig::GetInstance();
     // 如果配置信息为空，触发设置对话框
-    QSettings settings;
-    QString ip = settings.value(CURRENT_SERVER_HOST).toString();
-    QString port = settings.value(WEBSOCKET_SERVER_PORT).toString();
-    if (ip.isEmpty() || port.isEmpty()) {
+    if (!pConfig->HasServer()) {
         SettingDlg *settingdlg = SettingDlg::GetInstance();
         if (settingdlg->exec() != QDialog::Accepted) {
             return 0; // 用户取消设置，退出程序
         }
     }
 
-    qDebug() << "ip:" << ip;
-    qDebug() << "port:" << port;
+    qDebug() << "ip:" << pConfig->ServerHost();
+    qDebug() << "port:" << pConfig->ServerPort();
+    StartupTimer::Mark("读取配置");
 
+    // 保存了未过期的会话令牌时跳过登录对话框，令牌在后台校验
+    bool bAutoLogin = Session::Restore();
+
+    // 用户输入登录信息期间完成与服务器的握手：HTTP连接供登录请求使用，
+    // WebSocket在登录成功前就已连上，登录后即可聊天
+    NetworkManager::GetInstance()->PreConnect();
+    ChatConnection *pConnection = ChatConnection::GetInstance();
+    // 聊天窗口创建前收到的消息先暂存
+    pConnection->HoldEvents(true);
+    QObject::connect(pConnection, &ChatConnection::connected, []() {
+        StartupTimer::Mark("WebSocket已连接");
+    });
+    pConnection->Open(pConfig->WebSocketUrl());
+    StartupTimer::Mark("开始预连接");
+    // 配置了多个服务器时同时探测，最快的不是当前服务器则切换过去（连接层随之重连）
+    EndpointSelector::GetInstance()->Probe();
+
+    // 保存的会话令牌由同一个Session在后台校验（启动时、修改服务器配置后、WebSocket握手被拒时），
+    // 被拒绝时清除令牌；主窗口显示后还要重新登录（见下）
+    Session *pSession = new Session(pConnection);
+
+    // 修改服务器配置后网络层和连接层自行切换（登录前和聊天中都可以修改），不重启程序
+    QObject::connect(pConfig, &AppConfig::serverChanged, pSession, [pConfig, pSession]() {
+        // 保存了会话令牌：向新服务器确认，不被接受时才需要重新登录
+        if (!pConfig->SessionToken().isEmpty()) {
+            pSession->Validate();
+        }
+    });
+    // 服务器拒绝WebSocket握手（QWebSocket报ConnectionRefusedError）多半是令牌已失效，
+    // 向服务器确认后走同样的重新登录流程；只是服务器没启动时校验请求同样连不上，不会误判
+    QObject::connect(pConnection, &ChatConnection::errorOccurred, pSession,
+                     [pSession](QAbstractSocket::SocketError err, const QString &) {
+        if (err == QAbstractSocket::ConnectionRefusedError) {
+            pSession->Validate();
+        }
+    });
 
     // 登录对话框
-    LoginDlg *loginDialog = new LoginDlg();
-    int nRet = loginDialog->exec();
-    delete loginDialog;
+    int nRet = QDialog::Accepted;
+    if (bAutoLogin) {
+        StartupTimer::Mark("恢复会话");
+    } else {
+        LoginDlg *loginDialog = new LoginDlg();
+        StartupTimer::Mark("创建登录对话框");
+        nRet = loginDialog->exec();
+        delete loginDialog;
+    }
 
     if (nRet == QDialog::Accepted) {
         // 登录成功，创建并显示主窗口
@@ -46,7 +99,49 @@ int main(int argc, char *argv[])
         // 设置主窗口标题
         w->setWindowTitle(g_stUserInfo.strUserPhone);
         w->show();
-        return a.exec();
+        StartupTimer::Mark("显示主窗口");
+        // 令牌被拒绝时在当前进程中弹出登录对话框，聊天窗口、已加载的消息和连接都保留；
+        // 登录的是另一个账号时界面上的会话不属于新账号，才重启程序
+        QObject::connect(pSession, &Session::rejected, w, [w, pConnection](const QString &strMessage) {
+            QMessageBox::warning(w, "登录已失效", QString("%1，请重新登录").arg(strMessage));
+            QString strUserId = g_stUserInfo.strUserId;
+            LoginDlg loginDialog(w);
+            if (loginDialog.exec() != QDialog::Accepted) {
+                // 取消登录，退出
+                QApplication::quit();
+                return;
+            }
+            if (g_stUserInfo.strUserId != strUserId) {
+                RestartApp();
+                return;
+            }
+            // 新令牌已由登录对话框保存（连接层随之更新），重新通告上线并跳过重连等待
+            pConnection->SetPresence(g_stUserInfo);
+            pConnection->ReconnectNow();
+        });
+        if (bAutoLogin) {
+            // 后台校验令牌：通过后换用新令牌（新令牌由AppConfig通知连接层，之后重连时使用）
+            QObject::connect(pSession, &Session::validated, []() {
+                StartupTimer::Mark("会话校验通过");
+            });
+            pSession->Validate();
+        }
+        // 主窗口显示且WebSocket已连接时启动完成
+        if (pConnection->IsConnected()) {
+            StartupTimer::Finish();
+        } else {
+            QObject::connect(pConnection, &ChatConnection::connected, &StartupTimer::Finish);
+        }
+        int nExitCode = a.exec();
+        // 关闭连接并结束网络线程、缩略图线程池、附件缓存线程、哈希线程
+        EndpointSelector::DestroyInstance();
+        ChatConnection::DestroyInstance();
+        ThumbnailLoader::DestroyInstance();
+        NetworkManager::DestroyInstance();
+        AttachmentCache::DestroyInstance();
+        FileHasher::DestroyInstance();
+        AppConfig::DestroyInstance();
+        return nExitCode;
     } else {
         // 取消登录，退出
         exit(-1);
@@ -1,70 +1,121 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include <QStandardPaths>
+#include "attachmentcache.h"
+#include "networkmanager.h"
+#include "appconfig.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow),
       m_pChatWidget(nullptr),
-      m_pAccessManager(nullptr),
-      m_pProgressDlg(nullptr)
+      m_pTransferScheduler(nullptr),
+      m_pTransferDock(nullptr),
+      m_pNetStatusLabel(nullptr)
 {
     ui->setupUi(this);
 
     // 初始化聊天对话框
     m_pChatWidget = new ChatWidget();
     setCentralWidget(m_pChatWidget);
-
-    // 加载服务器地址并连接WebSocket
-    QString ip = m_Settings.value(CURRENT_SERVER_HOST).toString();
-    QString port = m_Settings.value(WEBSOCKET_SERVER_PORT).toString();
-    m_strWsUrl = QString("ws://%1:%2/ws").arg(ip).arg(port);
-    g_WebSocket.open(QUrl(m_strWsUrl));
-
-
-    // 初始化文件网络请求管理器，网络请求（文件上传）完成信号
-    m_pAccessManager = new QNetworkAccessManager(this);
-    connect(m_pAccessManager, &QNetworkAccessManager::finished,this,
-            &MainWindow::replyFinished);
+    // 状态栏显示发送延迟和拥塞状态
+    m_pNetStatusLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_pNetStatusLabel);
+
+    // WebSocket在启动时已与登录同时连接（main），这里只更新上线信息和重连地址
+    ChatConnection *pConnection = ChatConnection::GetInstance();
+    // 上线通知由连接层在每次连上（包括重连）后发送；登录期间已连上时立即发送
+    pConnection->SetPresence(g_stUserInfo);
+
+
+    // 文件传输统一排队，在停靠的传输面板中显示，不阻塞聊天
+    // （分块上传的并发请求与登录等请求共用同一个网络管理器的连接）
+    m_pTransferScheduler = new TransferScheduler(NetworkManager::GetInstance(), this);
+    AppConfig *pConfig = AppConfig::GetInstance();
+    auto applyTransferSettings = [this, pConfig]() {
+        m_pTransferScheduler->SetMaxConcurrent(pConfig->TransferMaxConcurrent());
+        m_pTransferScheduler->SetBandwidthLimit(static_cast<qint64>(pConfig->TransferBandwidthLimit()) * 1024);
+    };
+    applyTransferSettings();
+    connect(pConfig, &AppConfig::transferSettingsChanged, this, applyTransferSettings);
+    m_pTransferDock = new QDockWidget("文件传输", this);
+    m_pTransferDock->setObjectName("TransferDock");
+    m_pTransferDock->setWidget(new TransferPanel(m_pTransferScheduler, m_pTransferDock));
+    addDockWidget(Qt::BottomDockWidgetArea, m_pTransferDock);
+    m_pTransferDock->hide();
+    connect(m_pTransferScheduler, &TransferScheduler::transferAdded, m_pTransferDock, &QDockWidget::show);
+    connect(m_pTransferScheduler, &TransferScheduler::uploadFinished, this, &MainWindow::OnTransferUploaded);
+    connect(m_pTransferScheduler, &TransferScheduler::downloadFinished, this, [this](int nId, const QString &strSavePath) {
+        // 校验后放入附件缓存，再次打开同一文件时不再下载
+        QString strFileHash = m_hashDownloadHashes.take(nId);
+        if (!strFileHash.isEmpty()) {
+            AttachmentCache::GetInstance()->Store(strFileHash, strSavePath);
+        }
+        statusBar()->showMessage(QString("文件已下载到 %1").arg(strSavePath), 5000);
+    });
+    // 附件缓存命中时从本地副本复制到保存位置
+    connect(AttachmentCache::GetInstance(), &AttachmentCache::exported, this, [this](const QString &strDestPath, bool bOk) {
+        QPair<QString, QString> request = m_hashCacheExports.take(strDestPath);
+        if (bOk) {
+            statusBar()->showMessage(QString("已从本地缓存保存到 %1").arg(strDestPath), 5000);
+        } else if (!request.first.isEmpty()) {
+            StartDownload(request.first, request.second, strDestPath);
+        }
+    });
+    connect(m_pTransferScheduler, &TransferScheduler::transferRemoved, this, [this](int nId) {
+        m_hashDownloadHashes.remove(nId);
+    });
+    connect(m_pTransferScheduler, &TransferScheduler::transferFailed, this, [this](int nId, const QString &strError) {
+        statusBar()->showMessage(QString("%1 传输失败（可在传输面板中继续）: %2")
+                                 .arg(m_pTransferScheduler->Info(nId).strName).arg(strError), 10000);
+    });
 
     // 绑定WebSocket信号槽
     // WeSocket连接信号到来，调用函数
-    connect(&g_WebSocket, &QWebSocket::connected, this, &MainWindow::OnWebSocketConnected);
+    connect(pConnection, &ChatConnection::connected, this, &MainWindow::OnWebSocketConnected);
     // 断开WeSocket连接，调用函数
-    connect(&g_WebSocket, &QWebSocket::disconnected, this, &MainWindow::OnWebSocketDisconnected);
-//    connect(&g_WebSocket, &QWebSocket::errorOccurred, this, &MainWindow::OnWebSocketError);
+    connect(pConnection, &ChatConnection::disconnected, this, &MainWindow::OnWebSocketDisconnected);
+    // 断线后按退避策略自动重连
+    connect(pConnection, &ChatConnection::reconnectScheduled, this, &MainWindow::OnReconnectScheduled);
     // WeSocket出错，调用错误函数
-    connect(&g_WebSocket, static_cast<void(QWebSocket::*)(QAbstractSocket::SocketError)>(&QWebSocket::error),
-            this, &MainWindow::OnWebSocketError);
+    connect(pConnection, &ChatConnection::errorOccurred, this, &MainWindow::OnWebSocketError);
+    // 发送延迟和拥塞状态
+    connect(pConnection, &ChatConnection::sendLatencyMeasured, this, &MainWindow::UpdateNetworkStatus);
+    connect(pConnection, &ChatConnection::congestionChanged, this, &MainWindow::UpdateNetworkStatus);
+    connect(pConnection, &ChatConnection::rttMeasured, this, &MainWindow::UpdateNetworkStatus);
 
     // 绑定聊天界面信号 实现聊天窗口与WebSocket当前进行信号传递
     // 新消息到达
     connect(m_pChatWidget, &ChatWidget::newMessageArrived, this, &MainWindow::OnNewMessageArrived);
     // 文件上传请求
     connect(m_pChatWidget, &ChatWidget::uploadFile, this, &MainWindow::OnUploadFile);
+    // 点击消息中的文件链接下载
+    connect(m_pChatWidget, &ChatWidget::downloadFile, this, &MainWindow::OnDownloadFile);
+    // 切换服务器（修改配置或故障转移）时连接层自行重连，聊天记录和缓存保留
+    connect(pConfig, &AppConfig::endpointChanged, this, [this, pConfig]() {
+        statusBar()->showMessage(QString("正在切换到服务器 %1 ...").arg(pConfig->HttpUrl()), 5000);
+    });
+
+    // 登录期间已经连上：补上连接成功的处理，并交出暂存的消息
+    if (pConnection->IsConnected()) {
+        OnWebSocketConnected();
+    }
+    pConnection->HoldEvents(false);
 }
 
 MainWindow::~MainWindow()
 {
-    if (g_WebSocket.isValid()) {
-        g_WebSocket.close();
-    }
+    ChatConnection::GetInstance()->Close();
     delete m_pChatWidget;
-    delete m_pAccessManager;
-    delete m_pProgressDlg;
+    delete m_pTransferScheduler;
     delete ui;
 }
 
 // WebSocket连接成功处理函数
 void MainWindow::OnWebSocketConnected()
 {
-    qDebug() << "WebSocket发送成功";
-    QJsonObject jsonObj;
-    jsonObj["userphone"] = g_stUserInfo.strUserPhone;
-    jsonObj["userid"] = g_stUserInfo.strUserId;
-    QJsonObject onlineObj;
-    onlineObj["online"] = jsonObj;
-    // 发送当前在线用户json消息
-    g_WebSocket.sendTextMessage(QJsonDocument(onlineObj).toJson(QJsonDocument::Compact));
+    qDebug() << "WebSocket连接成功";
+    statusBar()->clearMessage();
     // 启用发送按钮
     m_pChatWidget->SetSendBtnEnabled(true);
     // 添加当前用户到在线列表
@@ -73,18 +124,23 @@ void MainWindow::OnWebSocketConnected()
 
 void MainWindow::OnWebSocketDisconnected()
 {
-    qDebug() << "WebSocket断开，尝试重连...";
-    // 禁用发送和上传按钮
+    qDebug() << "WebSocket断开";
+    // 禁用发送和上传按钮（重连由连接层负责）
     m_pChatWidget->SetSendBtnEnabled(false);
-    // 重连
-    g_WebSocket.open(QUrl(m_strWsUrl));
+}
+
+void MainWindow::OnReconnectScheduled(int nAttempt, int nDelayMs)
+{
+    qDebug() << "WebSocket将在" << nDelayMs << "毫秒后第" << nAttempt << "次重连";
+    statusBar()->showMessage(QString("连接已断开，%1 秒后第 %2 次重连...")
+                             .arg(nDelayMs / 1000.0, 0, 'f', 1).arg(nAttempt), nDelayMs);
 }
 
 // WebSocket错误
-void MainWindow::OnWebSocketError(QAbstractSocket::SocketError err) {
+void MainWindow::OnWebSocketError(QAbstractSocket::SocketError err, const QString &strError) {
 //    qDebug() << "WebSocket错误：" << WEBSOCKET_ERROR_STRINGS[err + 1];
     qDebug() << "错误代码:" << err;
-    qDebug() << "错误描述:" << g_WebSocket.errorString(); // 这是最重要的信息
+    qDebug() << "错误描述:" << strError; // 这是最重要的信息
 //    映射
     int index = static_cast<int>(err);
     if (index >= 0 && index < 24) {
@@ -92,6 +148,27 @@ void MainWindow::OnWebSocketError(QAbstractSocket::SocketError err) {
     }
 }
 
+void MainWindow::UpdateNetworkStatus()
+{
+    ChatConnection *pConnection = ChatConnection::GetInstance();
+    const LatencyStats &rtt = pConnection->RoundTripTime();
+    const LatencyStats &latency = pConnection->SendLatency();
+    QStringList listStatus;
+    if (rtt.Count() > 0) {
+        listStatus << QString("RTT: 最小 %1 ms，平均 %2 ms，P99 %3 ms")
+                      .arg(rtt.Min()).arg(rtt.Average()).arg(rtt.Percentile(99));
+    }
+    if (latency.Count() > 0) {
+        listStatus << QString("发送延迟: 最近 %1 ms，平均 %2 ms，P99 %3 ms")
+                      .arg(latency.Last()).arg(latency.Average()).arg(latency.Percentile(99));
+    }
+    QString strStatus = listStatus.join("  ");
+    if (pConnection->IsCongested()) {
+        strStatus += (strStatus.isEmpty() ? "" : "  ") + QString("网络拥塞，消息排队发送中");
+    }
+    m_pNetStatusLabel->setText(strStatus);
+}
+
 void MainWindow::OnNewMessageArrived()
 {
     QApplication::alert(this); // 窗口闪烁提醒
@@ -105,42 +182,6 @@ bool MainWindow::isNetworkAvailable() const
     return manager.isOnline();
 }
 
-void MainWindow::showUploadProgressDialog(const QString &fileName, qint64 fileSize, QNetworkReply *reply)
-{
-    // 创建或重置进度对话框
-        if (!m_pProgressDlg) {
-            m_pProgressDlg = new QProgressDialog(this);
-            m_pProgressDlg->setWindowTitle("上传文件"); // 设置标题
-            m_pProgressDlg->setLabelText("正在上传..."); // 设置标签文本
-            m_pProgressDlg->setCancelButtonText("取消"); // 取消按钮文本
-            m_pProgressDlg->setMinimumDuration(0); // 进度条最小值
-            m_pProgressDlg->setAutoClose(true);
-            m_pProgressDlg->setAutoReset(true);
-        }
-
-        m_pProgressDlg->setLabelText(QString("正在上传: %1").arg(fileName));
-        m_pProgressDlg->setMaximum(fileSize); // 最大值文件大小
-        m_pProgressDlg->setValue(0);
-        m_pProgressDlg->show();
-
-        // 连接取消信号，当点击取消按钮，中断上传
-        connect(m_pProgressDlg, &QProgressDialog::canceled, this, [this, reply]() {
-            if (reply && reply->isRunning()) {
-                reply->abort();
-            }
-            if (m_pProgressDlg) {
-                m_pProgressDlg->hide();
-            }
-        });
-
-        // 连接finished信号来自动关闭对话框
-        connect(reply, &QNetworkReply::finished, this, [this]() {
-            if (m_pProgressDlg && m_pProgressDlg->isVisible()) {
-                m_pProgressDlg->hide();
-            }
-        });
-}
-
 // 点击文件上传后，调用
 void MainWindow::OnUploadFile(const QString &filePath)
 {
@@ -156,126 +197,75 @@ void MainWindow::OnUploadFile(const QString &filePath)
             return;
         }
 
-        // 3. 检查文件大小（避免上传过大文件）
-        const qint64 maxFileSize = 100 * 1024 * 1024; // 100MB
-        if (fileInfo.size() > maxFileSize) {
-            QMessageBox::warning(this, "文件过大",
-                QString("文件大小 (%1 MB) 超过限制 (%2 MB)")
-                    .arg(fileInfo.size() / (1024.0 * 1024.0), 0, 'f', 1)
-                    .arg(maxFileSize / (1024 * 1024)));
-            return;
-        }
-
-        // 4. 检查网络连接状态
+        // 3. 检查网络连接状态
         if (!isNetworkAvailable()) {
             QMessageBox::warning(this, "网络错误", "网络连接不可用");
             return;
         }
 
 
-        // 5. 构建URL（添加参数验证）
-        QString ip = m_Settings.value(CURRENT_SERVER_HOST).toString();
-        QString port = m_Settings.value(WEBSOCKET_SERVER_PORT).toString();
-
-        if (ip.isEmpty() || port.isEmpty()) {
+        // 4. 构建URL（添加参数验证）
+        QString strServerUrl = ServerHttpUrl();
+        if (strServerUrl.isEmpty()) {
             QMessageBox::warning(this, "配置错误", "服务器地址或端口未配置");
             return;
         }
-
-        QUrl url(QString("http://%1:%2/api/upload").arg(ip).arg(port));
-        if (!url.isValid()) {
+        if (!QUrl(strServerUrl).isValid()) {
             QMessageBox::warning(this, "错误", "无效的URL地址");
             return;
         }
 
-
-        // 使用 multipart/form-data 适配服务端 c.FormFile("file")
-        QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-
-        // 文件部分
-        QHttpPart filePart;
-        // 设置Header
-        filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
-                           QVariant(QString("form-data; name=\"file\"; filename=\"%1\"")
-                                   .arg(fileInfo.fileName())));
-
-        // 绑定文件数据为设备，避免一次性读入内存
-        QFile *upFile = new QFile(filePath);
-        if (!upFile->open(QIODevice::ReadOnly)) {
-            delete upFile;
-            delete multiPart;
-            QMessageBox::warning(this, "错误", "文件打开失败");
-            return;
-        }
-        filePart.setBodyDevice(upFile);
-        upFile->setParent(multiPart); // 由 multiPart 管理释放
-        multiPart->append(filePart);
-
-        // 用户名部分（服务端使用 PostForm("userphone")）
-        QHttpPart userPart;
-        userPart.setHeader(QNetworkRequest::ContentDispositionHeader,
-                           QVariant("form-data; name=\"userphone\""));
-        userPart.setBody(g_stUserInfo.strUserPhone.toUtf8());
-        multiPart->append(userPart);
-
-        // 发起请求
-        QNetworkRequest req(url);
-        req.setRawHeader("Accept", "application/json");
-        QNetworkReply *reply = m_pAccessManager->post(req, multiPart);
-        multiPart->setParent(reply); // reply 删除时一并释放
-
-
-        // 绑定上传信号，错误发生处理函数，文件上传进度条
-        connect(reply, static_cast<void(QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
-                this,&MainWindow::upLoadError);
-
-        connect(reply, &QNetworkReply::uploadProgress, this,&MainWindow::OnUploadProgress);
-
-        // 删除由 replyFinished 统一负责，不在此处重复 deleteLater
-
-        // 10. 显示进度对话框（改进用户体验）
-        showUploadProgressDialog(fileInfo.fileName(), fileInfo.size(), reply);
+        // 5. 加入传输队列，分块并发上传（大小不限，失败后再次上传同一文件从断点继续）
+        m_pTransferScheduler->AddUpload(strServerUrl, filePath);
     }
 
-    // 文件请求信号完成，接收响应
-    void MainWindow::replyFinished(QNetworkReply *reply)
-    {
-        const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        const QByteArray body = reply->readAll();
-        qDebug() << "Upload finished, status:" << httpStatus << ", error:" << reply->error()
-                 << ", errorString:" << reply->errorString() << ", body:" << body;
-
-        if (reply->error() == QNetworkReply::NoError && httpStatus == 200) {
-            QMessageBox::information(this, "成功", "文件上传成功");
-        } else {
-            QString reason = reply->errorString();
-            if (!body.isEmpty()) {
-                reason += "\n" + QString::fromUtf8(body);
-            }
-            QMessageBox::warning(this, "失败", QString("文件上传失败\n%1").arg(reason));
-        }
-        // 上传完成，隐藏消息对话框
-        if (m_pProgressDlg) {
-            m_pProgressDlg->hide();
-        }
-        reply->deleteLater();
+QString MainWindow::ServerHttpUrl() const
+{
+    return AppConfig::GetInstance()->HttpUrl();
 }
 
+void MainWindow::OnTransferUploaded(int nId, const QString &strServerPath, const QString &strFileHash, bool bInstant)
+{
+    qDebug() << "Upload finished:" << m_pTransferScheduler->Info(nId).strName << strServerPath << ", instant:" << bInstant;
+    OnFileUploaded(strServerPath, strFileHash);
+}
 
-
-// 上传错误
-void MainWindow::upLoadError(QNetworkReply::NetworkError err)
+void MainWindow::OnFileUploaded(const QString &strServerPath, const QString &strFileHash)
 {
-    qDebug() << "上传错误：" << err;
-    if (m_pProgressDlg) m_pProgressDlg->hide();
+    if (strServerPath.isEmpty()) {
+        return;
+    }
+    m_pChatWidget->SetFileLink(AttachmentCache::LinkWithHash(strServerPath, strFileHash));
+    statusBar()->showMessage("文件已上传，下一条消息将附带文件链接", 5000);
 }
 
-// 上传进度条设置接收数据和总文件大小
-void MainWindow::OnUploadProgress(qint64 recved, qint64 total)
+// 点击消息中的文件链接：保存到用户选择的位置，附件缓存中已有该文件时从本地复制，否则分段下载
+void MainWindow::OnDownloadFile(const QString &fileName, const QString &fileHash)
 {
-    if (m_pProgressDlg) {
-        m_pProgressDlg->setMaximum(total);
-        m_pProgressDlg->setValue(recved);
+    const QString startPath = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation) + "/" + fileName;
+    QString savePath = QFileDialog::getSaveFileName(this, "保存文件", startPath);
+    if (savePath.isEmpty()) {
+        return;
     }
+    if (!AttachmentCache::GetInstance()->Lookup(fileHash).isEmpty()) {
+        m_hashCacheExports.insert(savePath, qMakePair(fileName, fileHash));
+        AttachmentCache::GetInstance()->Export(fileHash, savePath);
+        return;
+    }
+    StartDownload(fileName, fileHash, savePath);
 }
 
+void MainWindow::StartDownload(const QString &fileName, const QString &fileHash, const QString &savePath)
+{
+    QString strServerUrl = ServerHttpUrl();
+    if (strServerUrl.isEmpty()) {
+        QMessageBox::warning(this, "配置错误", "服务器地址或端口未配置");
+        return;
+    }
+
+    // 同一目标已有未完成的下载（<目标>.part.state）时从断点继续
+    int nId = m_pTransferScheduler->AddDownload(strServerUrl, fileName, savePath);
+    if (!fileHash.isEmpty()) {
+        m_hashDownloadHashes.insert(nId, fileHash);
+    }
+}
@@ -5,13 +5,14 @@
 #include "common.h"
 #include "chatwidget.h"
 #include <QNetworkAccessManager>
-#include <QProgressDialog>
 #include <QMessageBox>
 #include <QNetworkRequest>
 #include <QNetworkReply>
-#include <QProgressDialog>
 #include <QNetworkConfigurationManager>
-#include <QHttpMultiPart>
+#include <QLabel>
+#include <QDockWidget>
+#include "transferscheduler.h"
+#include "transferpanel.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -28,29 +29,36 @@ public:
 private slots:
     void OnWebSocketConnected();    // WebSocket连接成功
     void OnWebSocketDisconnected(); // WebSocket断开
-    void OnWebSocketError(QAbstractSocket::SocketError err); // 连接错误
+    void OnReconnectScheduled(int nAttempt, int nDelayMs); // 已安排重连
+    void OnWebSocketError(QAbstractSocket::SocketError err, const QString &strError); // 连接错误
     void OnNewMessageArrived();     // 新消息提醒
     void OnUploadFile(const QString &filePath); // 处理文件上传
-    void replyFinished(QNetworkReply *reply); // 上传响应
-    void upLoadError(QNetworkReply::NetworkError err); // 上传错误
-    void OnUploadProgress(qint64 recved, qint64 total); // 上传进度
+    void OnDownloadFile(const QString &fileName, const QString &fileHash); // 下载服务器上的文件
+    void OnTransferUploaded(int nId, const QString &strServerPath, const QString &strFileHash, bool bInstant); // 上传完成
+    void UpdateNetworkStatus();     // 刷新状态栏中的网络状态（RTT、发送延迟、拥塞）
 
 private:
     Ui::MainWindow *ui;
     // 聊天窗口实例
     ChatWidget          *m_pChatWidget;
 
-    // 配置与状态
-    QString m_strWsUrl;  // WebSocket服务器地址
-    QSettings m_Settings;  // 配置存储（服务器地址、端口等
-
-    // 文件上传网络请求管理器
-    QNetworkAccessManager  *m_pAccessManager;
-    // 上传进度对话框
-    QProgressDialog *m_pProgressDlg;
+    // 文件传输队列和传输面板
+    TransferScheduler *m_pTransferScheduler;
+    QDockWidget *m_pTransferDock;
+    // 正在下载的任务ID -> 链接中的内容哈希（完成后校验并放入附件缓存）
+    QHash<int, QString> m_hashDownloadHashes;
+    // 正在从附件缓存复制的目标路径 -> (服务器上的文件名, 内容哈希)（复制失败时改为下载）
+    QHash<QString, QPair<QString, QString>> m_hashCacheExports;
+    // 状态栏网络状态
+    QLabel *m_pNetStatusLabel;
 
     bool isNetworkAvailable() const;
 
-    void showUploadProgressDialog(const QString &fileName, qint64 fileSize, QNetworkReply *reply);
+    // 服务器HTTP地址（形如"http://host:port"），未配置时为空
+    QString ServerHttpUrl() const;
+    // 上传完成：下一条消息附带文件链接（链接中带内容哈希，供接收方查附件缓存）
+    void OnFileUploaded(const QString &strServerPath, const QString &strFileHash);
+    // 把服务器上的文件分段下载到savePath
+    void StartDownload(const QString &fileName, const QString &fileHash, const QString &savePath);
 };
 #endif // MAINWINDOW_H
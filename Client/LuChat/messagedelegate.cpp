@@ -0,0 +1,179 @@
+#include "messagedelegate.h"
+#include "messagemodel.h"
+#include "thumbnailloader.h"
+#include <QPainter>
+#include <QApplication>
+#include <QAbstractItemView>
+#include <QMouseEvent>
+#include <climits>
+
+// 排版参数
+static const int MESSAGE_PADDING = 6;        // 行内边距
+static const int MESSAGE_INDENT = 12;        // 内容缩进
+static const int MESSAGE_SPACING = 2;        // 行内各部分间距
+static const QString FILE_LINK_TEXT = "[文件]";
+
+MessageDelegate::MessageDelegate(QObject *parent) :
+    QStyledItemDelegate(parent)
+{
+}
+
+// 视图可用宽度：排版始终以视口宽度为准，保证sizeHint与paint一致
+int MessageDelegate::ViewWidth(const QStyleOptionViewItem &option) const
+{
+    const QAbstractItemView *pView = qobject_cast<const QAbstractItemView*>(option.widget);
+    if (pView) {
+        return pView->viewport()->width();
+    }
+    return option.rect.width();
+}
+
+MessageDelegate::MessageLayout MessageDelegate::LayoutMessage(const QStyleOptionViewItem &option,
+                                                              const QModelIndex &index, int width) const
+{
+    MessageLayout layout;
+    QFont boldFont = option.font;
+    boldFont.setBold(true);
+    QFontMetrics fmBold(boldFont);
+    QFontMetrics fm(option.font);
+
+    int nTextWidth = qMax(1, width - 2 * MESSAGE_PADDING - MESSAGE_INDENT);
+    int y = MESSAGE_PADDING;
+
+    // 发送者 + 时间占一行
+    layout.rcHeader = QRect(MESSAGE_PADDING, y, width - 2 * MESSAGE_PADDING, fmBold.height());
+    y += layout.rcHeader.height() + MESSAGE_SPACING;
+
+    // 内容按宽度自动换行
+    QString strContent = index.data(MessageModel::ContentRole).toString();
+    QRect rcText = fm.boundingRect(QRect(0, 0, nTextWidth, INT_MAX), Qt::TextWordWrap, strContent);
+    layout.rcContent = QRect(MESSAGE_PADDING + MESSAGE_INDENT, y, nTextWidth, rcText.height());
+    y += layout.rcContent.height();
+
+    // 文件链接单独一行
+    QString strLink = index.data(MessageModel::FileLinkRole).toString();
+    if (!strLink.isEmpty()) {
+        y += MESSAGE_SPACING;
+        layout.rcLink = QRect(MESSAGE_PADDING + MESSAGE_INDENT, y,
+                              fm.boundingRect(FILE_LINK_TEXT).width(), fm.height());
+        y += layout.rcLink.height();
+    }
+
+    // 图片在链接下方预留缩略图的位置
+    if (ThumbnailLoader::IsImageLink(strLink)) {
+        y += MESSAGE_SPACING;
+        layout.rcThumbnail = QRect(MESSAGE_PADDING + MESSAGE_INDENT, y, THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+        y += layout.rcThumbnail.height();
+    }
+
+    layout.nHeight = y + MESSAGE_PADDING;
+    return layout;
+}
+
+QSize MessageDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    int width = ViewWidth(option);
+    // 优先使用模型中的行高缓存
+    const MessageModel *pModel = qobject_cast<const MessageModel*>(index.model());
+    if (pModel) {
+        int nCached = pModel->CachedHeight(index.row(), width);
+        if (nCached >= 0) {
+            return QSize(width, nCached);
+        }
+    }
+
+    int height = LayoutMessage(option, index, width).nHeight;
+    if (pModel) {
+        pModel->SetCachedHeight(index.row(), width, height);
+    }
+    return QSize(width, height);
+}
+
+void MessageDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                            const QModelIndex &index) const
+{
+    // 背景（选中/悬停状态）
+    QStyleOptionViewItem opt = option;
+    initStyleOption(&opt, index);
+    opt.text.clear();
+    QStyle *pStyle = option.widget ? option.widget->style() : QApplication::style();
+    pStyle->drawPrimitive(QStyle::PE_PanelItemViewItem, &opt, painter, option.widget);
+
+    MessageLayout layout = LayoutMessage(option, index, ViewWidth(option));
+
+    painter->save();
+    painter->translate(option.rect.topLeft());
+
+    // 发送者（加粗）+ 时间（灰色）
+    QFont boldFont = option.font;
+    boldFont.setBold(true);
+    QString strHeader = index.data(MessageModel::UserPhoneRole).toString() + "：";
+    painter->setFont(boldFont);
+    painter->setPen(option.palette.color(QPalette::Text));
+    QRect rcPhone;
+    painter->drawText(layout.rcHeader, Qt::AlignLeft | Qt::AlignVCenter, strHeader, &rcPhone);
+    painter->setFont(option.font);
+    painter->setPen(Qt::gray);
+    QRect rcTime;
+    painter->drawText(layout.rcHeader.adjusted(rcPhone.width(), 0, 0, 0), Qt::AlignLeft | Qt::AlignVCenter,
+                      QString("(%1)").arg(index.data(MessageModel::TimeRole).toString()), &rcTime);
+
+    // 本端发出消息的发送状态
+    int nSendState = index.data(MessageModel::SendStateRole).toInt();
+    if (nSendState != SEND_STATE_NONE) {
+        painter->setPen(nSendState == SEND_STATE_FAILED ? Qt::red : Qt::gray);
+        painter->drawText(layout.rcHeader.adjusted(rcPhone.width() + rcTime.width() + MESSAGE_INDENT, 0, 0, 0),
+                          Qt::AlignLeft | Qt::AlignVCenter,
+                          nSendState == SEND_STATE_FAILED ? "发送失败" : "发送中…");
+    }
+
+    // 内容
+    painter->setPen(option.palette.color(QPalette::Text));
+    painter->drawText(layout.rcContent, Qt::TextWordWrap, index.data(MessageModel::ContentRole).toString());
+
+    // 文件链接
+    if (!layout.rcLink.isEmpty()) {
+        QFont linkFont = option.font;
+        linkFont.setUnderline(true);
+        painter->setFont(linkFont);
+        painter->setPen(option.palette.color(QPalette::Link));
+        painter->drawText(layout.rcLink, Qt::AlignLeft | Qt::AlignVCenter, FILE_LINK_TEXT);
+    }
+
+    // 缩略图：只有绘制到的（可见的）消息才会请求生成
+    if (!layout.rcThumbnail.isEmpty()) {
+        QString strLink = index.data(MessageModel::FileLinkRole).toString();
+        QImage image = ThumbnailLoader::GetInstance()->Thumbnail(strLink);
+        if (!image.isNull()) {
+            painter->drawImage(layout.rcThumbnail.topLeft(), image);
+        } else {
+            painter->fillRect(layout.rcThumbnail, option.palette.color(QPalette::AlternateBase));
+            painter->setFont(option.font);
+            painter->setPen(Qt::gray);
+            painter->drawText(layout.rcThumbnail, Qt::AlignCenter,
+                              ThumbnailLoader::GetInstance()->IsFailed(strLink) ? "无法预览" : "加载中…");
+        }
+    }
+
+    painter->restore();
+}
+
+// 点击文件链接或缩略图
+bool MessageDelegate::editorEvent(QEvent *event, QAbstractItemModel *model,
+                                  const QStyleOptionViewItem &option, const QModelIndex &index)
+{
+    if (event->type() == QEvent::MouseButtonRelease) {
+        QMouseEvent *pMouseEvent = static_cast<QMouseEvent*>(event);
+        if (pMouseEvent->button() == Qt::LeftButton) {
+            MessageLayout layout = LayoutMessage(option, index, ViewWidth(option));
+            QRect rcLink = layout.rcLink.translated(option.rect.topLeft());
+            QRect rcThumbnail = layout.rcThumbnail.translated(option.rect.topLeft());
+            if ((!layout.rcLink.isEmpty() && rcLink.contains(pMouseEvent->pos()))
+                    || (!layout.rcThumbnail.isEmpty() && rcThumbnail.contains(pMouseEvent->pos()))) {
+                emit linkActivated(index.data(MessageModel::FileLinkRole).toString());
+                return true;
+            }
+        }
+    }
+    return QStyledItemDelegate::editorEvent(event, model, option, index);
+}
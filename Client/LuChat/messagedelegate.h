@@ -0,0 +1,49 @@
+#ifndef MESSAGEDELEGATE_H
+#define MESSAGEDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QRect>
+
+/**
+ * @brief 聊天消息绘制委托
+ *
+ * 每条消息按"发送者 + 时间 / 内容 / [文件]链接 / 图片缩略图"排版，
+ * 视图只对可见行调用paint，行高通过MessageModel缓存。缩略图由
+ * ThumbnailLoader异步生成，排版时按固定大小预留位置，加载前后行高不变。
+ */
+class MessageDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit MessageDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+signals:
+    void linkActivated(const QString &strLink); // 点击了消息中的文件链接
+
+protected:
+    bool editorEvent(QEvent *event, QAbstractItemModel *model,
+                     const QStyleOptionViewItem &option, const QModelIndex &index) override;
+
+private:
+    // 单条消息的排版结果（坐标相对于行的左上角）
+    typedef struct _MessageLayout {
+        QRect rcHeader;   // 发送者和时间
+        QRect rcContent;  // 消息内容
+        QRect rcLink;     // 文件链接（无链接时为空）
+        QRect rcThumbnail; // 图片缩略图的预留位置（不是图片时为空）
+        int nHeight;      // 行高
+    } MessageLayout;
+
+    // 计算指定宽度下的排版
+    MessageLayout LayoutMessage(const QStyleOptionViewItem &option, const QModelIndex &index,
+                                int width) const;
+    // 当前视图可用宽度
+    int ViewWidth(const QStyleOptionViewItem &option) const;
+};
+
+#endif // MESSAGEDELEGATE_H
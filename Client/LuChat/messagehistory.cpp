@@ -0,0 +1,80 @@
+#include "messagehistory.h"
+#include "messagestore.h"
+
+MessageHistoryWorker::MessageHistoryWorker(const QString &strDir) :
+    QObject(nullptr),
+    m_strDir(strDir),
+    m_pStore(nullptr)
+{
+}
+
+MessageHistoryWorker::~MessageHistoryWorker()
+{
+    delete m_pStore;
+}
+
+void MessageHistoryWorker::Append(const QString &strConversation, const QVector<MsgInfo> &vecMsgInfos)
+{
+    if (!m_pStore) {
+        m_pStore = new MessageStore(m_strDir);
+    }
+    m_pStore->Append(strConversation, vecMsgInfos);
+}
+
+void MessageHistoryWorker::LoadPage(const QString &strConversation, qint64 nBefore, int nCount)
+{
+    if (!m_pStore) {
+        m_pStore = new MessageStore(m_strDir);
+    }
+    qint64 nTotal = m_pStore->Count(strConversation);
+    if (nBefore < 0 || nBefore > nTotal) {
+        nBefore = nTotal;
+    }
+    qint64 nFirst = qMax<qint64>(0, nBefore - nCount);
+    QVector<MsgInfo> vecMsgInfos = m_pStore->Read(strConversation, nFirst, static_cast<int>(nBefore - nFirst));
+    emit pageLoaded(strConversation, nFirst, nTotal, vecMsgInfos);
+}
+
+void MessageHistoryWorker::Sync()
+{
+}
+
+MessageHistory::MessageHistory(const QString &strDir, QObject *parent) :
+    QObject(parent),
+    m_pWorker(nullptr)
+{
+    qRegisterMetaType<QVector<MsgInfo>>("QVector<MsgInfo>");
+
+    m_pWorker = new MessageHistoryWorker(strDir);
+    m_pWorker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_pWorker, &QObject::deleteLater);
+    connect(this, &MessageHistory::appendRequested, m_pWorker, &MessageHistoryWorker::Append);
+    connect(this, &MessageHistory::pageRequested, m_pWorker, &MessageHistoryWorker::LoadPage);
+    connect(m_pWorker, &MessageHistoryWorker::pageLoaded, this, &MessageHistory::pageLoaded);
+    m_thread.start(QThread::LowPriority);
+}
+
+MessageHistory::~MessageHistory()
+{
+    // 等待已排队的写入完成后再退出线程，保证退出前的消息都已落盘
+    QMetaObject::invokeMethod(m_pWorker, "Sync", Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void MessageHistory::Append(const QString &strConversation, const MsgInfo &msgInfo)
+{
+    emit appendRequested(strConversation, QVector<MsgInfo>() << msgInfo);
+}
+
+void MessageHistory::Append(const QString &strConversation, const QVector<MsgInfo> &vecMsgInfos)
+{
+    if (!vecMsgInfos.isEmpty()) {
+        emit appendRequested(strConversation, vecMsgInfos);
+    }
+}
+
+void MessageHistory::RequestPage(const QString &strConversation, qint64 nBefore, int nCount)
+{
+    emit pageRequested(strConversation, nBefore, nCount);
+}
@@ -0,0 +1,74 @@
+#ifndef MESSAGEHISTORY_H
+#define MESSAGEHISTORY_H
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include "common.h"
+
+class MessageStore;
+
+/**
+ * @brief 消息存储工作对象（运行在MessageHistory的工作线程中）
+ */
+class MessageHistoryWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MessageHistoryWorker(const QString &strDir);
+    ~MessageHistoryWorker();
+
+public slots:
+    // 追加写入消息
+    void Append(const QString &strConversation, const QVector<MsgInfo> &vecMsgInfos);
+    // 读取序号nBefore之前的一页消息，nBefore为-1时读取最新的一页
+    void LoadPage(const QString &strConversation, qint64 nBefore, int nCount);
+    // 空操作，用于等待此前排队的写入全部完成
+    void Sync();
+
+signals:
+    void pageLoaded(const QString &strConversation, qint64 nFirstSeq, qint64 nTotal,
+                    const QVector<MsgInfo> &vecMsgInfos);
+
+private:
+    QString m_strDir;
+    MessageStore *m_pStore;  // 在工作线程中创建和使用
+};
+
+/**
+ * @brief 本地持久化聊天记录（界面线程的入口）
+ *
+ * 所有磁盘读写都排队到独立线程执行，界面线程只投递请求、接收分页结果，
+ * 因此消息到达和启动加载都不会因历史记录规模而阻塞界面。
+ */
+class MessageHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MessageHistory(const QString &strDir, QObject *parent = nullptr);
+    ~MessageHistory();
+
+    // 异步追加一条消息
+    void Append(const QString &strConversation, const MsgInfo &msgInfo);
+    // 异步追加一批消息（一次排队、一次写入）
+    void Append(const QString &strConversation, const QVector<MsgInfo> &vecMsgInfos);
+    // 异步请求序号nBefore之前的一页消息（-1表示最新一页），结果通过pageLoaded返回
+    void RequestPage(const QString &strConversation, qint64 nBefore, int nCount);
+
+signals:
+    // 分页读取完成：nFirstSeq为第一条消息的序号，nTotal为请求时该会话的消息总数
+    void pageLoaded(const QString &strConversation, qint64 nFirstSeq, qint64 nTotal,
+                    const QVector<MsgInfo> &vecMsgInfos);
+
+    // 内部信号：转发到工作线程
+    void appendRequested(const QString &strConversation, const QVector<MsgInfo> &vecMsgInfos);
+    void pageRequested(const QString &strConversation, qint64 nBefore, int nCount);
+
+private:
+    QThread m_thread;
+    MessageHistoryWorker *m_pWorker;
+};
+
+#endif // MESSAGEHISTORY_H
@@ -0,0 +1,318 @@
+#include "messagemodel.h"
+#include "messagehistory.h"
+
+// 每行固定开销估算（行结构 + 各字符串的共享数据头）
+static const qint64 ROW_OVERHEAD_BYTES = 160;
+
+MessageModel::MessageModel(MessageHistory *pHistory, const QString &strConversation, QObject *parent) :
+    QAbstractListModel(parent),
+    m_pHistory(pHistory),
+    m_strConversation(strConversation),
+    m_nMemoryBudget(0),
+    m_bLoaded(false),
+    m_bFetching(false),
+    m_bFetchingNewer(false),
+    m_nFirstSeq(0),
+    m_nNewerOnDisk(0),
+    m_nMemoryBytes(0)
+{
+    // 异步加载最新一页，不阻塞会话创建
+    if (m_pHistory) {
+        connect(m_pHistory, &MessageHistory::pageLoaded, this, &MessageModel::OnPageLoaded);
+        m_bFetching = true;
+        m_pHistory->RequestPage(m_strConversation, -1, MESSAGE_PAGE_SIZE);
+    } else {
+        m_bLoaded = true;
+    }
+}
+
+int MessageModel::rowCount(const QModelIndex &parent) const
+{
+    // 列表模型没有子节点
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_vecRows.size();
+}
+
+QVariant MessageModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_vecRows.size()) {
+        return QVariant();
+    }
+
+    const MsgInfo &msgInfo = m_vecRows[index.row()].msgInfo;
+    switch (role) {
+    case Qt::DisplayRole:
+    case ContentRole:
+        return msgInfo.strContent;
+    case UserPhoneRole:
+        return msgInfo.strUserPhone;
+    case UserIdRole:
+        return msgInfo.strUserId;
+    case TimeRole:
+        return msgInfo.strTime;
+    case FileLinkRole:
+        return msgInfo.fileLink;
+    case SendStateRole:
+        return m_vecRows[index.row()].eSendState;
+    default:
+        return QVariant();
+    }
+}
+
+MessageModel::MessageRow MessageModel::MakeRow(const MsgInfo &msgInfo) const
+{
+    MessageRow msgRow;
+    msgRow.msgInfo = msgInfo;
+    msgRow.nCachedWidth = -1;
+    msgRow.nCachedHeight = -1;
+    // 带客户端消息ID的是本端刚发出、尚未确认的消息
+    msgRow.eSendState = msgInfo.strClientMsgId.isEmpty() ? SEND_STATE_NONE : SEND_STATE_SENDING;
+    return msgRow;
+}
+
+qint64 MessageModel::RowBytes(const MsgInfo &msgInfo)
+{
+    qint64 nChars = msgInfo.strUserPhone.capacity() + msgInfo.strUserId.capacity()
+            + msgInfo.strContent.capacity() + msgInfo.strTime.capacity()
+            + msgInfo.fileLink.capacity() + msgInfo.strEmail.capacity();
+    return ROW_OVERHEAD_BYTES + nChars * static_cast<qint64>(sizeof(QChar));
+}
+
+// 追加消息，只通知新增的一行
+void MessageModel::AppendMessage(const MsgInfo &msgInfo)
+{
+    if (m_pHistory) {
+        m_pHistory->Append(m_strConversation, msgInfo);
+    }
+    if (m_nNewerOnDisk > 0) {
+        // 与内存中的行不相邻，回到底部时再读回
+        ++m_nNewerOnDisk;
+        return;
+    }
+    int row = m_vecRows.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_vecRows.append(MakeRow(msgInfo));
+    m_nMemoryBytes += RowBytes(msgInfo);
+    endInsertRows();
+}
+
+void MessageModel::AppendMessages(const QVector<MsgInfo> &vecMsgInfos)
+{
+    if (vecMsgInfos.isEmpty()) {
+        return;
+    }
+    if (m_pHistory) {
+        m_pHistory->Append(m_strConversation, vecMsgInfos);
+    }
+    if (m_nNewerOnDisk > 0) {
+        m_nNewerOnDisk += vecMsgInfos.size();
+        return;
+    }
+    int row = m_vecRows.size();
+    beginInsertRows(QModelIndex(), row, row + vecMsgInfos.size() - 1);
+    m_vecRows.reserve(row + vecMsgInfos.size());
+    for (const MsgInfo &msgInfo : vecMsgInfos) {
+        m_vecRows.append(MakeRow(msgInfo));
+        m_nMemoryBytes += RowBytes(msgInfo);
+    }
+    endInsertRows();
+}
+
+const MsgInfo &MessageModel::MessageAt(int row) const
+{
+    return m_vecRows[row].msgInfo;
+}
+
+void MessageModel::SetSendState(const QString &strClientMsgId, SendState eState)
+{
+    // 等待确认的消息都在末尾附近
+    for (int row = m_vecRows.size() - 1; row >= 0; --row) {
+        MessageRow &msgRow = m_vecRows[row];
+        if (msgRow.msgInfo.strClientMsgId != strClientMsgId) {
+            continue;
+        }
+        if (msgRow.eSendState != eState) {
+            msgRow.eSendState = eState;
+            QModelIndex idx = index(row);
+            emit dataChanged(idx, idx, QVector<int>() << SendStateRole);
+        }
+        return;
+    }
+}
+
+int MessageModel::CachedHeight(int row, int width) const
+{
+    if (row < 0 || row >= m_vecRows.size()) {
+        return -1;
+    }
+    const MessageRow &msgRow = m_vecRows[row];
+    return msgRow.nCachedWidth == width ? msgRow.nCachedHeight : -1;
+}
+
+void MessageModel::SetCachedHeight(int row, int width, int height) const
+{
+    if (row < 0 || row >= m_vecRows.size()) {
+        return;
+    }
+    m_vecRows[row].nCachedWidth = width;
+    m_vecRows[row].nCachedHeight = height;
+}
+
+void MessageModel::SetMemoryBudget(int nMaxMessages)
+{
+    m_nMemoryBudget = nMaxMessages;
+}
+
+void MessageModel::EnforceMemoryBudget()
+{
+    // 最新一页加载前行序号未知，暂不收缩
+    if (!m_pHistory || !m_bLoaded || m_nMemoryBudget <= 0 || m_vecRows.size() <= m_nMemoryBudget) {
+        return;
+    }
+    int nEvict = m_vecRows.size() - m_nMemoryBudget;
+    beginRemoveRows(QModelIndex(), 0, nEvict - 1);
+    for (int i = 0; i < nEvict; ++i) {
+        m_nMemoryBytes -= RowBytes(m_vecRows[i].msgInfo);
+    }
+    m_vecRows.remove(0, nEvict);
+    m_nFirstSeq += nEvict;
+    endRemoveRows();
+}
+
+void MessageModel::EnforceMemoryBudgetKeepingOlder(int nLastKeptRow)
+{
+    if (!m_pHistory || !m_bLoaded || m_nMemoryBudget <= 0 || m_vecRows.size() <= m_nMemoryBudget) {
+        return;
+    }
+    // 不移走用户正在看的行
+    int nFirst = qMax(nLastKeptRow + 1, m_nMemoryBudget);
+    if (nFirst >= m_vecRows.size()) {
+        return;
+    }
+    int nEvict = m_vecRows.size() - nFirst;
+    beginRemoveRows(QModelIndex(), nFirst, m_vecRows.size() - 1);
+    for (int i = nFirst; i < m_vecRows.size(); ++i) {
+        m_nMemoryBytes -= RowBytes(m_vecRows[i].msgInfo);
+    }
+    m_vecRows.remove(nFirst, nEvict);
+    m_nNewerOnDisk += nEvict;
+    endRemoveRows();
+}
+
+bool MessageModel::CanFetchOlder() const
+{
+    return m_pHistory && m_bLoaded && !m_bFetching && m_nFirstSeq > 0;
+}
+
+void MessageModel::FetchOlder(int nCount)
+{
+    if (!CanFetchOlder() || nCount <= 0) {
+        return;
+    }
+    m_bFetching = true;
+    m_bFetchingNewer = false;
+    m_pHistory->RequestPage(m_strConversation, m_nFirstSeq, nCount);
+}
+
+bool MessageModel::HasNewerOnDisk() const
+{
+    return m_nNewerOnDisk > 0;
+}
+
+bool MessageModel::CanFetchNewer() const
+{
+    return m_pHistory && m_bLoaded && !m_bFetching && m_nNewerOnDisk > 0;
+}
+
+void MessageModel::FetchNewer(int nCount)
+{
+    if (!CanFetchNewer() || nCount <= 0) {
+        return;
+    }
+    m_bFetching = true;
+    m_bFetchingNewer = true;
+    // 请求末行之后的一页（磁盘上的消息不足一页时返回最后一页，与内存中的行有重叠）
+    m_pHistory->RequestPage(m_strConversation, m_nFirstSeq + m_vecRows.size() + nCount, nCount);
+}
+
+void MessageModel::OnPageLoaded(const QString &strConversation, qint64 nFirstSeq, qint64 nTotal,
+                                const QVector<MsgInfo> &vecMsgInfos)
+{
+    if (strConversation != m_strConversation || !m_bFetching) {
+        return;
+    }
+    if (!m_bLoaded) {
+        // 最新一页：请求之后到达的消息序号从nTotal开始，正好接在这一页之后
+        m_bLoaded = true;
+        m_bFetching = false;
+        m_nFirstSeq = nTotal;
+        PrependMessages(vecMsgInfos);
+        return;
+    }
+    m_bFetching = false;
+    if (m_bFetchingNewer) {
+        // 只取紧接在末行之后的部分
+        qint64 nOffset = m_nFirstSeq + m_vecRows.size() - nFirstSeq;
+        if (nOffset >= 0 && nOffset < vecMsgInfos.size()) {
+            AppendLoadedMessages(vecMsgInfos.mid(static_cast<int>(nOffset)));
+        }
+        return;
+    }
+    // 只接受与当前第0行相邻的一页
+    if (nFirstSeq + vecMsgInfos.size() == m_nFirstSeq) {
+        PrependMessages(vecMsgInfos);
+    }
+}
+
+void MessageModel::AppendLoadedMessages(const QVector<MsgInfo> &vecMsgInfos)
+{
+    // 已在磁盘上，不再写入聊天记录
+    int nCount = static_cast<int>(qMin<qint64>(vecMsgInfos.size(), m_nNewerOnDisk));
+    if (nCount <= 0) {
+        return;
+    }
+    int row = m_vecRows.size();
+    beginInsertRows(QModelIndex(), row, row + nCount - 1);
+    for (int i = 0; i < nCount; ++i) {
+        m_vecRows.append(MakeRow(vecMsgInfos[i]));
+        m_nMemoryBytes += RowBytes(vecMsgInfos[i]);
+    }
+    m_nNewerOnDisk -= nCount;
+    endInsertRows();
+}
+
+void MessageModel::PrependMessages(const QVector<MsgInfo> &vecMsgInfos)
+{
+    if (vecMsgInfos.isEmpty()) {
+        return;
+    }
+    QVector<MessageRow> vecRows;
+    vecRows.reserve(vecMsgInfos.size() + m_vecRows.size());
+    for (const MsgInfo &msgInfo : vecMsgInfos) {
+        vecRows.append(MakeRow(msgInfo));
+        m_nMemoryBytes += RowBytes(msgInfo);
+    }
+    beginInsertRows(QModelIndex(), 0, vecRows.size() - 1);
+    vecRows += m_vecRows;
+    m_vecRows.swap(vecRows);
+    m_nFirstSeq -= vecMsgInfos.size();
+    endInsertRows();
+    emit olderMessagesLoaded(vecMsgInfos.size());
+}
+
+QString MessageModel::Conversation() const
+{
+    return m_strConversation;
+}
+
+qint64 MessageModel::MemoryUsage() const
+{
+    return m_nMemoryBytes;
+}
+
+qint64 MessageModel::SpilledCount() const
+{
+    return m_nFirstSeq + m_nNewerOnDisk;
+}
@@ -0,0 +1,116 @@
+#ifndef MESSAGEMODEL_H
+#define MESSAGEMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include "common.h"
+
+class MessageHistory;
+
+/**
+ * @brief 聊天消息模型（每个会话一个实例）
+ *
+ * 以MsgInfo为行数据，配合MessageDelegate只绘制可见行；
+ * 行高按视图宽度缓存在模型中，避免滚动和重绘时重复计算文本排版。
+ * 新消息同时写入本地聊天记录，内存中只保留最近的若干条，
+ * 创建时异步加载最新一页，向上翻阅时再按页异步读回更早的消息。
+ * 用户停在历史位置时改为把最新的消息留在磁盘上，回到底部时再按页读回。
+ */
+class MessageModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    // 自定义数据角色
+    enum MessageRole {
+        UserPhoneRole = Qt::UserRole + 1,   // 发送者手机号
+        UserIdRole,                         // 发送者ID
+        ContentRole,                        // 消息内容
+        TimeRole,                           // 发送时间
+        FileLinkRole,                       // 文件链接
+        SendStateRole                       // 发送状态（SendState）
+    };
+
+    explicit MessageModel(MessageHistory *pHistory, const QString &strConversation,
+                          QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // 追加一条消息到末尾（同时写入本地聊天记录）
+    void AppendMessage(const MsgInfo &msgInfo);
+    // 追加一批消息到末尾（一次插入通知，视图只重新布局一次）
+    void AppendMessages(const QVector<MsgInfo> &vecMsgInfos);
+    // 获取指定行的消息
+    const MsgInfo &MessageAt(int row) const;
+    // 更新本端发出消息的发送状态（按客户端消息ID查找，从最新的消息往前找）
+    void SetSendState(const QString &strClientMsgId, SendState eState);
+
+    // 读取行高缓存，宽度不一致或未缓存时返回-1
+    int CachedHeight(int row, int width) const;
+    // 写入行高缓存（由委托在计算排版后调用）
+    void SetCachedHeight(int row, int width, int height) const;
+
+    // 设置内存中保留的最大消息数
+    void SetMemoryBudget(int nMaxMessages);
+    // 超出预算时将最早的消息移出内存（消息已在磁盘上）
+    void EnforceMemoryBudget();
+    // 超出预算时将nLastKeptRow之后的最新消息移出内存（用户在翻阅历史时），
+    // 之后到达的消息只写入磁盘，直到FetchNewer读回
+    void EnforceMemoryBudgetKeepingOlder(int nLastKeptRow);
+    // 磁盘上是否还有更早的、可以请求的消息
+    bool CanFetchOlder() const;
+    // 异步请求更早的一页消息，读回后插入到开头
+    void FetchOlder(int nCount);
+    // 是否有更新的消息只在磁盘上（末行不是最新消息）
+    bool HasNewerOnDisk() const;
+    // 磁盘上是否还有更新的、可以请求的消息
+    bool CanFetchNewer() const;
+    // 异步请求更新的一页消息，读回后追加到末尾
+    void FetchNewer(int nCount);
+
+    // 会话标识
+    QString Conversation() const;
+    // 当前内存占用（字节，估算值）
+    qint64 MemoryUsage() const;
+    // 在磁盘上、不在内存中的消息数（更早的和更新的）
+    qint64 SpilledCount() const;
+
+signals:
+    // 更早的消息已插入到开头（nCount为插入条数）
+    void olderMessagesLoaded(int nCount);
+
+private slots:
+    void OnPageLoaded(const QString &strConversation, qint64 nFirstSeq, qint64 nTotal,
+                      const QVector<MsgInfo> &vecMsgInfos);
+
+private:
+    // 行数据：消息内容 + 行高缓存
+    typedef struct _MessageRow {
+        MsgInfo msgInfo;
+        mutable int nCachedWidth;   // 缓存对应的视图宽度
+        mutable int nCachedHeight;  // 缓存的行高
+        SendState eSendState;       // 发送状态
+    } MessageRow;
+
+    QVector<MessageRow> m_vecRows;
+    MessageHistory *m_pHistory; // 本地聊天记录（不归模型所有）
+    QString m_strConversation;  // 会话标识（群聊为"message"，私聊为对方用户ID）
+    int m_nMemoryBudget;        // 内存中最多保留的消息数
+    bool m_bLoaded;             // 最新一页是否已加载（加载前第0行的序号未知）
+    bool m_bFetching;           // 是否有未返回的分页请求
+    bool m_bFetchingNewer;      // 未返回的分页请求是否为更新的一页
+    qint64 m_nFirstSeq;         // 第0行在会话中的序号（之前的消息都在磁盘上）
+    qint64 m_nNewerOnDisk;      // 末行之后只在磁盘上的消息数
+    qint64 m_nMemoryBytes;      // 行数据的内存占用估算
+
+    // 将一页消息插入到开头
+    void PrependMessages(const QVector<MsgInfo> &vecMsgInfos);
+    // 将从磁盘读回的更新消息追加到末尾
+    void AppendLoadedMessages(const QVector<MsgInfo> &vecMsgInfos);
+
+    MessageRow MakeRow(const MsgInfo &msgInfo) const;
+    static qint64 RowBytes(const MsgInfo &msgInfo);
+};
+
+#endif // MESSAGEMODEL_H
@@ -0,0 +1,133 @@
+#include "messagestore.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDebug>
+
+// 索引项大小（每条消息一个qint64偏移）
+static const qint64 INDEX_ENTRY_SIZE = sizeof(qint64);
+
+static void WriteMsgInfo(QDataStream &stream, const MsgInfo &msgInfo)
+{
+    stream << msgInfo.strUserPhone << msgInfo.strUserId << msgInfo.strContent
+           << msgInfo.strTime << msgInfo.fileLink;
+}
+
+static void ReadMsgInfo(QDataStream &stream, MsgInfo &msgInfo)
+{
+    stream >> msgInfo.strUserPhone >> msgInfo.strUserId >> msgInfo.strContent
+           >> msgInfo.strTime >> msgInfo.fileLink;
+}
+
+MessageStore::MessageStore(const QString &strDir) :
+    m_strDir(strDir)
+{
+    QDir().mkpath(m_strDir);
+}
+
+MessageStore::~MessageStore()
+{
+    Close();
+}
+
+void MessageStore::Close()
+{
+    qDeleteAll(m_hashDataFiles);
+    m_hashDataFiles.clear();
+    qDeleteAll(m_hashIndexFiles);
+    m_hashIndexFiles.clear();
+}
+
+QFile *MessageStore::AppendFile(QHash<QString, QFile*> &hashFiles, const QString &strPath,
+                                const QString &strConversation)
+{
+    QFile *pFile = hashFiles.value(strConversation, nullptr);
+    if (pFile) {
+        return pFile;
+    }
+    pFile = new QFile(strPath);
+    if (!pFile->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "打开消息存储文件失败:" << strPath << pFile->errorString();
+        delete pFile;
+        return nullptr;
+    }
+    hashFiles.insert(strConversation, pFile);
+    return pFile;
+}
+
+QString MessageStore::DataFilePath(const QString &strConversation) const
+{
+    return QString("%1/%2.dat").arg(m_strDir, QString::fromLatin1(strConversation.toUtf8().toHex()));
+}
+
+QString MessageStore::IndexFilePath(const QString &strConversation) const
+{
+    return QString("%1/%2.idx").arg(m_strDir, QString::fromLatin1(strConversation.toUtf8().toHex()));
+}
+
+qint64 MessageStore::Append(const QString &strConversation, const QVector<MsgInfo> &vecMsgInfos)
+{
+    QFile *pDataFile = AppendFile(m_hashDataFiles, DataFilePath(strConversation), strConversation);
+    QFile *pIndexFile = AppendFile(m_hashIndexFiles, IndexFilePath(strConversation), strConversation);
+    if (!pDataFile || !pIndexFile) {
+        return Count(strConversation);
+    }
+
+    // 先写数据再写索引，中途崩溃时索引不会指向不完整的记录
+    QDataStream dataStream(pDataFile);
+    dataStream.setVersion(QDataStream::Qt_5_12);
+    QVector<qint64> vecOffsets;
+    vecOffsets.reserve(vecMsgInfos.size());
+    for (const MsgInfo &msgInfo : vecMsgInfos) {
+        vecOffsets.append(pDataFile->pos());
+        WriteMsgInfo(dataStream, msgInfo);
+    }
+    pDataFile->flush();
+
+    QDataStream indexStream(pIndexFile);
+    for (qint64 nOffset : vecOffsets) {
+        indexStream << nOffset;
+    }
+    pIndexFile->flush();
+    return pIndexFile->size() / INDEX_ENTRY_SIZE;
+}
+
+qint64 MessageStore::Count(const QString &strConversation) const
+{
+    return QFileInfo(IndexFilePath(strConversation)).size() / INDEX_ENTRY_SIZE;
+}
+
+QVector<MsgInfo> MessageStore::Read(const QString &strConversation, qint64 nFirst, int nCount) const
+{
+    QVector<MsgInfo> vecMsgInfos;
+    qint64 nTotal = Count(strConversation);
+    if (nFirst < 0 || nCount <= 0 || nFirst >= nTotal) {
+        return vecMsgInfos;
+    }
+    nCount = static_cast<int>(qMin<qint64>(nCount, nTotal - nFirst));
+
+    QFile indexFile(IndexFilePath(strConversation));
+    QFile dataFile(DataFilePath(strConversation));
+    if (!indexFile.open(QIODevice::ReadOnly) || !dataFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "读取消息存储文件失败:" << dataFile.fileName() << dataFile.errorString();
+        return vecMsgInfos;
+    }
+
+    // 定位到首条消息的偏移，之后顺序读取
+    indexFile.seek(nFirst * INDEX_ENTRY_SIZE);
+    QDataStream indexStream(&indexFile);
+    qint64 nOffset = 0;
+    indexStream >> nOffset;
+    dataFile.seek(nOffset);
+
+    QDataStream dataStream(&dataFile);
+    dataStream.setVersion(QDataStream::Qt_5_12);
+    vecMsgInfos.reserve(nCount);
+    for (int i = 0; i < nCount && dataStream.status() == QDataStream::Ok; ++i) {
+        MsgInfo msgInfo;
+        ReadMsgInfo(dataStream, msgInfo);
+        vecMsgInfos.append(msgInfo);
+    }
+    return vecMsgInfos;
+}
@@ -0,0 +1,49 @@
+#ifndef MESSAGESTORE_H
+#define MESSAGESTORE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include "common.h"
+
+class QFile;
+
+/**
+ * @brief 本地消息存储（每个会话一个追加写日志 + 定长索引）
+ *
+ * 数据文件 <key>.dat 顺序追加序列化后的MsgInfo，
+ * 索引文件 <key>.idx 为每条消息在数据文件中的偏移（8字节），
+ * 因此按序号读取任意一页只需两次seek，与历史总量无关。
+ * 非线程安全，由MessageHistory在其工作线程中独占使用。
+ */
+class MessageStore
+{
+public:
+    explicit MessageStore(const QString &strDir);
+    ~MessageStore();
+
+    // 追加消息，返回追加后该会话的消息总数
+    qint64 Append(const QString &strConversation, const QVector<MsgInfo> &vecMsgInfos);
+    // 会话已存储的消息数
+    qint64 Count(const QString &strConversation) const;
+    // 读取序号[nFirst, nFirst + nCount)的消息
+    QVector<MsgInfo> Read(const QString &strConversation, qint64 nFirst, int nCount) const;
+    // 关闭所有打开的文件
+    void Close();
+
+private:
+    QString m_strDir;  // 存储目录
+    // 已打开的追加写文件（按会话缓存，避免每条消息都重新打开）
+    QHash<QString, QFile*> m_hashDataFiles;
+    QHash<QString, QFile*> m_hashIndexFiles;
+
+    // 获取会话的追加写文件，首次使用时打开
+    QFile *AppendFile(QHash<QString, QFile*> &hashFiles, const QString &strPath,
+                      const QString &strConversation);
+
+    // 会话对应的文件路径（会话键做hex编码，避免非法文件名）
+    QString DataFilePath(const QString &strConversation) const;
+    QString IndexFilePath(const QString &strConversation) const;
+};
+
+#endif // MESSAGESTORE_H
@@ -0,0 +1,50 @@
+#include "networkmanager.h"
+#include "appconfig.h"
+#include <QDebug>
+
+NetworkManager *NetworkManager::m_pInstance = nullptr;
+
+NetworkManager::NetworkManager(QObject *parent) :
+    QNetworkAccessManager(parent)
+{
+    connect(AppConfig::GetInstance(), &AppConfig::endpointChanged, this, &NetworkManager::Reconfigure);
+}
+
+void NetworkManager::DestroyInstance()
+{
+    delete m_pInstance;
+    m_pInstance = nullptr;
+}
+
+void NetworkManager::PreConnect()
+{
+    QString strServerUrl = AppConfig::GetInstance()->HttpUrl();
+    if (strServerUrl.isEmpty() || strServerUrl == m_strPreConnected) {
+        return;
+    }
+    m_strPreConnected = strServerUrl;
+    QUrl url(strServerUrl);
+    qDebug() << "预连接服务器:" << strServerUrl;
+    // 只建立连接，不发送请求；连接空闲超时后由连接池关闭，下次请求时重新建立
+    if (url.scheme() == "https") {
+        connectToHostEncrypted(url.host(), static_cast<quint16>(url.port(443)));
+    } else {
+        connectToHost(url.host(), static_cast<quint16>(url.port(80)));
+    }
+}
+
+void NetworkManager::Reconfigure()
+{
+    // 进行中的请求不受影响，完成后其连接不再复用
+    clearConnectionCache();
+    m_strPreConnected.clear();
+    PreConnect();
+}
+
+QNetworkReply *NetworkManager::createRequest(Operation op, const QNetworkRequest &request,
+                                             QIODevice *outgoingData)
+{
+    QNetworkRequest req(request);
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    return QNetworkAccessManager::createRequest(op, req, outgoingData);
+}
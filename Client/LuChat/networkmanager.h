@@ -0,0 +1,52 @@
+#ifndef NETWORKMANAGER_H
+#define NETWORKMANAGER_H
+
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QUrl>
+
+/**
+ * @brief 全局共享的HTTP客户端
+ *
+ * 登录、注册、文件传输和缩略图等所有HTTP请求都经由同一个
+ * QNetworkAccessManager发出，共用它的连接池（keep-alive）、DNS缓存和
+ * TLS会话，每个API调用不再重复建立连接。发出的请求都允许HTTP/2，
+ * 服务器通过ALPN协商支持时同一连接上多路复用。
+ *
+ * 只能在界面线程中使用。服务器地址确定后调用PreConnect，提前完成
+ * DNS解析和TCP（及TLS）握手，第一次登录或上传时直接使用已建立的连接。
+ */
+class NetworkManager : public QNetworkAccessManager
+{
+    Q_OBJECT
+
+public:
+    static NetworkManager *GetInstance() {
+        if (m_pInstance == nullptr) {
+            m_pInstance = new NetworkManager();
+        }
+        return m_pInstance;
+    }
+    // 退出前释放（所有使用它的对象都已释放之后）
+    static void DestroyInstance();
+
+    // 预先连接配置中的服务器，地址未变且已预连接过时不重复连接
+    void PreConnect();
+    // 已切换服务器：丢弃到旧服务器的空闲连接，预连接新服务器（订阅AppConfig::endpointChanged）
+    void Reconfigure();
+
+protected:
+    // 所有请求统一允许HTTP/2
+    QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
+                                 QIODevice *outgoingData) override;
+
+private:
+    explicit NetworkManager(QObject *parent = nullptr);
+
+    QString m_strPreConnected;  // 最近一次预连接的服务器地址
+
+    static NetworkManager *m_pInstance;
+};
+
+#endif // NETWORKMANAGER_H
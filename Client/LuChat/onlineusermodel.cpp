@@ -0,0 +1,76 @@
+#include "onlineusermodel.h"
+
+OnlineUserModel::OnlineUserModel(QObject *parent) :
+    QAbstractListModel(parent)
+{
+}
+
+int OnlineUserModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_vecUsers.size();
+}
+
+QVariant OnlineUserModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_vecUsers.size()) {
+        return QVariant();
+    }
+    const UserInfo &user = m_vecUsers[index.row()];
+    if (role == Qt::DisplayRole) {
+        return user.strUserPhone;
+    }
+    if (role == Qt::ToolTipRole) {
+        return QString("ID: %1").arg(user.strUserId);
+    }
+    return QVariant();
+}
+
+QVariant OnlineUserModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role == Qt::DisplayRole && orientation == Qt::Horizontal && section == 0) {
+        return QString("在线用户");
+    }
+    return QAbstractListModel::headerData(section, orientation, role);
+}
+
+void OnlineUserModel::AddUser(const UserInfo &user)
+{
+    auto it = m_hashRows.constFind(user.strUserId);
+    if (it != m_hashRows.constEnd()) {
+        // 已在线：仅在显示内容变化时刷新该行
+        int row = it.value();
+        if (m_vecUsers[row].strUserPhone != user.strUserPhone) {
+            m_vecUsers[row] = user;
+            QModelIndex idx = index(row);
+            emit dataChanged(idx, idx);
+        }
+        return;
+    }
+
+    int row = m_vecUsers.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_vecUsers.append(user);
+    m_hashRows.insert(user.strUserId, row);
+    endInsertRows();
+}
+
+void OnlineUserModel::Clear()
+{
+    beginResetModel();
+    m_vecUsers.clear();
+    m_hashRows.clear();
+    endResetModel();
+}
+
+bool OnlineUserModel::Contains(const QString &strUserId) const
+{
+    return m_hashRows.contains(strUserId);
+}
+
+const UserInfo &OnlineUserModel::UserAt(int row) const
+{
+    return m_vecUsers[row];
+}
@@ -0,0 +1,40 @@
+#ifndef ONLINEUSERMODEL_H
+#define ONLINEUSERMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QHash>
+#include "common.h"
+
+/**
+ * @brief 在线用户模型
+ *
+ * 按用户ID建立哈希索引，上线/更新都是O(1)查找，
+ * 并且只通知受影响的那一行，视图不需要重建整张表。
+ */
+class OnlineUserModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit OnlineUserModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+
+    // 用户上线：不存在则追加一行，已存在则只更新该行
+    void AddUser(const UserInfo &user);
+    // 清空列表
+    void Clear();
+
+    bool Contains(const QString &strUserId) const;
+    const UserInfo &UserAt(int row) const;
+
+private:
+    QVector<UserInfo> m_vecUsers;       // 行数据
+    QHash<QString, int> m_hashRows;     // 用户ID -> 行号
+};
+
+#endif // ONLINEUSERMODEL_H
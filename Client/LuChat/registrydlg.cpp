@@ -1,12 +1,13 @@
 #include "registrydlg.h"
 #include "ui_registrydlg.h"
+#include "networkmanager.h"
+#include "appconfig.h"
 
 
 
 RegistryDlg::RegistryDlg(QWidget *parent) :
     QDialog(parent),
-    ui(new Ui::RegistryDlg),
-    m_pRegisterManager(nullptr)
+    ui(new Ui::RegistryDlg)
 {
     ui->setupUi(this);
 
@@ -17,13 +18,6 @@ RegistryDlg::RegistryDlg(QWidget *parent) :
     setWindowTitle("用户注册");
 
 
-    // 初始化网络注册管理器
-    m_pRegisterManager = new QNetworkAccessManager(this);
-    // 当完成注册请求之后，调用函数，接收响应
-    connect(m_pRegisterManager, &QNetworkAccessManager::finished,
-            this,&RegistryDlg::on_registerReplyFinished);
-
-
 //    // 手动连接注册按钮的信号槽
 //    connect(ui->registrypushButton, &QPushButton::clicked,
 //            this, &RegistryDlg::on_registrypushButton_clicked);
@@ -36,7 +30,6 @@ RegistryDlg::RegistryDlg(QWidget *parent) :
 RegistryDlg::~RegistryDlg()
 {
     delete ui;
-    if (m_pRegisterManager) delete m_pRegisterManager;
 }
 
 
@@ -120,8 +113,12 @@ void RegistryDlg::on_registrypushButton_clicked()
     QJsonDocument jsonDoc(jsonObj);
     QByteArray data = jsonDoc.toJson(QJsonDocument::Compact);
 
-    // 发送post请求
-    m_pRegisterManager->post(request, data);
+    // 发送post请求（共享的网络管理器，复用与服务器的连接）
+    QNetworkReply *pReply = NetworkManager::GetInstance()->post(request, data);
+    // 当完成注册请求之后，调用函数，接收响应
+    connect(pReply, &QNetworkReply::finished, this, [this, pReply]() {
+        on_registerReplyFinished(pReply);
+    });
 }
 
 // 验证输入合法性
@@ -177,9 +174,9 @@ bool RegistryDlg::IsValidPhoneNumber(const QString & phoneNum)
 // 获取服务器配置
 bool RegistryDlg::getServerConfig(QString &ip, QString &port)
 {
-    QSettings settings;
-    ip = settings.value(CURRENT_SERVER_HOST).toString();
-    port = settings.value(WEBSOCKET_SERVER_PORT).toString();
+    AppConfig *pConfig = AppConfig::GetInstance();
+    ip = pConfig->ServerHost();
+    port = pConfig->ServerPort();
 
     if(ip.isEmpty() || port.isEmpty()) {
         QMessageBox::warning(this, "提示", "请先配置服务器信息");
@@ -13,7 +13,6 @@
 #include <QRegExpValidator>
 #include <QValidator>
 #include <QMessageBox>
-#include <QSettings>
 #include "common.h"
 
 namespace Ui {
@@ -41,7 +40,6 @@ private slots:
 
 private:
     Ui::RegistryDlg *ui;
-    QNetworkAccessManager *m_pRegisterManager; // 注册请求管理器
     bool validateInput(QString &errorMsg);
     bool IsValidPhoneNumber(const QString & phoneNum);
     
@@ -0,0 +1,494 @@
+#include "segmentdownloader.h"
+#include "bandwidthlimiter.h"
+#include <QUrlQuery>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+SegmentDownloader::SegmentDownloader(QNetworkAccessManager *pManager, const QString &strServerUrl,
+                                     const QString &strFileName, const QString &strSavePath, QObject *parent) :
+    QObject(parent),
+    m_pManager(pManager),
+    m_strServerUrl(strServerUrl),
+    m_strFileName(strFileName),
+    m_strSavePath(strSavePath),
+    m_nFileSize(-1),
+    m_bRangeSupported(true),
+    m_nGeneration(0),
+    m_pProbeReply(nullptr),
+    m_bStateDirty(false),
+    m_bStopped(false),
+    m_bRestarted(false)
+{
+    m_file.setFileName(PartPath());
+    m_saveTimer.setInterval(DOWNLOAD_STATE_SAVE_INTERVAL);
+    connect(&m_saveTimer, &QTimer::timeout, this, &SegmentDownloader::SaveState);
+}
+
+SegmentDownloader::~SegmentDownloader()
+{
+    if (!m_bStopped) {
+        Pause();
+    }
+}
+
+QString SegmentDownloader::FileName() const
+{
+    return m_strFileName;
+}
+
+QString SegmentDownloader::SavePath() const
+{
+    return m_strSavePath;
+}
+
+qint64 SegmentDownloader::FileSize() const
+{
+    return m_nFileSize;
+}
+
+void SegmentDownloader::SetBandwidthLimiter(BandwidthLimiter *pLimiter)
+{
+    if (m_pLimiter) {
+        disconnect(m_pLimiter, nullptr, this, nullptr);
+    }
+    m_pLimiter = pLimiter;
+    if (pLimiter) {
+        connect(pLimiter, &BandwidthLimiter::refilled, this, &SegmentDownloader::OnLimiterRefilled);
+    }
+}
+
+QString SegmentDownloader::PartPath() const
+{
+    return m_strSavePath + ".part";
+}
+
+QString SegmentDownloader::StatePath() const
+{
+    return m_strSavePath + ".part.state";
+}
+
+QUrl SegmentDownloader::DownloadUrl() const
+{
+    QUrl url(m_strServerUrl + "/api/download");
+    QUrlQuery query;
+    query.addQueryItem("filename", m_strFileName);
+    url.setQuery(query);
+    return url;
+}
+
+void SegmentDownloader::Start()
+{
+    m_bStopped = false;
+    if (m_vecSegments.isEmpty() && !LoadState()) {
+        // 探测文件大小和修改时间（只取第一个字节）
+        QNetworkRequest req(DownloadUrl());
+        req.setRawHeader("Range", "bytes=0-0");
+        m_pProbeReply = m_pManager->get(req);
+        connect(m_pProbeReply, &QNetworkReply::finished, this, &SegmentDownloader::OnProbeFinished);
+        // 服务器不支持Range时会返回整个文件，拿到响应头后立即中止
+        connect(m_pProbeReply, &QNetworkReply::metaDataChanged, this, [this]() {
+            int nStatus = m_pProbeReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            QString strType = m_pProbeReply->header(QNetworkRequest::ContentTypeHeader).toString();
+            if (nStatus == 200 && !strType.contains("json")) {
+                m_bRangeSupported = false;
+                m_nFileSize = m_pProbeReply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+                m_lastModified = m_pProbeReply->rawHeader("Last-Modified");
+                m_pProbeReply->abort();
+            }
+        });
+        return;
+    }
+    StartSegments();
+}
+
+void SegmentDownloader::OnProbeFinished()
+{
+    QNetworkReply *pReply = m_pProbeReply;
+    m_pProbeReply = nullptr;
+    pReply->deleteLater();
+
+    int nStatus = pReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (!m_bRangeSupported) {
+        if (m_nFileSize < 0) {
+            Fail("无法获取文件大小");
+            return;
+        }
+        qDebug() << m_strFileName << "服务器不支持分段下载，整体下载且不能续传";
+    } else if (nStatus == 206 || nStatus == 416) {
+        // Content-Range: bytes 0-0/大小（空文件为416，bytes */0）
+        QByteArray contentRange = pReply->rawHeader("Content-Range");
+        int nSlash = contentRange.lastIndexOf('/');
+        bool bOk = false;
+        m_nFileSize = nSlash >= 0 ? contentRange.mid(nSlash + 1).toLongLong(&bOk) : -1;
+        if (!bOk) {
+            Fail(QString("无法获取文件大小: %1").arg(QString::fromLatin1(contentRange)));
+            return;
+        }
+        m_lastModified = pReply->rawHeader("Last-Modified");
+    } else if (pReply->error() != QNetworkReply::NoError) {
+        Fail(pReply->errorString());
+        return;
+    } else {
+        // 服务器以统一格式{code,message}返回错误（如文件不存在）
+        QJsonObject jsonObj = QJsonDocument::fromJson(pReply->readAll()).object();
+        Fail(jsonObj.value("message").toString(QString("HTTP %1").arg(nStatus)));
+        return;
+    }
+
+    PlanSegments();
+    StartSegments();
+}
+
+void SegmentDownloader::PlanSegments()
+{
+    m_vecSegments.clear();
+    ++m_nGeneration;
+    int nCount = 1;
+    if (m_bRangeSupported) {
+        nCount = static_cast<int>(qBound<qint64>(1, m_nFileSize / DOWNLOAD_MIN_SEGMENT, DOWNLOAD_SEGMENT_COUNT));
+    }
+    qint64 nSegmentSize = m_nFileSize / nCount;
+    for (int i = 0; i < nCount; ++i) {
+        Segment segment;
+        segment.nStart = i * nSegmentSize;
+        segment.nEnd = (i == nCount - 1) ? m_nFileSize - 1 : segment.nStart + nSegmentSize - 1;
+        segment.nDone = 0;
+        segment.nRetries = 0;
+        m_vecSegments.append(segment);
+    }
+    m_bStateDirty = true;
+}
+
+void SegmentDownloader::StartSegments()
+{
+    if (!m_file.isOpen()) {
+        if (!m_file.open(QIODevice::ReadWrite)) {
+            Fail(QString("无法写入文件: %1").arg(m_file.errorString()));
+            return;
+        }
+        // 预先分配文件大小，各段直接写入各自的偏移
+        if (m_file.size() != m_nFileSize && !m_file.resize(m_nFileSize)) {
+            Fail(QString("无法写入文件: %1").arg(m_file.errorString()));
+            return;
+        }
+    }
+    SaveState();
+    m_saveTimer.start();
+    ReportProgress();
+
+    bool bAllDone = true;
+    for (int i = 0; i < m_vecSegments.size(); ++i) {
+        const Segment &segment = m_vecSegments.at(i);
+        if (segment.nStart + segment.nDone <= segment.nEnd) {
+            bAllDone = false;
+            StartSegment(i);
+        }
+    }
+    if (bAllDone) {
+        Complete();
+    }
+}
+
+void SegmentDownloader::StartSegment(int nIndex)
+{
+    if (m_bStopped) {
+        return;
+    }
+    Segment &segment = m_vecSegments[nIndex];
+    QNetworkRequest req(DownloadUrl());
+    if (m_bRangeSupported) {
+        req.setRawHeader("Range", QString("bytes=%1-%2").arg(segment.nStart + segment.nDone)
+                         .arg(segment.nEnd).toLatin1());
+        // 服务器文件已变化时返回200和整个文件，而不是错位的片段
+        if (!m_lastModified.isEmpty()) {
+            req.setRawHeader("If-Range", m_lastModified);
+        }
+    } else {
+        segment.nDone = 0;
+    }
+    QNetworkReply *pReply = m_pManager->get(req);
+    // 限制读缓冲，数据到达即写盘，内存占用与文件大小无关
+    pReply->setReadBufferSize(DOWNLOAD_READ_BUFFER);
+    m_hashRunning.insert(pReply, nIndex);
+    connect(pReply, &QNetworkReply::readyRead, this, &SegmentDownloader::OnSegmentReadyRead);
+    connect(pReply, &QNetworkReply::finished, this, &SegmentDownloader::OnSegmentFinished);
+}
+
+void SegmentDownloader::OnSegmentReadyRead()
+{
+    QNetworkReply *pReply = qobject_cast<QNetworkReply*>(sender());
+    if (pReply && m_hashRunning.contains(pReply)) {
+        ReadSegment(pReply, false);
+    }
+}
+
+void SegmentDownloader::OnLimiterRefilled()
+{
+    // 额度补充后读取之前留在读缓冲中的数据
+    const QList<QNetworkReply*> listReplies = m_hashRunning.keys();
+    for (QNetworkReply *pReply : listReplies) {
+        if (m_bStopped) {
+            return;
+        }
+        if (m_hashRunning.contains(pReply) && pReply->bytesAvailable() > 0) {
+            ReadSegment(pReply, false);
+        }
+    }
+}
+
+bool SegmentDownloader::ReadSegment(QNetworkReply *pReply, bool bAll)
+{
+    int nStatus = pReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (m_bRangeSupported && nStatus == 200) {
+        if (pReply->header(QNetworkRequest::ContentTypeHeader).toString().contains("json")) {
+            return true;  // 错误响应，在finished中处理
+        }
+        // If-Range不匹配：服务器上的文件已变化，已下载的部分作废
+        qDebug() << m_strFileName << "服务器文件已变化，从头下载";
+        Restart();
+        return false;
+    }
+    if (nStatus != 200 && nStatus != 206) {
+        return true;
+    }
+
+    qint64 nAvailable = pReply->bytesAvailable();
+    if (m_pLimiter) {
+        // 请求结束时读完剩余数据，同样计入额度
+        qint64 nGranted = m_pLimiter->Acquire(nAvailable);
+        if (!bAll) {
+            nAvailable = nGranted;
+        }
+    }
+    if (nAvailable <= 0) {
+        return true;
+    }
+
+    Segment &segment = m_vecSegments[m_hashRunning.value(pReply)];
+    QByteArray data = pReply->read(nAvailable);
+    qint64 nRemain = segment.nEnd + 1 - segment.nStart - segment.nDone;
+    if (data.size() > nRemain) {
+        data.truncate(static_cast<int>(nRemain));
+    }
+    if (!m_file.seek(segment.nStart + segment.nDone) || m_file.write(data) != data.size()) {
+        Fail(QString("写入文件失败: %1").arg(m_file.errorString()));
+        return false;
+    }
+    segment.nDone += data.size();
+    // 有进展：重试次数只限制连续的失败，网络时断时续的大文件不会因此失败
+    segment.nRetries = 0;
+    m_bStateDirty = true;
+    ReportProgress();
+    return true;
+}
+
+void SegmentDownloader::OnSegmentFinished()
+{
+    QNetworkReply *pReply = qobject_cast<QNetworkReply*>(sender());
+    if (!pReply || !m_hashRunning.contains(pReply)) {
+        return;
+    }
+    // 限速时读缓冲中可能还有数据
+    if (!ReadSegment(pReply, true)) {
+        return;
+    }
+    int nIndex = m_hashRunning.take(pReply);
+    pReply->deleteLater();
+
+    Segment &segment = m_vecSegments[nIndex];
+    int nStatus = pReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (pReply->error() == QNetworkReply::NoError
+            && pReply->header(QNetworkRequest::ContentTypeHeader).toString().contains("json")) {
+        QJsonObject jsonObj = QJsonDocument::fromJson(pReply->readAll()).object();
+        Fail(jsonObj.value("message").toString(QString("HTTP %1").arg(nStatus)));
+        return;
+    }
+
+    if (segment.nStart + segment.nDone > segment.nEnd) {
+        // 本段完成
+        for (const Segment &other : m_vecSegments) {
+            if (other.nStart + other.nDone <= other.nEnd) {
+                return;
+            }
+        }
+        Complete();
+        return;
+    }
+
+    // 断网等原因中断：稍后从本段已下载的位置继续
+    if (segment.nRetries >= DOWNLOAD_SEGMENT_MAX_RETRY) {
+        Fail(QString("下载中断: %1").arg(pReply->errorString()));
+        return;
+    }
+    int nDelay = 1000 << segment.nRetries;
+    ++segment.nRetries;
+    qDebug() << m_strFileName << "第" << nIndex << "段下载中断，" << nDelay << "毫秒后继续:" << pReply->errorString();
+    int nGeneration = m_nGeneration;
+    QTimer::singleShot(nDelay, this, [this, nIndex, nGeneration]() {
+        // 期间从头下载过时分段已重新划分；暂停后又重新开始时，该段可能已经在下载
+        if (nGeneration != m_nGeneration || nIndex >= m_vecSegments.size()
+                || m_hashRunning.key(nIndex, nullptr) != nullptr) {
+            return;
+        }
+        StartSegment(nIndex);
+    });
+}
+
+void SegmentDownloader::Restart()
+{
+    if (m_bRestarted) {
+        Fail("服务器文件在下载过程中反复变化");
+        return;
+    }
+    m_bRestarted = true;
+    ++m_nGeneration;
+    AbortReplies();
+    m_saveTimer.stop();
+    m_file.close();
+    QFile::remove(PartPath());
+    QFile::remove(StatePath());
+    m_vecSegments.clear();
+    m_nFileSize = -1;
+    m_lastModified.clear();
+    m_bRangeSupported = true;
+    Start();
+}
+
+void SegmentDownloader::Complete()
+{
+    m_bStopped = true;
+    m_saveTimer.stop();
+    m_file.close();
+    QFile::remove(StatePath());
+    // 替换已存在的同名文件
+    if (QFile::exists(m_strSavePath) && !QFile::remove(m_strSavePath)) {
+        emit failed(QString("无法覆盖文件: %1").arg(m_strSavePath));
+        return;
+    }
+    if (!QFile::rename(PartPath(), m_strSavePath)) {
+        emit failed(QString("无法保存文件: %1").arg(m_strSavePath));
+        return;
+    }
+    emit finished(m_strSavePath);
+}
+
+void SegmentDownloader::Pause()
+{
+    m_bStopped = true;
+    if (m_pProbeReply) {
+        disconnect(m_pProbeReply, nullptr, this, nullptr);
+        m_pProbeReply->abort();
+        m_pProbeReply->deleteLater();
+        m_pProbeReply = nullptr;
+    }
+    AbortReplies();
+    m_saveTimer.stop();
+    SaveState();
+    m_file.close();
+}
+
+void SegmentDownloader::Discard()
+{
+    Pause();
+    QFile::remove(PartPath());
+    QFile::remove(StatePath());
+}
+
+void SegmentDownloader::Fail(const QString &strError)
+{
+    if (m_bStopped) {
+        return;
+    }
+    Pause();
+    qDebug() << m_strFileName << "下载失败:" << strError;
+    emit failed(strError);
+}
+
+void SegmentDownloader::AbortReplies()
+{
+    QList<QNetworkReply*> listReplies = m_hashRunning.keys();
+    m_hashRunning.clear();
+    for (QNetworkReply *pReply : listReplies) {
+        disconnect(pReply, nullptr, this, nullptr);
+        pReply->abort();
+        pReply->deleteLater();
+    }
+}
+
+void SegmentDownloader::ReportProgress()
+{
+    qint64 nReceived = 0;
+    for (const Segment &segment : m_vecSegments) {
+        nReceived += segment.nDone;
+    }
+    emit progress(nReceived, m_nFileSize);
+}
+
+void SegmentDownloader::SaveState()
+{
+    // 不支持Range时无法续传，不保存进度
+    if (!m_bStateDirty || !m_bRangeSupported || m_vecSegments.isEmpty()) {
+        return;
+    }
+    m_file.flush();
+    QJsonArray arrSegments;
+    for (const Segment &segment : m_vecSegments) {
+        arrSegments.append(QJsonArray{segment.nStart, segment.nEnd, segment.nDone});
+    }
+    QJsonObject obj;
+    obj["filename"] = m_strFileName;
+    obj["size"] = m_nFileSize;
+    obj["last_modified"] = QString::fromLatin1(m_lastModified);
+    obj["segments"] = arrSegments;
+
+    QSaveFile file(StatePath());
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+        if (file.commit()) {
+            m_bStateDirty = false;
+        }
+    }
+}
+
+bool SegmentDownloader::LoadState()
+{
+    QFile file(StatePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+    qint64 nSize = static_cast<qint64>(obj["size"].toDouble(-1));
+    if (obj["filename"].toString() != m_strFileName || nSize < 0
+            || QFileInfo(PartPath()).size() != nSize) {
+        return false;
+    }
+
+    QVector<Segment> vecSegments;
+    const QJsonArray arrSegments = obj["segments"].toArray();
+    for (const QJsonValue &value : arrSegments) {
+        QJsonArray arrSegment = value.toArray();
+        Segment segment;
+        segment.nStart = static_cast<qint64>(arrSegment.at(0).toDouble());
+        segment.nEnd = static_cast<qint64>(arrSegment.at(1).toDouble());
+        segment.nDone = static_cast<qint64>(arrSegment.at(2).toDouble());
+        segment.nRetries = 0;
+        if (segment.nStart < 0 || segment.nEnd >= nSize || segment.nDone < 0
+                || segment.nStart + segment.nDone > segment.nEnd + 1) {
+            return false;
+        }
+        vecSegments.append(segment);
+    }
+    if (vecSegments.isEmpty()) {
+        return false;
+    }
+    m_nFileSize = nSize;
+    m_lastModified = obj["last_modified"].toString().toLatin1();
+    m_vecSegments = vecSegments;
+    ++m_nGeneration;
+    qDebug() << m_strFileName << "从断点继续下载";
+    return true;
+}
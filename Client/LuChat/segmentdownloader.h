@@ -0,0 +1,117 @@
+#ifndef SEGMENTDOWNLOADER_H
+#define SEGMENTDOWNLOADER_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
+
+class BandwidthLimiter;
+
+// 分段下载参数
+const int DOWNLOAD_SEGMENT_COUNT = 4;                    // 最多同时下载的分段数
+const qint64 DOWNLOAD_MIN_SEGMENT = 4 * 1024 * 1024;     // 小于该大小不再分段
+const qint64 DOWNLOAD_READ_BUFFER = 1024 * 1024;         // 每个请求的读缓冲上限，数据到达即写盘
+const int DOWNLOAD_SEGMENT_MAX_RETRY = 5;                // 分段连续失败（期间没有收到数据）的重试次数
+const int DOWNLOAD_STATE_SAVE_INTERVAL = 1000;           // 进度状态文件的保存间隔（毫秒）
+
+/**
+ * @brief 分段、可续传地下载服务器上的一个文件（/api/download）
+ *
+ * 先用Range: bytes=0-0探测文件大小和修改时间，再把文件分成若干段，用Range
+ * 请求并发下载，数据到达即写入目标目录下的<目标>.part文件对应偏移处，
+ * 不在内存中缓存整个文件。各段进度定期写入<目标>.part.state，中断（取消、
+ * 断网、程序退出）后再次下载同一文件时从断点继续；续传请求带If-Range，
+ * 服务器上的文件已变化时从头下载。全部完成后把.part重命名为目标文件。
+ * 设置了BandwidthLimiter时按额度从响应中读取，读缓冲满后由TCP让服务器放慢。
+ */
+class SegmentDownloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    // strServerUrl形如"http://host:port"，strFileName为服务器上的文件名
+    SegmentDownloader(QNetworkAccessManager *pManager, const QString &strServerUrl,
+                      const QString &strFileName, const QString &strSavePath, QObject *parent = nullptr);
+    ~SegmentDownloader();
+
+    QString FileName() const;
+    QString SavePath() const;
+    // 文件大小（探测完成前为-1）
+    qint64 FileSize() const;
+
+    // 设置限速器（可为空）
+    void SetBandwidthLimiter(BandwidthLimiter *pLimiter);
+
+    // 开始（或从断点继续）下载
+    void Start();
+    // 暂停下载，保存进度以便之后继续，不再发出任何信号
+    void Pause();
+    // 取消下载，删除已下载的部分和进度，不再发出任何信号
+    void Discard();
+
+signals:
+    void progress(qint64 nReceived, qint64 nTotal);
+    void finished(const QString &strSavePath);
+    void failed(const QString &strError);
+
+private slots:
+    void OnProbeFinished();
+    void OnSegmentReadyRead();
+    void OnSegmentFinished();
+    void OnLimiterRefilled();
+    void SaveState();
+
+private:
+    // 一个分段：[nStart, nEnd]，已下载nDone字节
+    typedef struct _Segment {
+        qint64 nStart;
+        qint64 nEnd;
+        qint64 nDone;
+        int nRetries;               // 连续失败次数，收到数据后清零
+    } Segment;
+
+    QNetworkAccessManager *m_pManager;
+    QString m_strServerUrl;
+    QString m_strFileName;
+    QString m_strSavePath;
+    qint64 m_nFileSize;
+    QByteArray m_lastModified;           // 服务器文件的Last-Modified，续传时用于If-Range
+    bool m_bRangeSupported;
+    QVector<Segment> m_vecSegments;
+    int m_nGeneration;                   // 分段重新划分（或从头下载）的次数，过时的重试据此放弃
+    QHash<QNetworkReply*, int> m_hashRunning; // 正在下载的请求 -> 分段
+    QNetworkReply *m_pProbeReply;
+    QFile m_file;                        // <目标>.part
+    QTimer m_saveTimer;
+    bool m_bStateDirty;
+    bool m_bStopped;
+    bool m_bRestarted;                   // 已因服务器文件变化从头下载过一次
+    QPointer<BandwidthLimiter> m_pLimiter;
+
+    QString PartPath() const;
+    QString StatePath() const;
+    QUrl DownloadUrl() const;
+    // 读取上次中断时保存的进度
+    bool LoadState();
+    // 按文件大小划分分段
+    void PlanSegments();
+    // 打开.part文件并开始下载未完成的分段
+    void StartSegments();
+    void StartSegment(int nIndex);
+    // 把响应中已到达的数据写入分段（bAll为false时只读取限速额度内的部分），
+    // 下载因此失败或从头开始时返回false
+    bool ReadSegment(QNetworkReply *pReply, bool bAll);
+    // 从头下载（服务器文件已变化或状态无效）
+    void Restart();
+    void Complete();
+    void Fail(const QString &strError);
+    void AbortReplies();
+    void ReportProgress();
+};
+
+#endif // SEGMENTDOWNLOADER_H
@@ -0,0 +1,94 @@
+#include "session.h"
+#include "common.h"
+#include "networkmanager.h"
+#include "appconfig.h"
+#include "chatconnection.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QDebug>
+
+// 令牌在过期前这么多秒内视为已过期，避免启动后立刻失效
+static const qint64 SESSION_EXPIRY_MARGIN = 60;
+
+Session::Session(QObject *parent) :
+    QObject(parent),
+    m_bRunning(false)
+{
+}
+
+bool Session::Restore()
+{
+    AppConfig *pConfig = AppConfig::GetInstance();
+    QString strToken = pConfig->SessionToken();
+    QString strUserId = pConfig->SavedUserId();
+    QString strUserPhone = pConfig->SavedUserPhone();
+    qint64 nExpiresAt = pConfig->SessionExpiresAt();
+    if (strToken.isEmpty()) {
+        return false;
+    }
+    if (strUserId.isEmpty() || strUserPhone.isEmpty()
+            || nExpiresAt - SESSION_EXPIRY_MARGIN <= QDateTime::currentSecsSinceEpoch()) {
+        // 已过期的令牌不再带给服务器
+        pConfig->ClearSession();
+        return false;
+    }
+    g_stUserInfo.strUserId = strUserId;
+    g_stUserInfo.strUserPhone = strUserPhone;
+    g_stUserInfo.strLoginTime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+    return true;
+}
+
+void Session::Save(const QJsonObject &dataObj)
+{
+    QString strToken = dataObj["token"].toString();
+    if (strToken.isEmpty()) {
+        // 服务器不支持会话令牌
+        AppConfig::GetInstance()->ClearSession();
+        return;
+    }
+    AppConfig::GetInstance()->SetSession(strToken, dataObj["expires_at"].toVariant().toLongLong(),
+                                         dataObj["userid"].toVariant().toString(),
+                                         dataObj["userphone"].toString());
+}
+
+void Session::Validate()
+{
+    QString strToken = AppConfig::GetInstance()->SessionToken();
+    if (m_bRunning || strToken.isEmpty()) {
+        return;
+    }
+    m_bRunning = true;
+
+    QNetworkRequest request(AppConfig::GetInstance()->ApiUrl("/api/session"));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QJsonObject jsonObj;
+    jsonObj["token"] = strToken;
+    QNetworkReply *pReply = NetworkManager::GetInstance()->post(request, QJsonDocument(jsonObj).toJson(QJsonDocument::Compact));
+    connect(pReply, &QNetworkReply::finished, this, [this, pReply]() {
+        pReply->deleteLater();
+        m_bRunning = false;
+        ChatConnection *pConnection = ChatConnection::GetInstance();
+        if (pReply->error() != QNetworkReply::NoError) {
+            // 网络不通：沿用本地令牌，连上服务器后再校验
+            qDebug() << "会话校验失败，稍后重试:" << pReply->errorString();
+            connect(pConnection, &ChatConnection::connected, this, &Session::Validate, Qt::UniqueConnection);
+            return;
+        }
+        disconnect(pConnection, &ChatConnection::connected, this, &Session::Validate);
+
+        QJsonObject replyObj = QJsonDocument::fromJson(pReply->readAll()).object();
+        int nCode = replyObj["code"].toInt();
+        if (nCode == RESPONSE_CODE_TOKEN_INVALID || nCode == RESPONSE_CODE_INVALID_PARAM) {
+            AppConfig::GetInstance()->ClearSession();
+            emit rejected(replyObj["message"].toString());
+            return;
+        }
+        if (nCode != RESPONSE_CODE_SUCCESS) {
+            // 服务器暂时出错（如数据库不可用），不因此要求重新登录
+            qDebug() << "会话校验未完成:" << replyObj["message"].toString();
+            return;
+        }
+        Save(replyObj["data"].toObject());
+        emit validated();
+    });
+}
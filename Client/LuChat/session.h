@@ -0,0 +1,39 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <QObject>
+#include <QJsonObject>
+
+/**
+ * @brief 会话令牌（免登录启动）
+ *
+ * 勾选"记住密码"登录成功后保存服务器签发的令牌和用户信息。下次启动时
+ * Restore直接恢复当前用户，不弹出登录对话框、不等待登录请求，WebSocket
+ * 带着令牌连接；同时Validate在后台向服务器校验令牌并换取新令牌（滑动
+ * 过期），被拒绝时才回到登录对话框。校验时网络不通则沿用本地令牌，
+ * 连上服务器后再次校验。
+ */
+class Session : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Session(QObject *parent = nullptr);
+
+    // 读取保存的令牌，未过期时填好g_stUserInfo并返回true
+    static bool Restore();
+    // 保存登录响应中data对象里的令牌和用户信息（令牌本身由AppConfig保存）
+    static void Save(const QJsonObject &dataObj);
+
+    // 在后台向服务器校验令牌
+    void Validate();
+
+signals:
+    void validated();                           // 令牌有效，已保存新令牌
+    void rejected(const QString &strMessage);   // 令牌被服务器拒绝
+
+private:
+    bool m_bRunning;    // 是否有校验请求正在进行
+};
+
+#endif // SESSION_H
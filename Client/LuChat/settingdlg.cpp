@@ -1,7 +1,7 @@
 #include "settingdlg.h"
 #include "ui_settingdlg.h"
-#include <QSettings>
 #include "common.h"
+#include "appconfig.h"
 #include <QMessageBox>
 
 // Define the static singleton instance pointer
@@ -20,15 +20,13 @@ SettingDlg::SettingDlg(QWidget *parent) :
     setWindowTitle("设置");
     // setupUi 已自动调用 connectSlotsByName
 
-    // 从配置中读取已保存的IP和端口并显示
-    QSettings setting;
-    QString host = setting.value(CURRENT_SERVER_HOST, "").toString();
-    QString port = setting.value(WEBSOCKET_SERVER_PORT,"").toString();
-    if (!host.isEmpty()) {
-        ui->iplineEdit->setText(host);
-    }
-    if (!port.isEmpty()) {
-        ui->portlineEdit->setText(port);
+    // 从配置中读取已保存的服务器并显示：第一个为主服务器，其余为备用服务器
+    QStringList listEndpoints = AppConfig::GetInstance()->Endpoints();
+    if (!listEndpoints.isEmpty()) {
+        QString strPrimary = listEndpoints.takeFirst();
+        ui->iplineEdit->setText(strPrimary.left(strPrimary.lastIndexOf(':')));
+        ui->portlineEdit->setText(strPrimary.mid(strPrimary.lastIndexOf(':') + 1));
+        ui->backupplainTextEdit->setPlainText(listEndpoints.join("\n"));
     }
 
 //    connect(ui->okpushButton, &QPushButton::clicked, this,
@@ -54,11 +52,46 @@ void SettingDlg::on_okpushButton_clicked()
         QMessageBox::warning(this, "提示","IP或者PORT不能为空");
         return;
     }
+    if (!checkEndpoint(ip, port)) {
+        return;
+    }
+    QStringList listEndpoints;
+    listEndpoints << ip + ":" + port;
+
+    // 备用服务器：每行一个"IP:PORT"，空行忽略
+    const QStringList listLines = ui->backupplainTextEdit->toPlainText().split("\n");
+    for (const QString &line : listLines) {
+        QString endpoint = line.trimmed();
+        if (endpoint.isEmpty()) {
+            continue;
+        }
+        int pos = endpoint.lastIndexOf(':');
+        if (pos < 0) {
+            QMessageBox::warning(this, "提示", QString("备用服务器格式错误: %1").arg(endpoint));
+            return;
+        }
+        if (!checkEndpoint(endpoint.left(pos), endpoint.mid(pos + 1))) {
+            return;
+        }
+        if (!listEndpoints.contains(endpoint)) {
+            listEndpoints << endpoint;
+        }
+    }
+
+    // 保存配置：有变化时AppConfig通知网络层和连接层立即切换到新服务器
+    // （不重启程序，内存中的会话和缓存保留）
+    AppConfig::GetInstance()->SetServers(listEndpoints);
+    accept();
+}
+
+// 验证一个服务器的IP和端口格式，不合法时提示
+bool SettingDlg::checkEndpoint(const QString &ip, const QString &port)
+{
     // 验证IP地址格式
     QStringList ipParts = ip.split(".");
     if (ipParts.size() != 4) {
-        QMessageBox::warning(this, "提示", "IP地址格式错误");
-        return;
+        QMessageBox::warning(this, "提示", QString("IP地址格式错误: %1").arg(ip));
+        return false;
     }
     // 遍历IP地址判断
     for ( const QString &part:ipParts) {
@@ -66,40 +99,18 @@ void SettingDlg::on_okpushButton_clicked()
         // 将IP地址中字符串转化为Int
         int num = part.toInt(&isNumber);
         if(!isNumber || num < 0 || num > 255) {
-            QMessageBox::warning(this, "提示","IP地址中包含无效数字");
-            return;
+            QMessageBox::warning(this, "提示", QString("IP地址中包含无效数字: %1").arg(ip));
+            return false;
         }
     }
     // 验证端口格式
     bool isNumber;
     int portnum = port.toInt(&isNumber);
     if (!isNumber || portnum < 0 || portnum > 65535)  {
-        QMessageBox::warning(this, "提示", "PORT端口号包含无效数字");
-        return ;
+        QMessageBox::warning(this, "提示", QString("PORT端口号包含无效数字: %1").arg(port));
+        return false;
     }
-
-    // 保存配置
-    QSettings setting;
-    QString oldIp = setting.value(CURRENT_SERVER_HOST).toString();
-    QString oldPort = setting.value(WEBSOCKET_SERVER_PORT).toString();
-
-    // 如果配置发生变化，提示需要重启程序
-    bool needRestart = false;
-    if ((!oldIp.isEmpty() || oldPort.isEmpty()) && (oldIp != ip || oldPort != port)) {
-        QMessageBox::information(this,"提示","配置文件已经被修改，需要重启程序生效");
-        needRestart = true;
-    }
-
-    // 保存新配置
-    setting.setValue(CURRENT_SERVER_HOST, ip);
-    setting.setValue(WEBSOCKET_SERVER_PORT, port);
-
-    // 如果需要重启，使用工具函数
-    if (needRestart == true ) {
-        RestartApp();
-        exit(-1);
-    } 
-    accept();
+    return true;
 }
 
 void SettingDlg::on_cancelpushButton_clicked()
@@ -20,9 +20,13 @@ public:
         return m_pInstance;
     }
     ~SettingDlg();
+
 private:
     explicit SettingDlg(QWidget *parent = nullptr);
 
+    // 验证一个服务器的IP和端口格式，不合法时提示
+    bool checkEndpoint(const QString &ip, const QString &port);
+
 private slots:
     void on_okpushButton_clicked();
     void on_cancelpushButton_clicked();
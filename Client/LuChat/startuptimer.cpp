@@ -0,0 +1,45 @@
+#include "startuptimer.h"
+#include <QDebug>
+
+QElapsedTimer StartupTimer::m_clock;
+QVector<QPair<QString, qint64>> StartupTimer::m_vecPhases;
+bool StartupTimer::m_bFinished = false;
+
+void StartupTimer::Start()
+{
+    m_clock.start();
+    m_vecPhases.clear();
+    m_bFinished = false;
+}
+
+void StartupTimer::Mark(const QString &strPhase)
+{
+    if (!IsRunning()) {
+        return;
+    }
+    qint64 nNow = m_clock.elapsed();
+    qint64 nPrevious = m_vecPhases.isEmpty() ? 0 : m_vecPhases.last().second;
+    m_vecPhases.append(qMakePair(strPhase, nNow));
+    qDebug() << "启动阶段:" << strPhase << nNow << "ms（+" << nNow - nPrevious << "ms）";
+}
+
+void StartupTimer::Finish()
+{
+    if (!IsRunning()) {
+        return;
+    }
+    Mark("聊天可用");
+    m_bFinished = true;
+    qDebug() << "启动耗时汇总：";
+    qint64 nPrevious = 0;
+    for (const QPair<QString, qint64> &phase : m_vecPhases) {
+        qDebug().noquote() << QString("  %1 %2 ms（+%3 ms）").arg(phase.first, -16)
+                              .arg(phase.second, 6).arg(phase.second - nPrevious);
+        nPrevious = phase.second;
+    }
+}
+
+bool StartupTimer::IsRunning()
+{
+    return m_clock.isValid() && !m_bFinished;
+}
@@ -0,0 +1,35 @@
+#ifndef STARTUPTIMER_H
+#define STARTUPTIMER_H
+
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <QElapsedTimer>
+
+/**
+ * @brief 启动各阶段的耗时记录
+ *
+ * 从main开始计时，各阶段完成时调用Mark记录时间点（同时输出距启动和
+ * 距上一阶段的耗时）。聊天可用（主窗口显示且WebSocket已连接）时调用
+ * Finish输出汇总，之后的Mark不再记录，重连等不会混入启动数据。
+ * 只在界面线程中使用。
+ */
+class StartupTimer
+{
+public:
+    // 开始计时（main的第一步）
+    static void Start();
+    // 记录一个阶段完成
+    static void Mark(const QString &strPhase);
+    // 启动完成，输出各阶段耗时汇总
+    static void Finish();
+    // 是否仍在记录启动阶段
+    static bool IsRunning();
+
+private:
+    static QElapsedTimer m_clock;
+    static QVector<QPair<QString, qint64>> m_vecPhases;  // 阶段名 -> 距启动的毫秒数
+    static bool m_bFinished;
+};
+
+#endif // STARTUPTIMER_H
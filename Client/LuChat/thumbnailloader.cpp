@@ -0,0 +1,276 @@
+#include "thumbnailloader.h"
+#include "attachmentcache.h"
+#include "networkmanager.h"
+#include "appconfig.h"
+#include <QRunnable>
+#include <QThread>
+#include <QImageReader>
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QDebug>
+#include <functional>
+
+ThumbnailLoader *ThumbnailLoader::m_pInstance = nullptr;
+
+namespace {
+
+// 线程池任务（QThreadPool::start(std::function)需要Qt 5.15）
+class ThumbnailTask : public QRunnable
+{
+public:
+    explicit ThumbnailTask(const std::function<void()> &fn) : m_fn(fn) {}
+    void run() override { m_fn(); }
+
+private:
+    std::function<void()> m_fn;
+};
+
+}
+
+ThumbnailLoader::ThumbnailLoader(QObject *parent) :
+    QObject(parent),
+    m_bDispatchPending(false)
+{
+    m_strDiskDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/thumbnails";
+    QDir().mkpath(m_strDiskDir);
+    m_cache.setMaxCost(THUMBNAIL_MEMORY_BUDGET);
+    // 解码占用CPU，留出核心给界面线程和网络线程
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+    m_clock.start();
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+    // 未开始的任务直接丢弃，正在执行的任务结束后才释放
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void ThumbnailLoader::DestroyInstance()
+{
+    delete m_pInstance;
+    m_pInstance = nullptr;
+}
+
+bool ThumbnailLoader::IsImageLink(const QString &strLink)
+{
+    static const QSet<QString> IMAGE_SUFFIXES = {"png", "jpg", "jpeg", "gif", "bmp", "webp"};
+    if (strLink.isEmpty()) {
+        return false;
+    }
+    QUrl url(strLink);
+    // 只预览本服务的文件：其他主机上的图片不自动请求，否则发送方可借此获知每个查看者的IP
+    if (!url.isRelative() && !AppConfig::GetInstance()->IsServerHost(url.host())) {
+        return false;
+    }
+    // /api/download?filename=x 或 /web/uploads/x
+    QString strFileName = url.path().endsWith("/api/download")
+            ? QUrlQuery(url).queryItemValue("filename", QUrl::FullyDecoded) : url.path();
+    return IMAGE_SUFFIXES.contains(QFileInfo(strFileName).suffix().toLower());
+}
+
+QString ThumbnailLoader::KeyOf(const QString &strLink)
+{
+    // 同一内容的文件被多次转发时共用缩略图
+    QString strHash = AttachmentCache::HashOfLink(strLink);
+    return strHash.isEmpty() ? strLink : strHash;
+}
+
+QString ThumbnailLoader::DiskPathOf(const QString &strKey) const
+{
+    return m_strDiskDir + "/"
+            + QString::fromLatin1(QCryptographicHash::hash(strKey.toUtf8(), QCryptographicHash::Sha1).toHex())
+            + ".png";
+}
+
+QImage ThumbnailLoader::Thumbnail(const QString &strLink)
+{
+    QString strKey = KeyOf(strLink);
+    // object()同时把该项移到LRU的最前面
+    if (QImage *pImage = m_cache.object(strKey)) {
+        return *pImage;
+    }
+    if (m_setFailed.contains(strKey) || m_setRunning.contains(strKey)) {
+        return QImage();
+    }
+
+    // 最近绘制的请求排在最前面
+    for (int i = 0; i < m_listQueue.size(); ++i) {
+        if (m_listQueue.at(i).strKey == strKey) {
+            m_listQueue.removeAt(i);
+            break;
+        }
+    }
+    Request request;
+    request.strKey = strKey;
+    request.strLink = strLink;
+    request.nRequestedAt = m_clock.elapsed();
+    m_listQueue.prepend(request);
+
+    // 绘制期间不发起请求，一次绘制中的所有请求合并调度
+    if (!m_bDispatchPending) {
+        m_bDispatchPending = true;
+        QTimer::singleShot(0, this, [this]() {
+            m_bDispatchPending = false;
+            Dispatch();
+        });
+    }
+    return QImage();
+}
+
+bool ThumbnailLoader::IsFailed(const QString &strLink) const
+{
+    return m_setFailed.contains(KeyOf(strLink));
+}
+
+void ThumbnailLoader::Dispatch()
+{
+    qint64 nNow = m_clock.elapsed();
+    while (m_setRunning.size() < THUMBNAIL_MAX_RUNNING && !m_listQueue.isEmpty()) {
+        Request request = m_listQueue.takeFirst();
+        if (nNow - request.nRequestedAt > THUMBNAIL_REQUEST_TTL) {
+            // 已滚出可见区域，仍可见的话下次绘制时会重新请求
+            continue;
+        }
+        m_setRunning.insert(request.strKey);
+        LoadLocal(request, AttachmentCache::GetInstance()->Lookup(AttachmentCache::HashOfLink(request.strLink)));
+    }
+}
+
+void ThumbnailLoader::LoadLocal(const Request &request, const QString &strSourcePath)
+{
+    QString strDiskPath = DiskPathOf(request.strKey);
+    m_pool.start(new ThumbnailTask([this, request, strDiskPath, strSourcePath]() {
+        QImage image;
+        if (QFile::exists(strDiskPath)) {
+            image.load(strDiskPath);
+        }
+        if (image.isNull() && !strSourcePath.isEmpty()) {
+            QFile file(strSourcePath);
+            if (file.open(QIODevice::ReadOnly)) {
+                image = DecodeScaled(&file);
+            }
+            if (!image.isNull()) {
+                SaveThumbnail(image, strDiskPath);
+            }
+        }
+        // 本地没有原图时才需要下载；原图解码失败说明不是有效的图片
+        bool bNeedFetch = image.isNull() && strSourcePath.isEmpty();
+        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        QMetaObject::invokeMethod(this, [this, request, image, bNeedFetch]() {
+            OnLoaded(request, image, bNeedFetch);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void ThumbnailLoader::Fetch(const Request &request)
+{
+    QUrl url(request.strLink);
+    if (!url.isRelative() && !AppConfig::GetInstance()->IsServerHost(url.host())) {
+        OnLoaded(request, QImage(), false);
+        return;
+    }
+    QUrl baseUrl(AppConfig::GetInstance()->HttpUrl() + "/");
+    QNetworkReply *pReply = NetworkManager::GetInstance()->get(QNetworkRequest(baseUrl.resolved(url)));
+    // 原图过大时放弃，不把整个文件读入内存（分块传输的响应没有Content-Length，按已收到的字节数判断）
+    auto checkSize = [pReply](qint64 nBytes) {
+        if (nBytes > THUMBNAIL_MAX_SOURCE && !pReply->property("tooLarge").toBool()) {
+            pReply->setProperty("tooLarge", true);
+            pReply->abort();
+        }
+    };
+    connect(pReply, &QNetworkReply::metaDataChanged, this, [pReply, checkSize]() {
+        checkSize(pReply->header(QNetworkRequest::ContentLengthHeader).toLongLong());
+    });
+    connect(pReply, &QNetworkReply::downloadProgress, this, [checkSize](qint64 nReceived, qint64) {
+        checkSize(nReceived);
+    });
+    connect(pReply, &QNetworkReply::finished, this, [this, pReply, request]() {
+        pReply->deleteLater();
+        int nStatus = pReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (pReply->property("tooLarge").toBool()
+                || (pReply->error() == QNetworkReply::NoError
+                    && pReply->header(QNetworkRequest::ContentTypeHeader).toString().contains("json"))
+                || (nStatus >= 400 && nStatus < 500)) {
+            // 服务器明确拒绝或文件不适合预览，本次运行不再请求
+            OnLoaded(request, QImage(), false);
+            return;
+        }
+        if (pReply->error() != QNetworkReply::NoError) {
+            // 网络错误：不记为失败，之后再次绘制时重试
+            qDebug() << "缩略图下载失败:" << request.strLink << pReply->errorString();
+            m_setRunning.remove(request.strKey);
+            Dispatch();
+            return;
+        }
+        DecodeData(request, pReply->readAll());
+    });
+}
+
+void ThumbnailLoader::DecodeData(const Request &request, const QByteArray &data)
+{
+    QString strDiskPath = DiskPathOf(request.strKey);
+    m_pool.start(new ThumbnailTask([this, request, data, strDiskPath]() {
+        QByteArray buffer = data;
+        QBuffer device(&buffer);
+        device.open(QIODevice::ReadOnly);
+        QImage image = DecodeScaled(&device);
+        if (!image.isNull()) {
+            SaveThumbnail(image, strDiskPath);
+            image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        }
+        QMetaObject::invokeMethod(this, [this, request, image]() {
+            OnLoaded(request, image, false);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void ThumbnailLoader::OnLoaded(const Request &request, const QImage &image, bool bNeedFetch)
+{
+    if (bNeedFetch) {
+        // 仍占用名额，下载完成后再解码
+        Fetch(request);
+        return;
+    }
+    m_setRunning.remove(request.strKey);
+    if (image.isNull()) {
+        m_setFailed.insert(request.strKey);
+    } else {
+        m_cache.insert(request.strKey, new QImage(image), static_cast<int>(image.sizeInBytes()));
+    }
+    // 失败时同样通知，视图把"加载中"换成"无法预览"
+    emit thumbnailReady(request.strLink);
+    Dispatch();
+}
+
+QImage ThumbnailLoader::DecodeScaled(QIODevice *pDevice)
+{
+    QImageReader reader(pDevice);
+    reader.setAutoTransform(true);
+    // 解码时直接缩放，JPEG等格式只解码所需的分辨率
+    QSize size = reader.size();
+    if (size.isValid() && (size.width() > THUMBNAIL_SIZE || size.height() > THUMBNAIL_SIZE)) {
+        reader.setScaledSize(size.scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if (!image.isNull() && (image.width() > THUMBNAIL_SIZE || image.height() > THUMBNAIL_SIZE)) {
+        image = image.scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+void ThumbnailLoader::SaveThumbnail(const QImage &image, const QString &strPath)
+{
+    QSaveFile file(strPath);
+    if (file.open(QIODevice::WriteOnly) && image.save(&file, "PNG")) {
+        file.commit();
+    }
+}
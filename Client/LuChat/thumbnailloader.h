@@ -0,0 +1,96 @@
+#ifndef THUMBNAILLOADER_H
+#define THUMBNAILLOADER_H
+
+#include <QObject>
+#include <QImage>
+#include <QCache>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QNetworkReply>
+
+// 缩略图参数
+const int THUMBNAIL_SIZE = 160;                                // 缩略图最大边长（像素），消息中按此预留位置
+const int THUMBNAIL_MEMORY_BUDGET = 32 * 1024 * 1024;          // 内存中缩略图的总字节数上限（LRU）
+const qint64 THUMBNAIL_MAX_SOURCE = 20 * 1024 * 1024;          // 原图超过该大小不生成缩略图
+const int THUMBNAIL_MAX_RUNNING = 4;                           // 同时进行的解码和下载数
+const int THUMBNAIL_REQUEST_TTL = 500;                         // 排队超过该时间（毫秒）未再被绘制的请求丢弃
+
+/**
+ * @brief 图片附件的缩略图（界面线程的入口）
+ *
+ * 消息委托绘制时调用Thumbnail：内存中有则直接返回，否则排队请求并返回空图。
+ * 只有正在绘制（可见）的消息会发起请求，最近绘制的优先处理，滚动过去、
+ * 一段时间没有再被绘制的请求直接丢弃。请求依次查找磁盘上的缩略图、附件
+ * 缓存中的原图，最后才从服务器下载原图；解码和缩放都在线程池中进行，
+ * 解码时直接按缩略图尺寸缩放（JPEG等格式不会解码出整张大图），界面线程
+ * 只负责调度和网络请求。完成后发出thumbnailReady，视图重绘可见的消息。
+ */
+class ThumbnailLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ThumbnailLoader *GetInstance() {
+        if (m_pInstance == nullptr) {
+            m_pInstance = new ThumbnailLoader();
+        }
+        return m_pInstance;
+    }
+    // 退出前等待线程池中的任务结束
+    static void DestroyInstance();
+    ~ThumbnailLoader();
+
+    // 链接是否指向可以生成缩略图的图片
+    static bool IsImageLink(const QString &strLink);
+
+    // 取文件链接对应的缩略图，尚未生成时排队请求并返回空图
+    QImage Thumbnail(const QString &strLink);
+    // 缩略图是否已确定无法生成（下载失败、不是图片、原图过大）
+    bool IsFailed(const QString &strLink) const;
+
+signals:
+    void thumbnailReady(const QString &strLink);
+
+private:
+    // 一个缩略图请求
+    typedef struct _Request {
+        QString strKey;         // 缓存键（链接中的内容哈希，没有时为链接）
+        QString strLink;
+        qint64 nRequestedAt;    // 最近一次被绘制的时间
+    } Request;
+
+    explicit ThumbnailLoader(QObject *parent = nullptr);
+
+    QThreadPool m_pool;
+    QString m_strDiskDir;                   // 磁盘缩略图目录
+    QCache<QString, QImage> m_cache;        // 内存缩略图（按字节数计费的LRU）
+    QList<Request> m_listQueue;             // 排队的请求，最近绘制的在前
+    QSet<QString> m_setRunning;             // 正在处理的缓存键
+    QSet<QString> m_setFailed;              // 无法生成的缓存键
+    QElapsedTimer m_clock;
+    bool m_bDispatchPending;                // 已安排调度，等待回到事件循环
+
+    static ThumbnailLoader *m_pInstance;
+
+    static QString KeyOf(const QString &strLink);
+    QString DiskPathOf(const QString &strKey) const;
+    // 有空闲名额时开始处理排队的请求
+    void Dispatch();
+    // 在线程池中查找磁盘缩略图或附件缓存中的原图
+    void LoadLocal(const Request &request, const QString &strSourcePath);
+    // 从服务器下载原图
+    void Fetch(const Request &request);
+    // 在线程池中解码下载的原图
+    void DecodeData(const Request &request, const QByteArray &data);
+    // 线程池任务完成（回到界面线程）
+    void OnLoaded(const Request &request, const QImage &image, bool bNeedFetch);
+
+    // 以下在线程池中执行
+    static QImage DecodeScaled(QIODevice *pDevice);
+    static void SaveThumbnail(const QImage &image, const QString &strPath);
+};
+
+#endif // THUMBNAILLOADER_H
@@ -0,0 +1,164 @@
+#include "transfermodel.h"
+
+TransferModel::TransferModel(TransferScheduler *pScheduler, QObject *parent) :
+    QAbstractTableModel(parent),
+    m_pScheduler(pScheduler)
+{
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(TRANSFER_UI_REFRESH_INTERVAL);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &TransferModel::FlushChanges);
+
+    const QList<int> listIds = pScheduler->Ids();
+    for (int nId : listIds) {
+        m_hashRows.insert(nId, m_vecIds.size());
+        m_vecIds.append(nId);
+    }
+    connect(pScheduler, &TransferScheduler::transferAdded, this, &TransferModel::OnTransferAdded);
+    connect(pScheduler, &TransferScheduler::transferChanged, this, &TransferModel::OnTransferChanged);
+    connect(pScheduler, &TransferScheduler::transferRemoved, this, &TransferModel::OnTransferRemoved);
+}
+
+int TransferModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_vecIds.size();
+}
+
+int TransferModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant TransferModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_vecIds.size()) {
+        return QVariant();
+    }
+    int nId = m_vecIds.at(index.row());
+    if (role == TransferIdRole) {
+        return nId;
+    }
+    const TransferInfo info = m_pScheduler->Info(nId);
+    int nPercent = info.nTotal > 0 ? static_cast<int>(info.nDone * 100 / info.nTotal)
+                                   : (info.nTotal == 0 && info.eState == TRANSFER_FINISHED ? 100 : -1);
+    if (role == ProgressRole) {
+        return nPercent;
+    }
+    if (role == Qt::ToolTipRole) {
+        return info.strMessage.isEmpty() ? info.strLocalPath : info.strLocalPath + "\n" + info.strMessage;
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (index.column()) {
+    case COLUMN_NAME:
+        return info.strName;
+    case COLUMN_DIRECTION:
+        return info.bUpload ? QString("上传") : QString("下载");
+    case COLUMN_STATE: {
+        static const QString STATE_NAMES[] = {"排队中", "传输中", "已暂停", "已完成", "失败", "已取消"};
+        QString strState = STATE_NAMES[info.eState];
+        if (info.ePriority == TRANSFER_PRIORITY_HIGH) {
+            strState += "（优先）";
+        } else if (info.ePriority == TRANSFER_PRIORITY_LOW) {
+            strState += "（靠后）";
+        }
+        if (!info.strMessage.isEmpty()) {
+            strState += " " + info.strMessage;
+        }
+        return strState;
+    }
+    case COLUMN_PROGRESS:
+        if (nPercent < 0) {
+            return FormatSize(info.nDone);
+        }
+        return QString("%1 / %2").arg(FormatSize(info.nDone)).arg(FormatSize(info.nTotal));
+    case COLUMN_SPEED:
+        return info.eState == TRANSFER_RUNNING ? FormatSize(info.nRate) + "/s" : QString();
+    default:
+        return QVariant();
+    }
+}
+
+QVariant TransferModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal || section < 0 || section >= COLUMN_COUNT) {
+        return QVariant();
+    }
+    static const QString HEADERS[COLUMN_COUNT] = {"文件", "方向", "状态", "进度", "速度"};
+    return HEADERS[section];
+}
+
+int TransferModel::TransferIdAt(int row) const
+{
+    return row >= 0 && row < m_vecIds.size() ? m_vecIds.at(row) : -1;
+}
+
+void TransferModel::OnTransferAdded(int nId)
+{
+    int row = m_vecIds.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_hashRows.insert(nId, row);
+    m_vecIds.append(nId);
+    endInsertRows();
+}
+
+void TransferModel::OnTransferChanged(int nId)
+{
+    m_setDirty.insert(nId);
+    if (!m_refreshTimer.isActive()) {
+        m_refreshTimer.start();
+    }
+}
+
+void TransferModel::OnTransferRemoved(int nId)
+{
+    if (!m_hashRows.contains(nId)) {
+        return;
+    }
+    int row = m_hashRows.value(nId);
+    beginRemoveRows(QModelIndex(), row, row);
+    m_vecIds.remove(row);
+    m_hashRows.remove(nId);
+    m_setDirty.remove(nId);
+    // 后面的行号前移
+    for (int i = row; i < m_vecIds.size(); ++i) {
+        m_hashRows[m_vecIds.at(i)] = i;
+    }
+    endRemoveRows();
+}
+
+void TransferModel::FlushChanges()
+{
+    if (m_setDirty.isEmpty()) {
+        return;
+    }
+    // 合并为一个连续区间通知，视图只重绘一次
+    int nFirst = m_vecIds.size();
+    int nLast = -1;
+    for (int nId : m_setDirty) {
+        if (m_hashRows.contains(nId)) {
+            int row = m_hashRows.value(nId);
+            nFirst = qMin(nFirst, row);
+            nLast = qMax(nLast, row);
+        }
+    }
+    m_setDirty.clear();
+    if (nLast >= 0) {
+        emit dataChanged(index(nFirst, 0), index(nLast, COLUMN_COUNT - 1));
+    }
+}
+
+QString TransferModel::FormatSize(qint64 nBytes)
+{
+    if (nBytes < 1024) {
+        return QString("%1 B").arg(nBytes);
+    }
+    if (nBytes < 1024 * 1024) {
+        return QString("%1 KB").arg(nBytes / 1024.0, 0, 'f', 1);
+    }
+    if (nBytes < 1024LL * 1024 * 1024) {
+        return QString("%1 MB").arg(nBytes / (1024.0 * 1024), 0, 'f', 1);
+    }
+    return QString("%1 GB").arg(nBytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+}
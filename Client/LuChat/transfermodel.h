@@ -0,0 +1,67 @@
+#ifndef TRANSFERMODEL_H
+#define TRANSFERMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include "transferscheduler.h"
+
+// 传输列表刷新到界面的间隔（毫秒）
+const int TRANSFER_UI_REFRESH_INTERVAL = 250;
+
+/**
+ * @brief 传输列表模型
+ *
+ * 行与TransferScheduler中的任务一一对应。传输进度变化非常频繁，模型只
+ * 记下变化的行，每TRANSFER_UI_REFRESH_INTERVAL毫秒合并通知一次，
+ * 视图的重绘频率与传输速度无关。
+ */
+class TransferModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum TransferColumn {
+        COLUMN_NAME,
+        COLUMN_DIRECTION,
+        COLUMN_STATE,
+        COLUMN_PROGRESS,
+        COLUMN_SPEED,
+        COLUMN_COUNT
+    };
+
+    enum TransferRole {
+        TransferIdRole = Qt::UserRole + 1,  // 任务ID
+        ProgressRole                        // 进度（0-100，总大小未知时为-1）
+    };
+
+    explicit TransferModel(TransferScheduler *pScheduler, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+
+    int TransferIdAt(int row) const;
+
+private slots:
+    void OnTransferAdded(int nId);
+    void OnTransferChanged(int nId);
+    void OnTransferRemoved(int nId);
+    // 通知视图刷新积累的变化行
+    void FlushChanges();
+
+private:
+    TransferScheduler *m_pScheduler;
+    QVector<int> m_vecIds;          // 行数据
+    QHash<int, int> m_hashRows;     // 任务ID -> 行号
+    QSet<int> m_setDirty;           // 待刷新的任务ID
+    QTimer m_refreshTimer;
+
+    static QString FormatSize(qint64 nBytes);
+};
+
+#endif // TRANSFERMODEL_H
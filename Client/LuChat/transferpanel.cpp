@@ -0,0 +1,187 @@
+#include "transferpanel.h"
+#include "common.h"
+#include "appconfig.h"
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QApplication>
+#include <QStyledItemDelegate>
+
+namespace {
+
+// 进度列以进度条绘制，只在视图重绘可见行时调用
+class TransferProgressDelegate : public QStyledItemDelegate
+{
+public:
+    explicit TransferProgressDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {}
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override
+    {
+        int nPercent = index.data(TransferModel::ProgressRole).toInt();
+        if (nPercent < 0) {
+            QStyledItemDelegate::paint(painter, option, index);
+            return;
+        }
+        QStyleOptionProgressBar progressOption;
+        progressOption.rect = option.rect.adjusted(2, 2, -2, -2);
+        progressOption.minimum = 0;
+        progressOption.maximum = 100;
+        progressOption.progress = nPercent;
+        progressOption.text = QString("%1%  %2").arg(nPercent).arg(index.data().toString());
+        progressOption.textVisible = true;
+        progressOption.state = option.state | QStyle::State_Horizontal;
+        QStyle *pStyle = option.widget ? option.widget->style() : QApplication::style();
+        pStyle->drawControl(QStyle::CE_ProgressBar, &progressOption, painter, option.widget);
+    }
+};
+
+}
+
+TransferPanel::TransferPanel(TransferScheduler *pScheduler, QWidget *parent) :
+    QWidget(parent),
+    m_pScheduler(pScheduler),
+    m_pModel(new TransferModel(pScheduler, this))
+{
+    m_pTableView = new QTableView(this);
+    m_pTableView->setModel(m_pModel);
+    m_pTableView->setItemDelegateForColumn(TransferModel::COLUMN_PROGRESS, new TransferProgressDelegate(this));
+    m_pTableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pTableView->verticalHeader()->hide();
+    m_pTableView->horizontalHeader()->setSectionResizeMode(TransferModel::COLUMN_NAME, QHeaderView::Stretch);
+    m_pTableView->horizontalHeader()->setSectionResizeMode(TransferModel::COLUMN_PROGRESS, QHeaderView::Stretch);
+
+    m_pPauseBtn = new QPushButton("暂停", this);
+    m_pResumeBtn = new QPushButton("继续", this);
+    m_pCancelBtn = new QPushButton("取消", this);
+    m_pRaiseBtn = new QPushButton("提高优先级", this);
+    m_pLowerBtn = new QPushButton("降低优先级", this);
+    m_pClearBtn = new QPushButton("清除已完成", this);
+
+    // 同时传输数和限速，修改后保存在配置中
+    m_pConcurrentSpin = new QSpinBox(this);
+    m_pConcurrentSpin->setRange(1, 10);
+    m_pConcurrentSpin->setValue(pScheduler->MaxConcurrent());
+    m_pLimitSpin = new QSpinBox(this);
+    m_pLimitSpin->setRange(0, 1024 * 1024);
+    m_pLimitSpin->setSingleStep(100);
+    m_pLimitSpin->setSuffix(" KB/s");
+    m_pLimitSpin->setSpecialValueText("不限速");
+    m_pLimitSpin->setValue(static_cast<int>(pScheduler->BandwidthLimit() / 1024));
+
+    QHBoxLayout *pButtonLayout = new QHBoxLayout();
+    pButtonLayout->addWidget(m_pPauseBtn);
+    pButtonLayout->addWidget(m_pResumeBtn);
+    pButtonLayout->addWidget(m_pCancelBtn);
+    pButtonLayout->addWidget(m_pRaiseBtn);
+    pButtonLayout->addWidget(m_pLowerBtn);
+    pButtonLayout->addWidget(m_pClearBtn);
+    pButtonLayout->addStretch();
+    pButtonLayout->addWidget(new QLabel("同时传输数", this));
+    pButtonLayout->addWidget(m_pConcurrentSpin);
+    pButtonLayout->addWidget(new QLabel("限速", this));
+    pButtonLayout->addWidget(m_pLimitSpin);
+
+    QVBoxLayout *pLayout = new QVBoxLayout(this);
+    pLayout->setContentsMargins(0, 0, 0, 0);
+    pLayout->addWidget(m_pTableView);
+    pLayout->addLayout(pButtonLayout);
+
+    connect(m_pPauseBtn, &QPushButton::clicked, this, &TransferPanel::OnPause);
+    connect(m_pResumeBtn, &QPushButton::clicked, this, &TransferPanel::OnResume);
+    connect(m_pCancelBtn, &QPushButton::clicked, this, &TransferPanel::OnCancel);
+    connect(m_pRaiseBtn, &QPushButton::clicked, this, &TransferPanel::OnRaisePriority);
+    connect(m_pLowerBtn, &QPushButton::clicked, this, &TransferPanel::OnLowerPriority);
+    connect(m_pClearBtn, &QPushButton::clicked, pScheduler, &TransferScheduler::ClearFinished);
+    connect(m_pConcurrentSpin, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &TransferPanel::OnMaxConcurrentChanged);
+    connect(m_pLimitSpin, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &TransferPanel::OnBandwidthLimitChanged);
+    connect(m_pTableView->selectionModel(), &QItemSelectionModel::selectionChanged,
+            this, &TransferPanel::UpdateButtons);
+    // 状态变化后按钮可用性随之变化（随模型的合并刷新，不随每次进度）
+    connect(m_pModel, &TransferModel::dataChanged, this, &TransferPanel::UpdateButtons);
+    UpdateButtons();
+}
+
+QList<int> TransferPanel::SelectedIds() const
+{
+    QList<int> listIds;
+    const QModelIndexList listRows = m_pTableView->selectionModel()->selectedRows();
+    for (const QModelIndex &index : listRows) {
+        listIds.append(m_pModel->TransferIdAt(index.row()));
+    }
+    return listIds;
+}
+
+void TransferPanel::OnPause()
+{
+    for (int nId : SelectedIds()) {
+        m_pScheduler->Pause(nId);
+    }
+}
+
+void TransferPanel::OnResume()
+{
+    for (int nId : SelectedIds()) {
+        m_pScheduler->Resume(nId);
+    }
+}
+
+void TransferPanel::OnCancel()
+{
+    for (int nId : SelectedIds()) {
+        m_pScheduler->Cancel(nId);
+    }
+}
+
+void TransferPanel::OnRaisePriority()
+{
+    for (int nId : SelectedIds()) {
+        TransferPriority ePriority = m_pScheduler->Info(nId).ePriority;
+        if (ePriority < TRANSFER_PRIORITY_HIGH) {
+            m_pScheduler->SetPriority(nId, static_cast<TransferPriority>(ePriority + 1));
+        }
+    }
+}
+
+void TransferPanel::OnLowerPriority()
+{
+    for (int nId : SelectedIds()) {
+        TransferPriority ePriority = m_pScheduler->Info(nId).ePriority;
+        if (ePriority > TRANSFER_PRIORITY_LOW) {
+            m_pScheduler->SetPriority(nId, static_cast<TransferPriority>(ePriority - 1));
+        }
+    }
+}
+
+void TransferPanel::OnMaxConcurrentChanged(int nMax)
+{
+    // 调度器订阅了配置变化，随之调整
+    AppConfig::GetInstance()->SetTransferMaxConcurrent(nMax);
+}
+
+void TransferPanel::OnBandwidthLimitChanged(int nKBytesPerSecond)
+{
+    AppConfig::GetInstance()->SetTransferBandwidthLimit(nKBytesPerSecond);
+}
+
+void TransferPanel::UpdateButtons()
+{
+    bool bCanPause = false;
+    bool bCanResume = false;
+    bool bCanCancel = false;
+    const QList<int> listIds = SelectedIds();
+    for (int nId : listIds) {
+        TransferState eState = m_pScheduler->Info(nId).eState;
+        bCanPause |= eState == TRANSFER_QUEUED || eState == TRANSFER_RUNNING;
+        bCanResume |= eState == TRANSFER_PAUSED || eState == TRANSFER_FAILED;
+        bCanCancel |= eState != TRANSFER_FINISHED && eState != TRANSFER_CANCELED;
+    }
+    m_pPauseBtn->setEnabled(bCanPause);
+    m_pResumeBtn->setEnabled(bCanResume);
+    m_pCancelBtn->setEnabled(bCanCancel);
+    m_pRaiseBtn->setEnabled(!listIds.isEmpty());
+    m_pLowerBtn->setEnabled(!listIds.isEmpty());
+}
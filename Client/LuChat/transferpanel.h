@@ -0,0 +1,52 @@
+#ifndef TRANSFERPANEL_H
+#define TRANSFERPANEL_H
+
+#include <QWidget>
+#include <QTableView>
+#include <QPushButton>
+#include <QSpinBox>
+#include "transferscheduler.h"
+#include "transfermodel.h"
+
+/**
+ * @brief 文件传输面板（非模态，停靠在主窗口中）
+ *
+ * 列出所有上传和下载任务，可暂停、继续、取消、调整优先级，并设置同时
+ * 传输数和总限速（保存在配置中）。传输在后台进行，不阻塞聊天。
+ */
+class TransferPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TransferPanel(TransferScheduler *pScheduler, QWidget *parent = nullptr);
+
+private slots:
+    void OnPause();
+    void OnResume();
+    void OnCancel();
+    void OnRaisePriority();
+    void OnLowerPriority();
+    void OnMaxConcurrentChanged(int nMax);
+    void OnBandwidthLimitChanged(int nKBytesPerSecond);
+    // 按选中任务的状态启用按钮
+    void UpdateButtons();
+
+private:
+    TransferScheduler *m_pScheduler;
+    TransferModel *m_pModel;
+    QTableView *m_pTableView;
+    QPushButton *m_pPauseBtn;
+    QPushButton *m_pResumeBtn;
+    QPushButton *m_pCancelBtn;
+    QPushButton *m_pRaiseBtn;
+    QPushButton *m_pLowerBtn;
+    QPushButton *m_pClearBtn;
+    QSpinBox *m_pConcurrentSpin;
+    QSpinBox *m_pLimitSpin;
+
+    // 选中的任务ID
+    QList<int> SelectedIds() const;
+};
+
+#endif // TRANSFERPANEL_H
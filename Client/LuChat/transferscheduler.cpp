@@ -0,0 +1,354 @@
+#include "transferscheduler.h"
+#include "bandwidthlimiter.h"
+#include "chunkuploader.h"
+#include "segmentdownloader.h"
+#include "common.h"
+#include <QFileInfo>
+#include <QDebug>
+
+TransferScheduler::TransferScheduler(QNetworkAccessManager *pManager, QObject *parent) :
+    QObject(parent),
+    m_pManager(pManager),
+    m_pLimiter(new BandwidthLimiter(this)),
+    m_nNextId(1),
+    m_nMaxConcurrent(DEFAULT_TRANSFER_MAX_CONCURRENT)
+{
+    m_rateTimer.setInterval(TRANSFER_RATE_INTERVAL);
+    connect(&m_rateTimer, &QTimer::timeout, this, &TransferScheduler::UpdateRates);
+}
+
+TransferScheduler::~TransferScheduler()
+{
+    // 下载保存进度，下次下载同一文件时从断点继续
+    for (Transfer &transfer : m_hashTransfers) {
+        ReleaseJob(transfer, false);
+    }
+}
+
+int TransferScheduler::AddUpload(const QString &strServerUrl, const QString &strFilePath,
+                                 TransferPriority ePriority)
+{
+    QFileInfo fileInfo(strFilePath);
+    Transfer transfer;
+    transfer.info.bUpload = true;
+    transfer.info.strName = fileInfo.fileName();
+    transfer.info.strLocalPath = strFilePath;
+    transfer.info.ePriority = ePriority;
+    transfer.info.nTotal = fileInfo.size();
+    transfer.strServerUrl = strServerUrl;
+    return Add(transfer);
+}
+
+int TransferScheduler::AddDownload(const QString &strServerUrl, const QString &strFileName,
+                                   const QString &strSavePath, TransferPriority ePriority)
+{
+    Transfer transfer;
+    transfer.info.bUpload = false;
+    transfer.info.strName = strFileName;
+    transfer.info.strLocalPath = strSavePath;
+    transfer.info.ePriority = ePriority;
+    transfer.info.nTotal = -1;
+    transfer.strServerUrl = strServerUrl;
+    transfer.strServerFile = strFileName;
+    return Add(transfer);
+}
+
+int TransferScheduler::Add(const Transfer &transfer)
+{
+    int nId = m_nNextId++;
+    Transfer &added = m_hashTransfers[nId];
+    added = transfer;
+    added.info.nId = nId;
+    added.info.eState = TRANSFER_QUEUED;
+    added.info.nDone = 0;
+    added.info.nRate = 0;
+    added.nRateBase = 0;
+    m_listOrder.append(nId);
+    emit transferAdded(nId);
+    Schedule();
+    return nId;
+}
+
+void TransferScheduler::Pause(int nId)
+{
+    if (!m_hashTransfers.contains(nId)) {
+        return;
+    }
+    Transfer &transfer = m_hashTransfers[nId];
+    if (transfer.info.eState == TRANSFER_RUNNING) {
+        // 保留传输对象，继续时沿用已计算的哈希和已下载的分段
+        if (ChunkUploader *pUploader = qobject_cast<ChunkUploader*>(transfer.pJob)) {
+            pUploader->Abort();
+        } else if (SegmentDownloader *pDownloader = qobject_cast<SegmentDownloader*>(transfer.pJob)) {
+            pDownloader->Pause();
+        }
+    } else if (transfer.info.eState != TRANSFER_QUEUED) {
+        return;
+    }
+    SetState(nId, TRANSFER_PAUSED);
+    Schedule();
+}
+
+void TransferScheduler::Resume(int nId)
+{
+    if (!m_hashTransfers.contains(nId)) {
+        return;
+    }
+    TransferState eState = m_hashTransfers[nId].info.eState;
+    if (eState != TRANSFER_PAUSED && eState != TRANSFER_FAILED) {
+        return;
+    }
+    SetState(nId, TRANSFER_QUEUED);
+    Schedule();
+}
+
+void TransferScheduler::Cancel(int nId)
+{
+    if (!m_hashTransfers.contains(nId)) {
+        return;
+    }
+    Transfer &transfer = m_hashTransfers[nId];
+    if (transfer.info.eState == TRANSFER_FINISHED || transfer.info.eState == TRANSFER_CANCELED) {
+        return;
+    }
+    ReleaseJob(transfer, true);
+    transfer.info.nRate = 0;
+    SetState(nId, TRANSFER_CANCELED);
+    Schedule();
+}
+
+void TransferScheduler::SetPriority(int nId, TransferPriority ePriority)
+{
+    if (!m_hashTransfers.contains(nId) || m_hashTransfers[nId].info.ePriority == ePriority) {
+        return;
+    }
+    m_hashTransfers[nId].info.ePriority = ePriority;
+    emit transferChanged(nId);
+}
+
+void TransferScheduler::ClearFinished()
+{
+    const QList<int> listOrder = m_listOrder;
+    for (int nId : listOrder) {
+        TransferState eState = m_hashTransfers[nId].info.eState;
+        if (eState == TRANSFER_FINISHED || eState == TRANSFER_CANCELED) {
+            ReleaseJob(m_hashTransfers[nId], false);
+            m_hashTransfers.remove(nId);
+            m_listOrder.removeOne(nId);
+            emit transferRemoved(nId);
+        }
+    }
+}
+
+void TransferScheduler::SetMaxConcurrent(int nMax)
+{
+    // 只影响之后开始的任务，已在进行的不会被暂停
+    m_nMaxConcurrent = qMax(1, nMax);
+    Schedule();
+}
+
+int TransferScheduler::MaxConcurrent() const
+{
+    return m_nMaxConcurrent;
+}
+
+void TransferScheduler::SetBandwidthLimit(qint64 nBytesPerSecond)
+{
+    m_pLimiter->SetLimit(nBytesPerSecond);
+}
+
+qint64 TransferScheduler::BandwidthLimit() const
+{
+    return m_pLimiter->Limit();
+}
+
+bool TransferScheduler::Contains(int nId) const
+{
+    return m_hashTransfers.contains(nId);
+}
+
+TransferInfo TransferScheduler::Info(int nId) const
+{
+    return m_hashTransfers.value(nId).info;
+}
+
+QList<int> TransferScheduler::Ids() const
+{
+    return m_listOrder;
+}
+
+int TransferScheduler::RunningCount() const
+{
+    int nCount = 0;
+    for (const Transfer &transfer : m_hashTransfers) {
+        if (transfer.info.eState == TRANSFER_RUNNING) {
+            ++nCount;
+        }
+    }
+    return nCount;
+}
+
+void TransferScheduler::Schedule()
+{
+    int nRunning = RunningCount();
+    while (nRunning < m_nMaxConcurrent) {
+        // 优先级最高、最早加入的排队任务
+        int nNext = -1;
+        for (int nId : m_listOrder) {
+            const TransferInfo &info = m_hashTransfers[nId].info;
+            if (info.eState == TRANSFER_QUEUED
+                    && (nNext < 0 || info.ePriority > m_hashTransfers[nNext].info.ePriority)) {
+                nNext = nId;
+            }
+        }
+        if (nNext < 0) {
+            break;
+        }
+        StartTransfer(nNext);
+        ++nRunning;
+    }
+
+    if (nRunning > 0 && !m_rateTimer.isActive()) {
+        m_rateTimer.start();
+    } else if (nRunning == 0) {
+        m_rateTimer.stop();
+    }
+}
+
+void TransferScheduler::StartTransfer(int nId)
+{
+    Transfer &transfer = m_hashTransfers[nId];
+    if (!transfer.pJob) {
+        transfer.pJob = CreateJob(nId);
+    }
+    transfer.nRateBase = transfer.info.nDone;
+    transfer.info.nRate = 0;
+    SetState(nId, TRANSFER_RUNNING);
+    if (ChunkUploader *pUploader = qobject_cast<ChunkUploader*>(transfer.pJob)) {
+        pUploader->Start();
+    } else if (SegmentDownloader *pDownloader = qobject_cast<SegmentDownloader*>(transfer.pJob)) {
+        pDownloader->Start();
+    }
+}
+
+QObject *TransferScheduler::CreateJob(int nId)
+{
+    const Transfer &transfer = m_hashTransfers[nId];
+    // 任务结束后状态已变化，迟到的信号不再处理
+    auto isRunning = [this, nId]() {
+        return m_hashTransfers.contains(nId) && m_hashTransfers[nId].info.eState == TRANSFER_RUNNING;
+    };
+    auto onProgress = [this, nId, isRunning](qint64 nDone, qint64 nTotal) {
+        if (!isRunning()) {
+            return;
+        }
+        TransferInfo &info = m_hashTransfers[nId].info;
+        info.nDone = nDone;
+        info.nTotal = nTotal;
+        info.strMessage.clear();
+        emit transferChanged(nId);
+    };
+    auto onFailed = [this, nId, isRunning](const QString &strError) {
+        if (!isRunning()) {
+            return;
+        }
+        m_hashTransfers[nId].info.nRate = 0;
+        SetState(nId, TRANSFER_FAILED, strError);
+        emit transferFailed(nId, strError);
+        Schedule();
+    };
+
+    if (transfer.info.bUpload) {
+        ChunkUploader *pUploader = new ChunkUploader(m_pManager, transfer.strServerUrl,
+                                                     transfer.info.strLocalPath, this);
+        pUploader->SetBandwidthLimiter(m_pLimiter);
+        connect(pUploader, &ChunkUploader::hashProgress, this, [this, nId, isRunning](qint64 nDone, qint64 nTotal) {
+            if (!isRunning()) {
+                return;
+            }
+            m_hashTransfers[nId].info.strMessage = QString("正在校验 %1%")
+                    .arg(nTotal > 0 ? nDone * 100 / nTotal : 0);
+            emit transferChanged(nId);
+        });
+        connect(pUploader, &ChunkUploader::progress, this, onProgress);
+        connect(pUploader, &ChunkUploader::failed, this, onFailed);
+        connect(pUploader, &ChunkUploader::finished, this, [this, nId, isRunning, pUploader](const QString &strServerPath, bool bInstant) {
+            if (!isRunning()) {
+                return;
+            }
+            QString strFileHash = pUploader->FileHash();
+            Transfer &done = m_hashTransfers[nId];
+            done.info.nDone = done.info.nTotal;
+            done.info.nRate = 0;
+            ReleaseJob(done, false);
+            SetState(nId, TRANSFER_FINISHED, bInstant ? QString("秒传") : QString());
+            emit uploadFinished(nId, strServerPath, strFileHash, bInstant);
+            Schedule();
+        });
+        return pUploader;
+    }
+
+    SegmentDownloader *pDownloader = new SegmentDownloader(m_pManager, transfer.strServerUrl,
+                                                           transfer.strServerFile, transfer.info.strLocalPath, this);
+    pDownloader->SetBandwidthLimiter(m_pLimiter);
+    connect(pDownloader, &SegmentDownloader::progress, this, onProgress);
+    connect(pDownloader, &SegmentDownloader::failed, this, onFailed);
+    connect(pDownloader, &SegmentDownloader::finished, this, [this, nId, isRunning](const QString &strSavePath) {
+        if (!isRunning()) {
+            return;
+        }
+        Transfer &done = m_hashTransfers[nId];
+        done.info.nDone = qMax<qint64>(0, done.info.nTotal);
+        done.info.nRate = 0;
+        ReleaseJob(done, false);
+        SetState(nId, TRANSFER_FINISHED);
+        emit downloadFinished(nId, strSavePath);
+        Schedule();
+    });
+    return pDownloader;
+}
+
+void TransferScheduler::ReleaseJob(Transfer &transfer, bool bDiscard)
+{
+    if (!transfer.pJob) {
+        return;
+    }
+    if (ChunkUploader *pUploader = qobject_cast<ChunkUploader*>(transfer.pJob)) {
+        pUploader->Abort();
+    } else if (SegmentDownloader *pDownloader = qobject_cast<SegmentDownloader*>(transfer.pJob)) {
+        if (bDiscard) {
+            pDownloader->Discard();
+        } else {
+            pDownloader->Pause();
+        }
+    }
+    // 可能正处于该对象发出的信号中，延迟释放
+    transfer.pJob->deleteLater();
+    transfer.pJob = nullptr;
+}
+
+void TransferScheduler::SetState(int nId, TransferState eState, const QString &strMessage)
+{
+    TransferInfo &info = m_hashTransfers[nId].info;
+    info.eState = eState;
+    info.strMessage = strMessage;
+    emit transferChanged(nId);
+}
+
+void TransferScheduler::UpdateRates()
+{
+    for (auto it = m_hashTransfers.begin(); it != m_hashTransfers.end(); ++it) {
+        Transfer &transfer = it.value();
+        if (transfer.info.eState != TRANSFER_RUNNING) {
+            continue;
+        }
+        qint64 nRate = (transfer.info.nDone - transfer.nRateBase) * 1000 / TRANSFER_RATE_INTERVAL;
+        transfer.nRateBase = transfer.info.nDone;
+        // 重试或续传时进度可能回退
+        nRate = qMax<qint64>(0, nRate);
+        if (nRate != transfer.info.nRate) {
+            transfer.info.nRate = nRate;
+            emit transferChanged(it.key());
+        }
+    }
+}
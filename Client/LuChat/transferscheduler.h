@@ -0,0 +1,134 @@
+#ifndef TRANSFERSCHEDULER_H
+#define TRANSFERSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QPointer>
+#include <QNetworkAccessManager>
+
+class BandwidthLimiter;
+
+// 传输速度的统计间隔（毫秒）
+const int TRANSFER_RATE_INTERVAL = 1000;
+
+// 传输状态
+enum TransferState {
+    TRANSFER_QUEUED,      // 排队等待
+    TRANSFER_RUNNING,     // 正在传输
+    TRANSFER_PAUSED,      // 已暂停
+    TRANSFER_FINISHED,    // 已完成
+    TRANSFER_FAILED,      // 失败（可继续）
+    TRANSFER_CANCELED     // 已取消
+};
+
+// 传输优先级（排队时优先级高的先开始）
+enum TransferPriority {
+    TRANSFER_PRIORITY_LOW,
+    TRANSFER_PRIORITY_NORMAL,
+    TRANSFER_PRIORITY_HIGH
+};
+
+/**
+ * @brief 一个传输任务的状态（供界面显示）
+ */
+typedef struct _TransferInfo {
+    int nId;
+    bool bUpload;               // 上传或下载
+    QString strName;            // 文件名
+    QString strLocalPath;       // 本地文件路径（上传的源文件或下载的保存位置）
+    TransferState eState;
+    TransferPriority ePriority;
+    qint64 nDone;               // 已传输的字节
+    qint64 nTotal;              // 总字节数（未知时为-1）
+    qint64 nRate;               // 最近的速度（字节/秒）
+    QString strMessage;         // 附加说明（如校验进度、失败原因）
+} TransferInfo, *PTransferInfo;
+
+/**
+ * @brief 文件传输调度
+ *
+ * 上传（ChunkUploader）和下载（SegmentDownloader）统一排队，同时最多进行
+ * SetMaxConcurrent个，其余按优先级、再按加入顺序等待；正在进行的传输不会
+ * 被抢占。所有传输共用一个BandwidthLimiter限制总速率，给聊天消息留出带宽。
+ * 暂停的任务保留传输对象，继续时上传重新查询服务器已有的块、下载从已保存
+ * 的分段进度继续。
+ */
+class TransferScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TransferScheduler(QNetworkAccessManager *pManager, QObject *parent = nullptr);
+    ~TransferScheduler();
+
+    // 加入上传任务，返回任务ID。strServerUrl形如"http://host:port"
+    int AddUpload(const QString &strServerUrl, const QString &strFilePath,
+                  TransferPriority ePriority = TRANSFER_PRIORITY_NORMAL);
+    // 加入下载任务，strFileName为服务器上的文件名
+    int AddDownload(const QString &strServerUrl, const QString &strFileName, const QString &strSavePath,
+                    TransferPriority ePriority = TRANSFER_PRIORITY_NORMAL);
+
+    void Pause(int nId);
+    // 继续暂停或失败的任务（重新排队）
+    void Resume(int nId);
+    // 取消任务（下载会删除已下载的部分）
+    void Cancel(int nId);
+    void SetPriority(int nId, TransferPriority ePriority);
+    // 移除已完成、已取消的任务
+    void ClearFinished();
+
+    void SetMaxConcurrent(int nMax);
+    int MaxConcurrent() const;
+    // 总限速（字节/秒），0表示不限速
+    void SetBandwidthLimit(qint64 nBytesPerSecond);
+    qint64 BandwidthLimit() const;
+
+    bool Contains(int nId) const;
+    TransferInfo Info(int nId) const;
+    // 按加入顺序排列的任务ID
+    QList<int> Ids() const;
+
+signals:
+    void transferAdded(int nId);
+    void transferChanged(int nId);
+    void transferRemoved(int nId);
+    // 上传完成，strServerPath为服务器上的文件路径，strFileHash为文件内容哈希
+    void uploadFinished(int nId, const QString &strServerPath, const QString &strFileHash, bool bInstant);
+    void downloadFinished(int nId, const QString &strSavePath);
+    void transferFailed(int nId, const QString &strError);
+
+private slots:
+    void UpdateRates();
+
+private:
+    typedef struct _Transfer {
+        TransferInfo info;
+        QString strServerUrl;
+        QString strServerFile;      // 下载：服务器上的文件名
+        QPointer<QObject> pJob;     // ChunkUploader或SegmentDownloader，开始后创建
+        qint64 nRateBase;           // 上次统计速度时的已传输字节
+    } Transfer;
+
+    QNetworkAccessManager *m_pManager;
+    BandwidthLimiter *m_pLimiter;
+    QHash<int, Transfer> m_hashTransfers;
+    QList<int> m_listOrder;         // 加入顺序
+    int m_nNextId;
+    int m_nMaxConcurrent;
+    QTimer m_rateTimer;
+
+    int Add(const Transfer &transfer);
+    // 有空闲名额时开始排队中优先级最高的任务
+    void Schedule();
+    void StartTransfer(int nId);
+    // 创建传输对象并连接信号
+    QObject *CreateJob(int nId);
+    // 停止并释放传输对象，bDiscard时删除下载的.part文件
+    void ReleaseJob(Transfer &transfer, bool bDiscard);
+    void SetState(int nId, TransferState eState, const QString &strMessage = QString());
+    int RunningCount() const;
+};
+
+#endif // TRANSFERSCHEDULER_H
@@ -22,6 +22,9 @@ func main() {
 		logrus.Fatalf("数据库初始化失败: %v", err)
 	}
 
+	// 初始化会话令牌
+	service.InitSessionService(config.Cfg.Session)
+
 	// 初始化AI服务
 	service.InitAIService(config.Cfg.AI)
 	logrus.Info("AI服务初始化完成")
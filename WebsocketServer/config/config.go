@@ -23,9 +23,16 @@ type AIConfig struct {
 	Timeout     int     `json:"timeout"` // 秒
 }
 
+// 会话令牌配置
+type SessionConfig struct {
+	Secret   string `json:"secret"`    // 签名密钥，为空时每次启动随机生成（重启后令牌失效）
+	TTLHours int    `json:"ttl_hours"` // 令牌有效期（小时）
+}
+
 type Config struct {
-	Database SqlConfig `json:"database"`
-	AI       AIConfig  `json:"ai"`
+	Database SqlConfig     `json:"database"`
+	AI       AIConfig      `json:"ai"`
+	Session  SessionConfig `json:"session"`
 }
 
 // 全局配置实例
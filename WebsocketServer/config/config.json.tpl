@@ -14,5 +14,9 @@
         "temperature": 0.7,
         "max_tokens": 2048,
         "timeout": 30
+    },
+    "session": {
+        "secret": "",
+        "ttl_hours": 720
     }
 }
\ No newline at end of file
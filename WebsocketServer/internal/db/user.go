@@ -29,6 +29,16 @@ func CreateUser(user *model.ChatUser) error {
 	return nil
 }
 
+// 按ID查询用户
+func GetUserByID(id int) (*model.ChatUser, error) {
+	var user model.ChatUser
+	if err := DB.Where("id = ?", id).First(&user).Error; err != nil {
+		logrus.Errorf("查询用户失败: %v", err)
+		return nil, err
+	}
+	return &user, nil
+}
+
 // 检查用户是否存在
 func IsUserExist(userPhone string) bool {
 	var count int64
@@ -4,10 +4,16 @@ import (
 	"github.com/gorilla/websocket"
 )
 
+// 客户端消息帧格式（连接建立后由客户端协商）
+const (
+	FormatJSON = iota // JSON文本帧（默认）
+	FormatCBOR        // CBOR二进制帧
+)
+
 // 客户端连接管理
 // 存储所有连接的WebSocket客户端
-// map键为WebSocket连接指针，快速查找和管理活跃连接
-var Clients = make(map[*websocket.Conn]bool)
+// map键为WebSocket连接指针，快速查找和管理活跃连接；值为该客户端的消息帧格式
+var Clients = make(map[*websocket.Conn]int)
 
 // goroutine之间传递广播消息
 var Broadcast = make(chan StringMessage)
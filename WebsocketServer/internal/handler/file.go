@@ -1,6 +1,8 @@
 package handler
 
 import (
+	"crypto/sha256"
+	"encoding/hex"
 	"fmt"
 	"io"
 	"luchat/WebsocketServer/internal/global"
@@ -11,6 +13,7 @@ import (
 	"net/http"
 	"os"
 	"path/filepath"
+	"strconv"
 	"strings"
 
 	"github.com/gin-gonic/gin"
@@ -69,15 +72,35 @@ func checkFileType(contentType string) bool {
 	return false
 }
 
+// 文件哈希用作临时目录名，只接受十六进制字符串，防止路径遍历攻击
+func isValidFileHash(fileHash string) bool {
+	if fileHash == "" || len(fileHash) > 128 {
+		return false
+	}
+	for _, ch := range fileHash {
+		if !(ch >= '0' && ch <= '9' || ch >= 'a' && ch <= 'f' || ch >= 'A' && ch <= 'F') {
+			return false
+		}
+	}
+	return true
+}
+
+// 安全处理文件名：移除路径分隔符，防止路径遍历攻击
+func safeFilename(filename string) string {
+	filename = strings.ReplaceAll(filename, "/", "")
+	return strings.ReplaceAll(filename, "\\", "")
+}
+
 // 上传文件块
 func UploadChunk(c *gin.Context) {
 	// 获取表单数据
 	fileHash := c.PostForm("file_hash")
-	chunkIndexStr := c.PostForm("chunk_index")
-	totalChunksStr := c.PostForm("total_chunks")
-	filename := c.PostForm("filename")
+	filename := safeFilename(c.PostForm("filename"))
+	chunkIndex, errIndex := strconv.Atoi(c.PostForm("chunk_index"))
+	totalChunks, errTotal := strconv.Atoi(c.PostForm("total_chunks"))
 
-	if fileHash == "" || chunkIndexStr == "" || totalChunksStr == "" || filename == "" {
+	if !isValidFileHash(fileHash) || errIndex != nil || errTotal != nil || filename == "" ||
+		chunkIndex < 0 || chunkIndex >= totalChunks {
 		response.ResponseError(c, response.CodeInvalidParam)
 		return
 	}
@@ -105,7 +128,7 @@ func UploadChunk(c *gin.Context) {
 	}
 
 	// 保存块文件
-	chunkPath := filepath.Join(tempDir, chunkIndexStr)
+	chunkPath := filepath.Join(tempDir, strconv.Itoa(chunkIndex))
 	if err := c.SaveUploadedFile(file, chunkPath); err != nil {
 		response.ResponseError(c, response.CodeServerBusy)
 		return
@@ -122,6 +145,11 @@ func CheckResume(c *gin.Context) {
 		response.ResponseError(c, response.CodeInvalidParam)
 		return
 	}
+	if !isValidFileHash(req.FileHash) {
+		response.ResponseError(c, response.CodeInvalidParam)
+		return
+	}
+	req.Filename = safeFilename(req.Filename)
 
 	// 验证文件类型
 	fileExt := filepath.Ext(req.Filename)
@@ -195,8 +223,8 @@ func CheckInstantUpload(c *gin.Context) {
 		resp.FileUrl = "/api/download?filename=" + existingFile.FileName
 		resp.Message = "文件已存在，秒传成功"
 
-		// 更新文件的上传用户（如果是新用户上传）
-		uploadUser := c.PostForm("userphone")
+		// 更新文件的上传用户（如果是新用户上传，请求体为JSON，上传用户取自请求字段）
+		uploadUser := req.UserPhone
 		if uploadUser != "" && uploadUser != existingFile.UploadUser {
 			// 可以选择更新上传用户或者创建新的记录
 			// 这里我们选择创建新记录，表示该用户也上传了这个文件
@@ -217,6 +245,16 @@ func MergeChunks(c *gin.Context) {
 		response.ResponseError(c, response.CodeInvalidParam)
 		return
 	}
+	// 安全处理文件名和哈希，防止路径遍历攻击
+	if !isValidFileHash(req.FileHash) {
+		response.ResponseError(c, response.CodeInvalidParam)
+		return
+	}
+	req.Filename = safeFilename(req.Filename)
+	if req.Filename == "" {
+		response.ResponseError(c, response.CodeInvalidParam)
+		return
+	}
 	// 获取临时存储分块文件路径
 	tempDir := filepath.Join("web", "temp", req.FileHash)
 	// 获取目标存储文件路径
@@ -235,14 +273,18 @@ func MergeChunks(c *gin.Context) {
 		}
 	}
 
-	// 合并文件
-	dstPath := filepath.Join(saveDir, req.Filename)
-	dstFile, err := os.Create(dstPath)
+	// 合并文件：先写到临时文件，同时计算内容哈希（与客户端一致为SHA-256），
+	// 与请求中的哈希一致才放到上传目录，秒传只信任服务端算出的哈希
+	mergePath := filepath.Join("web", "temp", req.FileHash+".merge")
+	dstFile, err := os.Create(mergePath)
 	if err != nil {
 		response.ResponseError(c, response.CodeServerBusy)
 		return
 	}
+	defer os.Remove(mergePath)
 	defer dstFile.Close()
+	hasher := sha256.New()
+	writer := io.MultiWriter(dstFile, hasher)
 
 	// 按顺序写入所有块
 	for i := 0; i < req.TotalChunks; i++ {
@@ -253,7 +295,7 @@ func MergeChunks(c *gin.Context) {
 			return
 		}
 
-		if _, err := io.Copy(dstFile, chunkFile); err != nil {
+		if _, err := io.Copy(writer, chunkFile); err != nil {
 			chunkFile.Close()
 			response.ResponseError(c, response.CodeServerBusy)
 			return
@@ -265,8 +307,23 @@ func MergeChunks(c *gin.Context) {
 	// 删除临时目录
 	os.RemoveAll(tempDir)
 
-	// 保存文件记录到数据库（带文件哈希）
-	uploadUser := c.PostForm("userphone")
+	if err := dstFile.Close(); err != nil {
+		response.ResponseError(c, response.CodeServerBusy)
+		return
+	}
+	if !strings.EqualFold(hex.EncodeToString(hasher.Sum(nil)), req.FileHash) {
+		logrus.Warnf("合并后的文件哈希与请求不一致: %s", req.FileHash)
+		response.ResponseErrorMsg(c, response.CodeInvalidParam, "文件哈希校验失败")
+		return
+	}
+	dstPath := filepath.Join(saveDir, req.Filename)
+	if err := os.Rename(mergePath, dstPath); err != nil {
+		response.ResponseError(c, response.CodeServerBusy)
+		return
+	}
+
+	// 保存文件记录到数据库（带文件哈希，请求体为JSON，上传用户取自请求字段）
+	uploadUser := req.UserPhone
 	fileInfo, _ := os.Stat(dstPath)
 	if err := service.SaveUploadedFileWithHash(req.Filename, fileInfo.Size(), req.FileHash, uploadUser); err != nil {
 		response.ResponseError(c, response.CodeServerBusy)
@@ -14,6 +14,7 @@ type ChunkMergeReq struct {
 	FileHash    string `json:"file_hash" binding:"required"`
 	Filename    string `json:"filename" binding:"required"`
 	TotalChunks int    `json:"total_chunks" binding:"required"`
+	UserPhone   string `json:"userphone"` // 上传用户
 }
 
 // 断点续传检查请求
@@ -34,9 +35,10 @@ type ResumeCheckResp struct {
 
 // 秒传检查请求
 type InstantUploadReq struct {
-	FileHash string `json:"file_hash" binding:"required"`
-	Filename string `json:"filename" binding:"required"`
-	FileSize int64  `json:"file_size" binding:"required"`
+	FileHash  string `json:"file_hash" binding:"required"`
+	Filename  string `json:"filename" binding:"required"`
+	FileSize  int64  `json:"file_size" binding:"required"`
+	UserPhone string `json:"userphone"` // 上传用户
 }
 
 // 秒传检查响应
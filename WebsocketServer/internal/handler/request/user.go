@@ -6,6 +6,11 @@ type LoginReq struct {
 	ClientVersion string `json:"client_version"`
 }
 
+// 凭上次登录的会话令牌登录
+type SessionReq struct {
+	Token string `json:"token" binding:"required"`
+}
+
 type RegisterReq struct {
 	UserPhone string `json:"userphone" binding:"required"`
 	Password  string `json:"password" binding:"required"`
@@ -12,8 +12,9 @@ var (
 	ErrorLoginFailedTooMany = errors.New("登录失败次数过多")
 	ErrorServerBusy         = errors.New("服务器繁忙")
 
-	ErrorNeedLogin  = errors.New("需要用户登录")
-	ErrorLimitLogin = errors.New("登录已失效")
-	ErrorInvalidID  = errors.New("无效的ID")
+	ErrorNeedLogin    = errors.New("需要用户登录")
+	ErrorLimitLogin   = errors.New("登录已失效")
+	ErrorInvalidID    = errors.New("无效的ID")
+	ErrorTokenInvalid = errors.New("无效的Token")
 	// Error
 )
@@ -2,8 +2,10 @@ package response
 
 // 用户登录返回
 type UserLoginResp struct {
-	UserID    int    `json:"userid" form:"userid"`       // 用户id
-	UserPhone string `json:"userphone" form:"userphone"` // 登录人手机号
+	UserID    int    `json:"userid" form:"userid"`         // 用户id
+	UserPhone string `json:"userphone" form:"userphone"`   // 登录人手机号
+	Token     string `json:"token" form:"token"`           // 会话令牌（下次启动免登录）
+	ExpiresAt int64  `json:"expires_at" form:"expires_at"` // 令牌过期时间（Unix秒）
 }
 
 // 用户注册
@@ -0,0 +1,86 @@
+package handler
+
+import (
+	"bytes"
+	"luchat/WebsocketServer/internal/global"
+	"strconv"
+	"time"
+
+	"github.com/gorilla/websocket"
+)
+
+// 每条广播消息在顶层附带递增的 "seq" 字段，并保存在环形缓冲中。
+// 客户端断线重连后在hello中附带 "resume":{"epoch":"...","after":N}，服务端把序号
+// 大于N、仍在缓冲中的消息补发给该客户端，补发完才开始向它广播新消息。epoch标识
+// 本次服务端进程（在helloack中下发），进程重启后序号重新计数，epoch不一致时不补发。
+
+const historySize = 1024 // 保留用于补发的最近广播消息数
+
+type seqMessage struct {
+	seq     uint64
+	message []byte
+}
+
+// 补发位置（hello中的resume字段）
+type resumePoint struct {
+	Epoch string `json:"epoch"`
+	After uint64 `json:"after"`
+}
+
+var (
+	serverEpoch = strconv.FormatInt(time.Now().UnixNano(), 36)
+	// 以下变量由mu保护
+	history      = make([]seqMessage, 0, historySize)
+	historyStart = 0 // 缓冲已满时最早一条消息的位置
+	nextSeq      = uint64(1)
+)
+
+// 为广播消息分配序号并保存，返回带序号的消息（调用方持有mu）
+func recordMessage(msg []byte) []byte {
+	seq := nextSeq
+	nextSeq++
+	framed := withSeq(msg, seq)
+	entry := seqMessage{seq: seq, message: framed}
+	if len(history) < historySize {
+		history = append(history, entry)
+	} else {
+		history[historyStart] = entry
+		historyStart = (historyStart + 1) % historySize
+	}
+	return framed
+}
+
+// 在JSON对象顶层插入seq字段，不重新序列化消息
+func withSeq(msg []byte, seq uint64) []byte {
+	trimmed := bytes.TrimSpace(msg)
+	if len(trimmed) < 2 || trimmed[0] != '{' {
+		return msg
+	}
+	out := make([]byte, 0, len(trimmed)+24)
+	out = append(out, `{"seq":`...)
+	out = strconv.AppendUint(out, seq, 10)
+	if rest := bytes.TrimSpace(trimmed[1:]); len(rest) > 0 && rest[0] != '}' {
+		out = append(out, ',')
+	}
+	return append(out, trimmed[1:]...)
+}
+
+// 按客户端协商的格式补发序号大于after的消息（调用方持有mu）
+func replayMessages(ws *websocket.Conn, format int, after uint64) error {
+	for i := 0; i < len(history); i++ {
+		entry := history[(historyStart+i)%len(history)]
+		if entry.seq <= after {
+			continue
+		}
+		messageType, message := websocket.TextMessage, entry.message
+		if format == global.FormatCBOR {
+			if cborMsg, err := jsonToCBOR(entry.message); err == nil {
+				messageType, message = websocket.BinaryMessage, cborMsg
+			}
+		}
+		if err := ws.WriteMessage(messageType, message); err != nil {
+			return err
+		}
+	}
+	return nil
+}
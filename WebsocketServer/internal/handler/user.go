@@ -41,9 +41,38 @@ func Login(c *gin.Context) {
 	// 	"userid":    user.ID,
 	// 	"userphone": user.UserPhone,
 	// })
+	token, expiresAt := service.IssueToken(user)
 	userInfo := &response.UserLoginResp{
 		UserID:    user.ID,
 		UserPhone: user.UserPhone,
+		Token:     token,
+		ExpiresAt: expiresAt,
+	}
+	response.ResponseSuccessData(c, userInfo)
+}
+
+// 凭上次登录的会话令牌登录（客户端启动时在后台校验），成功时返回新令牌
+func RefreshSession(c *gin.Context) {
+	var req request.SessionReq
+	if err := c.ShouldBindJSON(&req); err != nil {
+		response.ResponseError(c, response.CodeInvalidParam)
+		return
+	}
+
+	user, token, expiresAt, err := service.RefreshSession(req.Token)
+	if err != nil {
+		if err == response.ErrorTokenInvalid {
+			response.ResponseError(c, response.CodeTokenInvalid)
+		} else {
+			response.ResponseError(c, response.CodeServerBusy)
+		}
+		return
+	}
+	userInfo := &response.UserLoginResp{
+		UserID:    user.ID,
+		UserPhone: user.UserPhone,
+		Token:     token,
+		ExpiresAt: expiresAt,
 	}
 	response.ResponseSuccessData(c, userInfo)
 }
@@ -34,6 +34,14 @@ var (
 
 // 处理WebSocket连接
 func HandleWebsocket(ctx *gin.Context) {
+	// 客户端凭会话令牌直接连接（免登录启动）时先校验令牌，未带令牌的连接保持原有行为。
+	// 令牌放在Authorization请求头中，不出现在URL里（访问日志会记录URL）
+	if token := strings.TrimPrefix(ctx.GetHeader("Authorization"), "Bearer "); token != "" {
+		if _, _, err := service.ParseToken(token); err != nil {
+			ctx.AbortWithStatus(http.StatusUnauthorized)
+			return
+		}
+	}
 	// 1. 将HTTP连接升级为WebSocket连接
 	ws, err := upgrader.Upgrade(ctx.Writer, ctx.Request, nil)
 	if err != nil {
@@ -47,10 +55,13 @@ func HandleWebsocket(ctx *gin.Context) {
 		logrus.Errorf("设置读超时失败: %v", err)
 		return
 	}
-	// 2. 将新客户端注册到全局客户端集合
-	mu.Lock() // 加锁，防止并发修改
-	global.Clients[ws] = true
-	mu.Unlock()
+	// 2. 收到hello（协商格式、补发错过的消息）后才注册到全局客户端集合，
+	// 补发完成前不会收到新的广播，避免漏发和乱序
+	registered := false
+	register := func(format int) {
+		global.Clients[ws] = format
+		registered = true
+	}
 
 	// 心跳重置函数（每次收到消息时刷新超时时间）
 	resetHeartbeat := func() {
@@ -80,13 +91,51 @@ func HandleWebsocket(ctx *gin.Context) {
 			mu.Unlock()
 			break
 		}
+		// CBOR客户端发来的二进制帧，统一转为JSON后再广播
+		if mt == websocket.BinaryMessage {
+			jsonMsg, err := cborToJSON(msg)
+			if err != nil {
+				logrus.Errorf("CBOR消息解析失败: %v", err)
+				resetHeartbeat()
+				continue
+			}
+			mt, msg = websocket.TextMessage, jsonMsg
+		}
+		if format, resume, ok := parseHello(msg); ok {
+			// 消息帧格式协商和断线补发（不广播）：应答、补发和注册在同一次加锁内完成，
+			// 广播协程在此期间无法插入新消息
+			mu.Lock()
+			err := ws.WriteMessage(websocket.TextMessage, helloAck(format))
+			if err == nil && resume != nil && resume.Epoch == serverEpoch && resume.After > 0 {
+				err = replayMessages(ws, format, resume.After)
+			}
+			if err == nil {
+				register(format)
+			}
+			mu.Unlock()
+			if err != nil {
+				logrus.Errorf("发送协商应答或补发消息失败: %v", err)
+				break
+			}
+			resetHeartbeat()
+			continue
+		}
+		if !registered {
+			// 不发送hello的旧客户端：收到第一条消息时按JSON注册
+			mu.Lock()
+			register(global.FormatJSON)
+			mu.Unlock()
+		}
 		// 判断是否为心跳包
 		if mt == websocket.TextMessage {
 			messageStr := string(msg)
 
 			if messageStr == "ping" {
-				// 回复pong
-				if err := ws.WriteMessage(websocket.TextMessage, []byte("pong")); err != nil {
+				// 回复pong（与广播共用连接，写入需加锁，客户端据此测量往返时延）
+				mu.Lock()
+				err := ws.WriteMessage(websocket.TextMessage, []byte("pong"))
+				mu.Unlock()
+				if err != nil {
 					logrus.Errorf("发送pong失败: %v", err)
 					break
 				}
@@ -107,6 +156,16 @@ func HandleWebsocket(ctx *gin.Context) {
 		}
 		// 重置心跳超时
 		resetHeartbeat()
+		// 批量帧拆开后逐条广播
+		if items, ok := splitBatch(msg); ok {
+			for _, item := range items {
+				global.Broadcast <- global.StringMessage{
+					MessageType: websocket.TextMessage,
+					Message:     item,
+				}
+			}
+			continue
+		}
 		// 将消息发送到全局广播通道，等待广播协程处理
 		global.Broadcast <- global.StringMessage{
 			MessageType: mt,  // 消息类型（与读取的一致）
@@ -168,11 +227,30 @@ func broadcastMessage(sender, content string) {
 func StartBroadCast() {
 	// 循环从广播通道接收消息
 	for msg := range global.Broadcast {
+		// CBOR帧在有CBOR客户端时才生成，每条消息只转码一次
+		var cborMsg []byte
 		// 加锁，防止并发修改客户端集合
 		mu.Lock()
-		// 遍历所有在线客户端，发送消息
-		for client := range global.Clients {
-			if err := client.WriteMessage(msg.MessageType, msg.Message); err != nil {
+		// 分配广播序号并保存，供断线重连的客户端补发
+		if msg.MessageType == websocket.TextMessage {
+			msg.Message = recordMessage(msg.Message)
+		}
+		// 遍历所有在线客户端，按各自协商的格式发送消息
+		for client, format := range global.Clients {
+			messageType, message := msg.MessageType, msg.Message
+			if format == global.FormatCBOR && messageType == websocket.TextMessage {
+				if cborMsg == nil {
+					var err error
+					if cborMsg, err = jsonToCBOR(msg.Message); err != nil {
+						logrus.Errorf("CBOR消息转码失败: %v", err)
+						cborMsg = []byte{}
+					}
+				}
+				if len(cborMsg) > 0 {
+					messageType, message = websocket.BinaryMessage, cborMsg
+				}
+			}
+			if err := client.WriteMessage(messageType, message); err != nil {
 				logrus.Errorf("WebSocket发送消息失败: %v", err)
 				// 发送失败时关闭连接
 				client.Close()
@@ -0,0 +1,106 @@
+package handler
+
+import (
+	"bytes"
+	"encoding/json"
+	"luchat/WebsocketServer/internal/global"
+	"reflect"
+
+	"github.com/ugorji/go/codec"
+)
+
+// 客户端连接后发送 {"hello":{"format":"cbor"}} 协商消息帧格式，
+// 服务端回复 {"helloack":{"format":"cbor"}}，此后双方对该连接使用CBOR二进制帧。
+// 重连的客户端在hello中附带resume字段请求补发（见resume.go），服务端应答并补发后
+// 才开始向该连接广播。
+// 不支持协商的旧服务端会把hello原样广播，客户端收不到helloack时继续使用JSON。
+// 广播通道中统一保存JSON，向CBOR客户端发送时每条消息只转码一次。
+// helloack中的batch表示服务端接受 {"batch":[消息,...]} 批量帧，
+// 批量帧拆开后逐条广播，其他客户端收到的仍是单条消息。
+
+const wireFormatCBOR = "cbor"
+
+var (
+	helloPrefix = []byte(`{"hello"`)
+	batchPrefix = []byte(`{"batch"`)
+	cborHandle  = newCborHandle()
+)
+
+type batchFrame struct {
+	Batch []json.RawMessage `json:"batch"`
+}
+
+type helloFrame struct {
+	Hello *struct {
+		Format string       `json:"format"`
+		Resume *resumePoint `json:"resume"`
+	} `json:"hello"`
+}
+
+func newCborHandle() *codec.CborHandle {
+	h := &codec.CborHandle{}
+	// 解码为字符串键的map，才能直接序列化为JSON
+	h.MapType = reflect.TypeOf(map[string]interface{}(nil))
+	return h
+}
+
+// 解析协商消息，返回消息帧格式和补发位置（未带时为nil），非协商消息返回false
+func parseHello(msg []byte) (int, *resumePoint, bool) {
+	if !bytes.HasPrefix(msg, helloPrefix) {
+		return global.FormatJSON, nil, false
+	}
+	var hello helloFrame
+	if err := json.Unmarshal(msg, &hello); err != nil || hello.Hello == nil {
+		return global.FormatJSON, nil, false
+	}
+	if hello.Hello.Format == wireFormatCBOR {
+		return global.FormatCBOR, hello.Hello.Resume, true
+	}
+	return global.FormatJSON, hello.Hello.Resume, true
+}
+
+// 协商应答
+func helloAck(format int) []byte {
+	name := "json"
+	if format == global.FormatCBOR {
+		name = wireFormatCBOR
+	}
+	ack, _ := json.Marshal(map[string]interface{}{
+		"helloack": map[string]interface{}{"format": name, "batch": true, "epoch": serverEpoch},
+	})
+	return ack
+}
+
+// 拆分批量帧，非批量帧返回false
+func splitBatch(msg []byte) ([]json.RawMessage, bool) {
+	if !bytes.HasPrefix(msg, batchPrefix) {
+		return nil, false
+	}
+	var batch batchFrame
+	if err := json.Unmarshal(msg, &batch); err != nil {
+		return nil, false
+	}
+	return batch.Batch, true
+}
+
+// CBOR消息帧转为JSON
+func cborToJSON(msg []byte) ([]byte, error) {
+	var v interface{}
+	if err := codec.NewDecoderBytes(msg, cborHandle).Decode(&v); err != nil {
+		return nil, err
+	}
+	return json.Marshal(v)
+}
+
+// JSON消息帧转为CBOR
+func jsonToCBOR(msg []byte) ([]byte, error) {
+	var v interface{}
+	if err := json.Unmarshal(msg, &v); err != nil {
+		return nil, err
+	}
+	var out []byte
+	if err := codec.NewEncoderBytes(&out, cborHandle).Encode(v); err != nil {
+		return nil, err
+	}
+	return out, nil
+}
@@ -29,6 +29,7 @@ func Init() *gin.Engine {
 	{
 		api.POST("/login", handler.Login)
 		api.POST("/register", handler.Register)
+		api.POST("/session", handler.RefreshSession) // 会话令牌登录
 
 		api.POST("/upload", handler.UploadFile)
 		api.DELETE("/deletefile", handler.DeleteFile)
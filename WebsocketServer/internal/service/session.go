@@ -0,0 +1,109 @@
+package service
+
+import (
+	"crypto/hmac"
+	"crypto/rand"
+	"crypto/sha256"
+	"encoding/base64"
+	"errors"
+	"fmt"
+	"luchat/WebsocketServer/config"
+	"luchat/WebsocketServer/internal/db"
+	"luchat/WebsocketServer/internal/handler/response"
+	"luchat/WebsocketServer/internal/model"
+	"strconv"
+	"strings"
+	"time"
+
+	"github.com/sirupsen/logrus"
+	"gorm.io/gorm"
+)
+
+// 默认令牌有效期
+const defaultSessionTTL = 30 * 24 * time.Hour
+
+var (
+	sessionSecret []byte
+	sessionTTL    = defaultSessionTTL
+)
+
+// InitSessionService 初始化会话令牌的签名密钥和有效期
+func InitSessionService(cfg config.SessionConfig) {
+	if cfg.Secret != "" {
+		sessionSecret = []byte(cfg.Secret)
+	} else {
+		sessionSecret = make([]byte, 32)
+		if _, err := rand.Read(sessionSecret); err != nil {
+			logrus.Fatalf("生成会话密钥失败: %v", err)
+		}
+		logrus.Warn("未配置会话密钥，使用随机密钥（服务重启后客户端需要重新登录）")
+	}
+	if cfg.TTLHours > 0 {
+		sessionTTL = time.Duration(cfg.TTLHours) * time.Hour
+	}
+}
+
+// 令牌格式：base64url("用户ID|手机号|过期时间") + "." + base64url(HMAC-SHA256签名)
+// 无需在服务端保存会话，校验签名即可，多实例部署时共用同一密钥
+func signSession(payload string) string {
+	mac := hmac.New(sha256.New, sessionSecret)
+	mac.Write([]byte(payload))
+	return base64.RawURLEncoding.EncodeToString(mac.Sum(nil))
+}
+
+// IssueToken 为登录用户签发令牌，返回令牌和过期时间（Unix秒）
+func IssueToken(user *model.ChatUser) (string, int64) {
+	expiresAt := time.Now().Add(sessionTTL).Unix()
+	payload := fmt.Sprintf("%d|%s|%d", user.ID, user.UserPhone, expiresAt)
+	return base64.RawURLEncoding.EncodeToString([]byte(payload)) + "." + signSession(payload), expiresAt
+}
+
+// ParseToken 校验令牌的签名和有效期，返回令牌中的用户ID和手机号（不查询数据库）
+func ParseToken(token string) (int, string, error) {
+	parts := strings.Split(token, ".")
+	if len(parts) != 2 {
+		return 0, "", response.ErrorTokenInvalid
+	}
+	raw, err := base64.RawURLEncoding.DecodeString(parts[0])
+	if err != nil {
+		return 0, "", response.ErrorTokenInvalid
+	}
+	payload := string(raw)
+	if !hmac.Equal([]byte(signSession(payload)), []byte(parts[1])) {
+		return 0, "", response.ErrorTokenInvalid
+	}
+	fields := strings.Split(payload, "|")
+	if len(fields) != 3 {
+		return 0, "", response.ErrorTokenInvalid
+	}
+	userID, err := strconv.Atoi(fields[0])
+	if err != nil {
+		return 0, "", response.ErrorTokenInvalid
+	}
+	expiresAt, err := strconv.ParseInt(fields[2], 10, 64)
+	if err != nil || time.Now().Unix() >= expiresAt {
+		return 0, "", response.ErrorTokenInvalid
+	}
+	return userID, fields[1], nil
+}
+
+// RefreshSession 凭令牌登录：校验令牌且用户仍然存在时返回用户，并签发新令牌（滑动过期）
+func RefreshSession(token string) (*model.ChatUser, string, int64, error) {
+	userID, userPhone, err := ParseToken(token)
+	if err != nil {
+		return nil, "", 0, err
+	}
+	user, err := db.GetUserByID(userID)
+	if errors.Is(err, gorm.ErrRecordNotFound) {
+		return nil, "", 0, response.ErrorTokenInvalid
+	}
+	// 数据库暂时不可用时令牌仍然有效，不能让客户端因此清除会话
+	if err != nil {
+		return nil, "", 0, response.ErrorServerBusy
+	}
+	if user.UserPhone != userPhone {
+		return nil, "", 0, response.ErrorTokenInvalid
+	}
+	newToken, expiresAt := IssueToken(user)
+	return user, newToken, expiresAt, nil
+}
@@ -1,6 +1,7 @@
 package logger
 
 import (
+	"net/url"
 	"os"
 	"path/filepath"
 	"time"
@@ -44,12 +45,23 @@ func Init(logPath, logFileName string) {
 	logrus.AddHook(lfHook)
 }
 
+// 查询参数中的会话令牌不写入日志（旧客户端仍把令牌放在WebSocket地址中）
+func redactQuery(rawQuery string) string {
+	// 解析出错时values中仍有已解析的参数
+	values, _ := url.ParseQuery(rawQuery)
+	if !values.Has("token") {
+		return rawQuery
+	}
+	values.Set("token", "***")
+	return values.Encode()
+}
+
 // GinLogger  Gin日志中间件
 func GinLogger() gin.HandlerFunc {
 	return func(c *gin.Context) {
 		startTime := time.Now()
 		path := c.Request.URL.Path
-		query := c.Request.URL.RawQuery
+		query := redactQuery(c.Request.URL.RawQuery)
 
 		c.Next()
 